@@ -0,0 +1,189 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	uint32_t AnimationClip::beginTrack(uint32_t node) {
+		Track track;
+		track.node = node;
+		track.translation.first = static_cast<uint32_t>(mTranslationTimes.size());
+		track.rotation.first = static_cast<uint32_t>(mRotationTimes.size());
+		track.scale.first = static_cast<uint32_t>(mScaleTimes.size());
+		mTracks.push_back(track);
+		return static_cast<uint32_t>(mTracks.size() - 1);
+	}
+
+	void AnimationClip::addTranslationKey(float time, const glm::vec3& value) {
+		mTranslationTimes.push_back(time);
+		mTranslations.push_back(value);
+		mTracks.back().translation.count++;
+	}
+
+	void AnimationClip::addRotationKey(float time, const glm::quat& value) {
+		mRotationTimes.push_back(time);
+		mRotations.push_back(value);
+		mTracks.back().rotation.count++;
+	}
+
+	void AnimationClip::addScaleKey(float time, const glm::vec3& value) {
+		mScaleTimes.push_back(time);
+		mScales.push_back(value);
+		mTracks.back().scale.count++;
+	}
+
+	void AnimationSampler::setClip(const AnimationClip* clip) {
+		mClip = clip;
+		mCursors.assign(clip ? clip->getTrackCount() : 0, Cursor());
+	}
+
+	namespace {
+		const uint32_t kMaxSteps = 4;
+	}
+
+	// returns the key k (relative to the range) with times[k] <= time < times[k + 1]
+	uint32_t AnimationSampler::advance(const std::vector<float>& times, const AnimationClip::KeyRange& range, uint32_t cursor, float time) {
+		if (range.count < 2)
+			return 0;
+
+		const float* keys = times.data() + range.first;
+		if (time >= keys[cursor]) {
+			// playback moves at most a key or two per frame, a longer jump is a seek
+			for (uint32_t steps = 0; steps < kMaxSteps; steps++) {
+				if (cursor + 2 >= range.count || keys[cursor + 1] > time)
+					return cursor;
+				cursor++;
+			}
+		}
+
+		mSeeks++;
+		const float* next = std::upper_bound(keys, keys + range.count - 1, time);
+		return next == keys ? 0 : static_cast<uint32_t>(next - keys - 1);
+	}
+
+	namespace {
+		inline float keyFactor(const float* keys, uint32_t cursor, uint32_t count, float time) {
+			if (cursor + 1 >= count)
+				return 0.0f;
+			float span = keys[cursor + 1] - keys[cursor];
+			return span > 0.0f ? std::min(1.0f, std::max(0.0f, (time - keys[cursor]) / span)) : 0.0f;
+		}
+	}
+
+	void AnimationSampler::sample(float time, LocalPose& pose, bool loop) {
+		if (!mClip)
+			return;
+
+		float duration = mClip->getDuration();
+		if (duration > 0.0f) {
+			time = loop ? std::fmod(time, duration) : std::min(time, duration);
+			if (time < 0.0f)
+				time += duration;
+		}
+
+		const AnimationClip& clip = *mClip;
+		for (uint32_t i = 0; i < clip.getTrackCount(); i++) {
+			const AnimationClip::Track& track = clip.getTrack(i);
+			Cursor& cursor = mCursors[i];
+
+			// channels without keys leave the pose alone: the node keeps its bind or current value
+			if (track.translation.count > 0) {
+				cursor.translation = advance(clip.mTranslationTimes, track.translation, cursor.translation, time);
+				const glm::vec3* keys = clip.mTranslations.data() + track.translation.first;
+				float f = keyFactor(clip.mTranslationTimes.data() + track.translation.first, cursor.translation, track.translation.count, time);
+				pose.translations[track.node] = f > 0.0f ? glm::mix(keys[cursor.translation], keys[cursor.translation + 1], f) : keys[cursor.translation];
+			}
+
+			if (track.rotation.count > 0) {
+				cursor.rotation = advance(clip.mRotationTimes, track.rotation, cursor.rotation, time);
+				const glm::quat* keys = clip.mRotations.data() + track.rotation.first;
+				float f = keyFactor(clip.mRotationTimes.data() + track.rotation.first, cursor.rotation, track.rotation.count, time);
+				pose.rotations[track.node] = f > 0.0f ? glm::slerp(keys[cursor.rotation], keys[cursor.rotation + 1], f) : keys[cursor.rotation];
+			}
+
+			if (track.scale.count > 0) {
+				cursor.scale = advance(clip.mScaleTimes, track.scale, cursor.scale, time);
+				const glm::vec3* keys = clip.mScales.data() + track.scale.first;
+				float f = keyFactor(clip.mScaleTimes.data() + track.scale.first, cursor.scale, track.scale.count, time);
+				pose.scales[track.node] = f > 0.0f ? glm::mix(keys[cursor.scale], keys[cursor.scale + 1], f) : keys[cursor.scale];
+			}
+		}
+	}
+
+	void buildBenchmarkCharacter(Skeleton& skeleton, AnimationClip& clip, uint32_t nodeCount, uint32_t boneCount, uint32_t keyCount) {
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const float duration = clip.getDuration();
+
+		for (uint32_t n = 0; n < nodeCount; n++) {
+			glm::mat4 offset(1.0f);
+			offset[3] = glm::vec4(unit(rng) * 0.1f, 0.1f, unit(rng) * 0.1f, 1.0f);
+			// every node hangs off one of the previous few
+			int32_t parent = n == 0 ? -1 : static_cast<int32_t>(n - 1 - (rng() % std::min<uint32_t>(n, 4)));
+			skeleton.addNode("node" + std::to_string(n), parent, offset);
+			if (n >= nodeCount - boneCount)
+				skeleton.addBone("node" + std::to_string(n), n, glm::mat4(1.0f));
+
+			clip.beginTrack(n);
+			clip.addTranslationKey(0.0f, glm::vec3(offset[3]));
+			for (uint32_t k = 0; k < keyCount; k++)
+				clip.addRotationKey(duration * k / (keyCount - 1), glm::normalize(glm::quat(1.0f, unit(rng) * 0.2f, unit(rng) * 0.2f, 0.0f)));
+		}
+	}
+
+	namespace {
+		void benchmarkAnimationSampling(std::vector<BenchmarkResult>& results) {
+			// 100 characters x 200 bones, 10 s clip with 30 keys/s on every channel
+			const uint32_t characters = 100, bones = 200, keysPerTrack = 300;
+			const float duration = 10.0f;
+			std::mt19937 rng(3);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+			AnimationClip clip("bench", duration);
+			for (uint32_t b = 0; b < bones; b++) {
+				clip.beginTrack(b);
+				for (uint32_t k = 0; k < keysPerTrack; k++)
+					clip.addTranslationKey(duration * k / (keysPerTrack - 1), glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.1f);
+				for (uint32_t k = 0; k < keysPerTrack; k++)
+					clip.addRotationKey(duration * k / (keysPerTrack - 1), glm::normalize(glm::quat(1.0f, unit(rng) * 0.2f, unit(rng) * 0.2f, unit(rng) * 0.2f)));
+				clip.addScaleKey(0.0f, glm::vec3(1.0f));
+			}
+
+			std::vector<Skeleton> skeletons(characters);
+			std::vector<AnimationSampler> samplers(characters);
+			for (uint32_t c = 0; c < characters; c++) {
+				for (uint32_t b = 0; b < bones; b++)
+					skeletons[c].addNode("bone" + std::to_string(b), b == 0 ? -1 : b - 1, glm::mat4(1.0f));
+				samplers[c].setClip(&clip);
+			}
+
+			const float dt = 1.0f / 60.0f;
+			BenchmarkResult forward = runBenchmark("sample forward, 100 x 200 bones", 600, [&](uint32_t frame) {
+				for (uint32_t c = 0; c < characters; c++)
+					samplers[c].sample(frame * dt + c * 0.05f, skeletons[c]);
+			});
+			forward.itemsPerIteration = characters * bones;
+			forward.itemName = "bone";
+			results.push_back(forward);
+
+			std::uniform_real_distribution<float> seek(0.0f, duration);
+			std::vector<float> seekTimes(600 * characters);
+			for (float& t : seekTimes)
+				t = seek(rng);
+			BenchmarkResult random = runBenchmark("sample random seek, 100 x 200 bones", 600, [&](uint32_t frame) {
+				for (uint32_t c = 0; c < characters; c++)
+					samplers[c].sample(seekTimes[frame * characters + c], skeletons[c]);
+			});
+			random.itemsPerIteration = characters * bones;
+			random.itemName = "bone";
+			results.push_back(random);
+		}
+
+		bool sRegistered = registerBenchmark("animation", &benchmarkAnimationSampling);
+	}
+
+}
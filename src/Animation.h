@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Mesh.h"
+
+namespace Gizmo {
+
+	// Keyframes of every animated node in one clip. Keys of all tracks share three flat arrays
+	// (translation, rotation, scale); a track only stores its ranges. Times are in seconds.
+	class AnimationClip {
+	public:
+		struct KeyRange {
+			uint32_t first = 0;
+			uint32_t count = 0;
+		};
+
+		struct Track {
+			uint32_t node;
+			KeyRange translation, rotation, scale;
+		};
+
+		AnimationClip(const std::string& name = "", float duration = 0.0f) : mName(name), mDuration(duration) {}
+
+		// keys of a track are added right after beginTrack, in ascending time
+		uint32_t beginTrack(uint32_t node);
+		void addTranslationKey(float time, const glm::vec3& value);
+		void addRotationKey(float time, const glm::quat& value);
+		void addScaleKey(float time, const glm::vec3& value);
+
+		const std::string& getName() const { return mName; }
+		float getDuration() const { return mDuration; }
+		uint32_t getTrackCount() const { return static_cast<uint32_t>(mTracks.size()); }
+		const Track& getTrack(uint32_t index) const { return mTracks[index]; }
+		uint32_t getKeyCount() const { return static_cast<uint32_t>(mTranslationTimes.size() + mRotationTimes.size() + mScaleTimes.size()); }
+		size_t getMemorySize() const {
+			return mTracks.size() * sizeof(Track)
+				+ mTranslationTimes.size() * (sizeof(float) + sizeof(glm::vec3))
+				+ mRotationTimes.size() * (sizeof(float) + sizeof(glm::quat))
+				+ mScaleTimes.size() * (sizeof(float) + sizeof(glm::vec3));
+		}
+
+	private:
+		friend class AnimationSampler;
+		friend class CompressedClip;
+
+		std::string mName;
+		float mDuration;
+		std::vector<Track> mTracks;
+
+		std::vector<float> mTranslationTimes;
+		std::vector<glm::vec3> mTranslations;
+		std::vector<float> mRotationTimes;
+		std::vector<glm::quat> mRotations;
+		std::vector<float> mScaleTimes;
+		std::vector<glm::vec3> mScales;
+	};
+
+	// Plays one clip on one skeleton. Every channel keeps a cursor on its current key, so
+	// forward playback only ever steps to the next key (amortized O(1)); a seek backwards or a
+	// loop wrap falls back to a binary search once and the cursors carry on from there.
+	class AnimationSampler {
+	public:
+		void setClip(const AnimationClip* clip);
+		const AnimationClip* getClip() const { return mClip; }
+
+		// <time> in seconds, wrapped into the clip when <loop> is set. Writes translation, rotation
+		// and scale of every animated node into <pose>, other nodes keep their values.
+		void sample(float time, LocalPose& pose, bool loop = true);
+		void sample(float time, Skeleton& skeleton, bool loop = true) { sample(time, skeleton.getLocalPose(), loop); }
+
+		uint32_t getSeekCount() const { return mSeeks; }
+
+	private:
+		struct Cursor {
+			uint32_t translation = 0, rotation = 0, scale = 0;
+		};
+
+		uint32_t advance(const std::vector<float>& times, const AnimationClip::KeyRange& range, uint32_t cursor, float time);
+
+		const AnimationClip* mClip = nullptr;
+		std::vector<Cursor> mCursors;
+		uint32_t mSeeks = 0;
+	};
+
+	// The synthetic character of the crowd and bake benchmarks: a bushy tree of <nodeCount> nodes whose
+	// last <boneCount> are bones, every node animated over the clip's duration by <keyCount> rotation keys
+	void buildBenchmarkCharacter(Skeleton& skeleton, AnimationClip& clip, uint32_t nodeCount, uint32_t boneCount, uint32_t keyCount);
+
+}
@@ -0,0 +1,152 @@
+#include "AnimationBaker.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "OpenGLUtil.h"
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		const GLuint kInstanceBinding = 6; // storage buffer binding in v_baked.glsl
+	}
+
+	BakedAnimation bakeAnimation(const AnimationClip& clip, const Ref<SkeletonDefinition>& definition, float frameRate) {
+		BakedAnimation baked;
+		baked.boneCount = static_cast<uint32_t>(definition->getBoneCount());
+		baked.duration = clip.getDuration();
+		baked.frameCount = std::max(1u, static_cast<uint32_t>(std::ceil(baked.duration * frameRate)));
+		baked.frameRate = baked.duration > 0.0f ? baked.frameCount / baked.duration : frameRate;
+		baked.texels.resize(static_cast<size_t>(baked.frameCount) * baked.getWidth());
+
+		Skeleton skeleton(definition);
+		AnimationSampler sampler;
+		sampler.setClip(&clip);
+		std::vector<glm::mat4> palette(baked.boneCount);
+
+		for (uint32_t f = 0; f < baked.frameCount; f++) {
+			sampler.sample(f / baked.frameRate, skeleton);
+			skeleton.calculateGlobalTransforms();
+			skeleton.calculateSkinningMatrices(palette.data());
+
+			glm::vec4* row = baked.texels.data() + static_cast<size_t>(f) * baked.getWidth();
+			for (uint32_t b = 0; b < baked.boneCount; b++) {
+				const glm::mat4& m = palette[b];
+				for (int r = 0; r < 3; r++)
+					row[b * 3 + r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+			}
+		}
+		return baked;
+	}
+
+	BakedCrowd::BakedCrowd(const BakedAnimation& animation, uint32_t textureUnit)
+		: mTextureUnit(textureUnit), mBoneCount(animation.boneCount), mFrameCount(animation.frameCount), mFrameRate(animation.frameRate) {
+		glCreateBuffers(1, &mInstanceBuffer);
+		glLabelObject(GL_BUFFER, mInstanceBuffer, "baked crowd instances");
+
+		if (animation.texels.empty())
+			return;
+
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		uint32_t limit = static_cast<uint32_t>(maxSize);
+		if (animation.getWidth() > limit) {
+			// a row is one frame of every bone and cannot be split; the crowd stays without a texture and draws nothing
+			std::cerr << "Baked animation of " << animation.boneCount << " bones needs " << animation.getWidth() << " texels a row, GL_MAX_TEXTURE_SIZE is " << maxSize << std::endl;
+			return;
+		}
+
+		// too many frames for one column: resample to the limit at a lower frame rate, nearest frame
+		const glm::vec4* texels = animation.texels.data();
+		std::vector<glm::vec4> resampled;
+		if (animation.frameCount > limit) {
+			std::cerr << "Baked animation of " << animation.frameCount << " frames exceeds GL_MAX_TEXTURE_SIZE " << maxSize << ", resampled to " << limit << " frames" << std::endl;
+			mFrameCount = limit;
+			mFrameRate = animation.frameRate * limit / animation.frameCount;
+			resampled.resize(static_cast<size_t>(limit) * animation.getWidth());
+			for (uint32_t f = 0; f < limit; f++) {
+				uint32_t source = std::min(animation.frameCount - 1, static_cast<uint32_t>(std::lround(static_cast<double>(f) * animation.frameCount / limit)));
+				std::copy_n(texels + static_cast<size_t>(source) * animation.getWidth(), animation.getWidth(), resampled.data() + static_cast<size_t>(f) * animation.getWidth());
+			}
+			texels = resampled.data();
+		}
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &mTexture);
+		glTextureStorage2D(mTexture, 1, GL_RGBA32F, animation.getWidth(), mFrameCount);
+		glTextureSubImage2D(mTexture, 0, 0, 0, animation.getWidth(), mFrameCount, GL_RGBA, GL_FLOAT, texels);
+		glTextureParameteri(mTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glLabelObject(GL_TEXTURE, mTexture, "baked palettes");
+		glCheckError("bake upload");
+	}
+
+	BakedCrowd::~BakedCrowd() {
+		glDeleteBuffers(1, &mInstanceBuffer);
+		if (mTexture)
+			glDeleteTextures(1, &mTexture);
+	}
+
+	uint32_t BakedCrowd::addInstance(const glm::mat4& model, float timeOffset, float speed) {
+		mInstances.push_back({ model, glm::vec4(timeOffset, speed, 0.0f, 0.0f) });
+		return static_cast<uint32_t>(mInstances.size() - 1);
+	}
+
+	uint32_t BakedCrowd::addMesh(const Ref<StaticMesh>& mesh) {
+		mMeshes.push_back(mesh);
+		return static_cast<uint32_t>(mMeshes.size() - 1);
+	}
+
+	void BakedCrowd::upload() {
+		if (!mInstances.empty())
+			glNamedBufferData(mInstanceBuffer, mInstances.size() * sizeof(Instance), mInstances.data(), GL_STATIC_DRAW);
+	}
+
+	void BakedCrowd::bind(ShaderProgram& shader, float time) {
+		glBindTextureUnit(mTextureUnit, mTexture);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kInstanceBinding, mInstanceBuffer);
+		glUniform1i(shader.u("uBakedPalettes"), mTextureUnit);
+		glUniform1f(shader.u("uTime"), time);
+		glUniform1f(shader.u("uFrameRate"), mFrameRate);
+		glUniform1i(shader.u("uFrameCount"), mFrameCount);
+		glUniform1i(shader.u("uBoneCount"), mBoneCount);
+	}
+
+	void BakedCrowd::drawMesh(uint32_t index, int subMesh) {
+		if (mInstances.empty() || !mTexture)
+			return;
+
+		const Ref<StaticMesh>& mesh = mMeshes[index];
+		mesh->bindSubMesh(subMesh);
+		const SubMesh& sub = mesh->getSubMesh(subMesh);
+		GLenum type = sub.mIndexFormat == IndexType::UInt32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+		glDrawElementsInstanced(GL_TRIANGLES, sub.getCount(), type, nullptr, static_cast<GLsizei>(mInstances.size()));
+	}
+
+	namespace {
+		void benchmarkAnimationBake(std::vector<BenchmarkResult>& results) {
+			// same character as the "crowd" benchmark: 70 nodes, 50 bones, a 2 s walk
+			const uint32_t nodes = 70, bones = 50, keys = 60;
+
+			Skeleton builder;
+			AnimationClip clip("walk", 2.0f);
+			buildBenchmarkCharacter(builder, clip, nodes, bones, keys);
+
+			BakedAnimation baked;
+			BenchmarkResult bake = runBenchmark("bake 2 s clip at 30 fps, 50 bones", 20, [&](uint32_t) {
+				baked = bakeAnimation(clip, builder.getDefinition());
+			});
+			bake.itemsPerIteration = baked.frameCount;
+			bake.itemName = "frame";
+			results.push_back(bake);
+
+			// what the same clip costs per frame when 1,000 instances evaluate their own skeleton
+			printf("[bench] baked: %ux%u texels, %zu KB for any number of instances (vs %zu KB of palettes per frame for 1000 live instances)\n",
+				baked.getWidth(), baked.frameCount, baked.getMemorySize() / 1024, static_cast<size_t>(1000) * bones * sizeof(glm::mat4) / 1024);
+		}
+
+		bool sRegistered = registerBenchmark("animation-bake", &benchmarkAnimationBake);
+	}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Base.h"
+#include "Mesh.h"
+#include "Animation.h"
+#include "shaderprogram.h"
+
+namespace Gizmo {
+
+	// Skinning palettes of one clip sampled at a fixed rate. Bone b of frame f is the top 3x4 of
+	// its skinning matrix, stored row by row in texels (b * 3 .. b * 3 + 2, f) of an RGBA32F texture.
+	// The frame rate is adjusted so frameCount frames span the clip exactly and playback can loop.
+	struct BakedAnimation {
+		uint32_t boneCount = 0;
+		uint32_t frameCount = 0;
+		float frameRate = 0.0f;
+		float duration = 0.0f;
+		std::vector<glm::vec4> texels; // frameCount rows of boneCount * 3 texels
+
+		uint32_t getWidth() const { return boneCount * 3; }
+		size_t getMemorySize() const { return texels.size() * sizeof(glm::vec4); }
+	};
+
+	BakedAnimation bakeAnimation(const AnimationClip& clip, const Ref<SkeletonDefinition>& definition, float frameRate = 30.0f);
+
+	// Background crowd played entirely from a baked palette texture: instances are a model matrix,
+	// a time offset and a speed in one storage buffer, and v_baked.glsl picks and blends the two
+	// frames around each instance's time itself. Nothing runs on the CPU per instance and frame.
+	class BakedCrowd {
+	public:
+		// a bake with more frames than GL_MAX_TEXTURE_SIZE is resampled down to it; one too wide for it
+		// leaves the crowd invalid, drawing nothing
+		BakedCrowd(const BakedAnimation& animation, uint32_t textureUnit = 7);
+		~BakedCrowd();
+
+		BakedCrowd(const BakedCrowd&) = delete;
+		BakedCrowd& operator=(const BakedCrowd&) = delete;
+
+		bool isValid() const { return mTexture != 0; }
+
+		uint32_t addInstance(const glm::mat4& model, float timeOffset, float speed = 1.0f);
+		uint32_t getInstanceCount() const { return static_cast<uint32_t>(mInstances.size()); }
+
+		// <mesh> uses the ProcessAiMesh vertex layout (bone ids and weights at locations 3 and 4)
+		uint32_t addMesh(const Ref<StaticMesh>& mesh);
+		uint32_t getMeshCount() const { return static_cast<uint32_t>(mMeshes.size()); }
+
+		// uploads the instance buffer, only needed after instances were added
+		void upload();
+
+		// binds texture and instances and sets the playback uniforms on <shader>, which must be in use
+		void bind(ShaderProgram& shader, float time);
+		void drawMesh(uint32_t index, int subMesh = 0);
+
+	private:
+		struct Instance {
+			glm::mat4 model;
+			glm::vec4 playback; // x time offset, y speed, std430 layout of v_baked.glsl
+		};
+
+		GLuint mTexture = 0;
+		GLuint mInstanceBuffer = 0;
+		uint32_t mTextureUnit;
+		uint32_t mBoneCount, mFrameCount;
+		float mFrameRate;
+		std::vector<Instance> mInstances;
+		std::vector<Ref<StaticMesh>> mMeshes;
+	};
+
+}
@@ -0,0 +1,409 @@
+#include "AnimationCompression.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		const float kTimeScale = 65535.0f;
+		const float kSqrt2 = 1.41421356f;
+		const uint32_t kMaxSteps = 4;
+
+		inline uint16_t quantizeUnit(float value) {
+			return static_cast<uint16_t>(std::lround(std::min(1.0f, std::max(0.0f, value)) * 65535.0f));
+		}
+
+		inline float quantizeTime(float time, float duration) {
+			return duration > 0.0f ? time / duration * kTimeScale : 0.0f;
+		}
+
+		float rotationError(const glm::quat& a, const glm::quat& b) {
+			float d = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+			return 2.0f * std::acos(std::min(1.0f, d));
+		}
+
+		// smallest-three, see CompressedClip
+		void encodeRotation(const glm::quat& q, uint16_t* out) {
+			float c[4] = { q.x, q.y, q.z, q.w };
+			uint32_t largest = 0;
+			for (uint32_t i = 1; i < 4; i++) {
+				if (std::fabs(c[i]) > std::fabs(c[largest]))
+					largest = i;
+			}
+			float sign = c[largest] < 0.0f ? -1.0f : 1.0f; // q and -q are the same rotation, keep the dropped one positive
+
+			uint16_t words[3];
+			for (uint32_t i = 0, j = 0; i < 4; i++) {
+				if (i == largest)
+					continue;
+				float unit = (c[i] * sign * kSqrt2) * 0.5f + 0.5f;
+				words[j++] = static_cast<uint16_t>(std::lround(std::min(1.0f, std::max(0.0f, unit)) * 32767.0f));
+			}
+			out[0] = static_cast<uint16_t>(((largest >> 1) << 15) | words[0]);
+			out[1] = static_cast<uint16_t>(((largest & 1) << 15) | words[1]);
+			out[2] = words[2];
+		}
+
+		glm::quat decodeRotation(const uint16_t* in) {
+			uint32_t largest = ((in[0] >> 15) << 1) | (in[1] >> 15);
+			float v[3];
+			for (int i = 0; i < 3; i++)
+				v[i] = ((in[i] & 0x7FFF) * (2.0f / 32767.0f) - 1.0f) / kSqrt2;
+
+			float c[4];
+			for (uint32_t i = 0, j = 0; i < 4; i++)
+				c[i] = i == largest ? 0.0f : v[j++];
+			c[largest] = std::sqrt(std::max(0.0f, 1.0f - v[0] * v[0] - v[1] * v[1] - v[2] * v[2]));
+			return glm::quat(c[3], c[0], c[1], c[2]);
+		}
+
+		// Greedy error-bounded reduction: extend the segment from the last kept key as long as every
+		// key it skips is rebuilt by interpolation within <tolerance>.
+		template<typename T, typename Lerp, typename Error>
+		std::vector<uint32_t> reduceKeys(const float* times, const T* values, uint32_t count, float tolerance, Lerp lerp, Error error) {
+			std::vector<uint32_t> kept;
+			kept.push_back(0);
+			uint32_t anchor = 0;
+			for (uint32_t end = anchor + 2; end < count; end++) {
+				float span = times[end] - times[anchor];
+				for (uint32_t k = anchor + 1; k < end; k++) {
+					float f = span > 0.0f ? (times[k] - times[anchor]) / span : 0.0f;
+					if (error(lerp(values[anchor], values[end], f), values[k]) > tolerance) {
+						anchor = end - 1;
+						kept.push_back(anchor);
+						break;
+					}
+				}
+			}
+			if (count > 1)
+				kept.push_back(count - 1);
+			return kept;
+		}
+
+		// Key times on the 16 bit clock. Keys closer than one tick, which long clips make likely, would
+		// share a time and leave a zero-length interval: the later key moves to the next free tick, and
+		// where none is left before the end it replaces the earlier one.
+		std::vector<uint16_t> quantizeKeyTimes(const float* times, std::vector<uint32_t>& kept, float duration) {
+			std::vector<uint16_t> quantized;
+			std::vector<uint32_t> merged;
+			for (uint32_t k : kept) {
+				long tick = std::min(std::max(std::lround(quantizeTime(times[k], duration)), 0L), static_cast<long>(kTimeScale));
+				if (!quantized.empty() && tick <= quantized.back()) {
+					if (quantized.back() == static_cast<uint16_t>(kTimeScale)) {
+						merged.back() = k;
+						continue;
+					}
+					tick = quantized.back() + 1;
+				}
+				quantized.push_back(static_cast<uint16_t>(tick));
+				merged.push_back(k);
+			}
+			kept.swap(merged);
+			return quantized;
+		}
+
+		void compressVec3(const std::vector<float>& times, const std::vector<glm::vec3>& values, const AnimationClip::KeyRange& range,
+			float tolerance, float duration, CompressedClip::Channel& channel,
+			std::vector<uint16_t>& outTimes, std::vector<uint16_t>& outValues, uint32_t& constants) {
+			if (range.count == 0) {
+				channel.animated = false;
+				return;
+			}
+			const float* t = times.data() + range.first;
+			const glm::vec3* v = values.data() + range.first;
+
+			bool constant = true;
+			for (uint32_t k = 1; k < range.count && constant; k++)
+				constant = glm::length(v[k] - v[0]) <= tolerance;
+			if (constant) {
+				channel.keyCount = 0;
+				channel.base = glm::vec4(v[0], 0.0f);
+				constants++;
+				return;
+			}
+
+			std::vector<uint32_t> kept = reduceKeys(t, v, range.count, tolerance,
+				[](const glm::vec3& a, const glm::vec3& b, float f) { return glm::mix(a, b, f); },
+				[](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); });
+			std::vector<uint16_t> keyTimes = quantizeKeyTimes(t, kept, duration);
+
+			glm::vec3 lo = v[kept[0]], hi = v[kept[0]];
+			for (uint32_t k : kept) {
+				lo = glm::min(lo, v[k]);
+				hi = glm::max(hi, v[k]);
+			}
+
+			channel.firstKey = static_cast<uint32_t>(outTimes.size());
+			channel.keyCount = static_cast<uint32_t>(kept.size());
+			channel.base = glm::vec4(lo, 0.0f);
+			channel.extent = hi - lo;
+			outTimes.insert(outTimes.end(), keyTimes.begin(), keyTimes.end());
+			for (uint32_t k : kept) {
+				for (int c = 0; c < 3; c++)
+					outValues.push_back(channel.extent[c] > 0.0f ? quantizeUnit((v[k][c] - lo[c]) / channel.extent[c]) : 0);
+			}
+		}
+
+		void compressRotation(const std::vector<float>& times, const std::vector<glm::quat>& values, const AnimationClip::KeyRange& range,
+			float tolerance, float duration, CompressedClip::Channel& channel,
+			std::vector<uint16_t>& outTimes, std::vector<uint16_t>& outValues, uint32_t& constants) {
+			if (range.count == 0) {
+				channel.animated = false;
+				return;
+			}
+			const float* t = times.data() + range.first;
+			const glm::quat* v = values.data() + range.first;
+
+			bool constant = true;
+			for (uint32_t k = 1; k < range.count && constant; k++)
+				constant = rotationError(v[k], v[0]) <= tolerance;
+			if (constant) {
+				glm::quat q = v[0];
+				channel.keyCount = 0;
+				channel.base = glm::vec4(q.x, q.y, q.z, q.w);
+				constants++;
+				return;
+			}
+
+			std::vector<uint32_t> kept = reduceKeys(t, v, range.count, tolerance,
+				[](const glm::quat& a, const glm::quat& b, float f) { return glm::slerp(a, b, f); },
+				[](const glm::quat& a, const glm::quat& b) { return rotationError(a, b); });
+			std::vector<uint16_t> keyTimes = quantizeKeyTimes(t, kept, duration);
+
+			channel.firstKey = static_cast<uint32_t>(outTimes.size());
+			channel.keyCount = static_cast<uint32_t>(kept.size());
+			outTimes.insert(outTimes.end(), keyTimes.begin(), keyTimes.end());
+			for (uint32_t k : kept) {
+				uint16_t words[3];
+				encodeRotation(glm::normalize(v[k]), words);
+				outValues.insert(outValues.end(), words, words + 3);
+			}
+		}
+
+		// same contract as AnimationSampler::advance, on 16 bit times
+		uint32_t advanceCursor(const uint16_t* keys, uint32_t count, uint32_t cursor, float time) {
+			if (count < 2)
+				return 0;
+			if (time >= keys[cursor]) {
+				for (uint32_t steps = 0; steps < kMaxSteps; steps++) {
+					if (cursor + 2 >= count || keys[cursor + 1] > time)
+						return cursor;
+					cursor++;
+				}
+			}
+			const uint16_t* next = std::upper_bound(keys, keys + count - 1, time, [](float t, uint16_t key) { return t < key; });
+			return next == keys ? 0 : static_cast<uint32_t>(next - keys - 1);
+		}
+
+		inline float cursorFactor(const uint16_t* keys, uint32_t count, uint32_t cursor, float time) {
+			if (cursor + 1 >= count)
+				return 0.0f;
+			float span = static_cast<float>(keys[cursor + 1] - keys[cursor]);
+			return span > 0.0f ? std::min(1.0f, std::max(0.0f, (time - keys[cursor]) / span)) : 0.0f;
+		}
+
+		inline glm::vec3 decodeVec3(const CompressedClip::Channel& channel, const uint16_t* words) {
+			return glm::vec3(channel.base.x + channel.extent.x * (words[0] * (1.0f / 65535.0f)),
+				channel.base.y + channel.extent.y * (words[1] * (1.0f / 65535.0f)),
+				channel.base.z + channel.extent.z * (words[2] * (1.0f / 65535.0f)));
+		}
+
+		glm::vec3 sampleVec3(const CompressedClip::Channel& channel, const std::vector<uint16_t>& times, const std::vector<uint16_t>& values, uint32_t& cursor, float time) {
+			if (channel.keyCount == 0)
+				return glm::vec3(channel.base);
+
+			const uint16_t* keys = times.data() + channel.firstKey;
+			cursor = advanceCursor(keys, channel.keyCount, cursor, time);
+			const uint16_t* words = values.data() + (static_cast<size_t>(channel.firstKey) + cursor) * 3;
+			glm::vec3 a = decodeVec3(channel, words);
+			float f = cursorFactor(keys, channel.keyCount, cursor, time);
+			return f > 0.0f ? glm::mix(a, decodeVec3(channel, words + 3), f) : a;
+		}
+
+		glm::quat sampleRotation(const CompressedClip::Channel& channel, const std::vector<uint16_t>& times, const std::vector<uint16_t>& values, uint32_t& cursor, float time) {
+			if (channel.keyCount == 0)
+				return glm::quat(channel.base.w, channel.base.x, channel.base.y, channel.base.z);
+
+			const uint16_t* keys = times.data() + channel.firstKey;
+			cursor = advanceCursor(keys, channel.keyCount, cursor, time);
+			const uint16_t* words = values.data() + (static_cast<size_t>(channel.firstKey) + cursor) * 3;
+			glm::quat a = decodeRotation(words);
+			float f = cursorFactor(keys, channel.keyCount, cursor, time);
+			return f > 0.0f ? glm::slerp(a, decodeRotation(words + 3), f) : a;
+		}
+	}
+
+	void CompressedClip::compress(const AnimationClip& clip, const CompressionSettings& settings) {
+		mName = clip.mName;
+		mDuration = clip.mDuration;
+		mConstantChannels = 0;
+		mTracks.clear();
+		mTranslationTimes.clear(); mRotationTimes.clear(); mScaleTimes.clear();
+		mTranslations.clear(); mRotations.clear(); mScales.clear();
+
+		for (const AnimationClip::Track& source : clip.mTracks) {
+			Track track;
+			track.node = source.node;
+			compressVec3(clip.mTranslationTimes, clip.mTranslations, source.translation, settings.translationTolerance, mDuration,
+				track.translation, mTranslationTimes, mTranslations, mConstantChannels);
+			compressRotation(clip.mRotationTimes, clip.mRotations, source.rotation, settings.rotationTolerance, mDuration,
+				track.rotation, mRotationTimes, mRotations, mConstantChannels);
+			compressVec3(clip.mScaleTimes, clip.mScales, source.scale, settings.scaleTolerance, mDuration,
+				track.scale, mScaleTimes, mScales, mConstantChannels);
+			mTracks.push_back(track);
+		}
+	}
+
+	size_t CompressedClip::getMemorySize() const {
+		return mTracks.size() * sizeof(Track)
+			+ (mTranslationTimes.size() + mRotationTimes.size() + mScaleTimes.size()) * sizeof(uint16_t)
+			+ (mTranslations.size() + mRotations.size() + mScales.size()) * sizeof(uint16_t);
+	}
+
+	void CompressedClipSampler::setClip(const CompressedClip* clip) {
+		mClip = clip;
+		mCursors.assign(clip ? clip->getTrackCount() : 0, Cursor());
+	}
+
+	void CompressedClipSampler::sample(float time, LocalPose& pose, bool loop) {
+		if (!mClip)
+			return;
+
+		const CompressedClip& clip = *mClip;
+		float duration = clip.mDuration;
+		if (duration > 0.0f) {
+			time = loop ? std::fmod(time, duration) : std::min(time, duration);
+			if (time < 0.0f)
+				time += duration;
+		}
+		float keyTime = quantizeTime(time, duration);
+
+		for (uint32_t i = 0; i < clip.getTrackCount(); i++) {
+			const CompressedClip::Track& track = clip.mTracks[i];
+			Cursor& cursor = mCursors[i];
+
+			if (track.translation.animated)
+				pose.translations[track.node] = sampleVec3(track.translation, clip.mTranslationTimes, clip.mTranslations, cursor.translation, keyTime);
+			if (track.rotation.animated)
+				pose.rotations[track.node] = sampleRotation(track.rotation, clip.mRotationTimes, clip.mRotations, cursor.rotation, keyTime);
+			if (track.scale.animated)
+				pose.scales[track.node] = sampleVec3(track.scale, clip.mScaleTimes, clip.mScales, cursor.scale, keyTime);
+		}
+	}
+
+	CompressionReport measureCompression(const AnimationClip& raw, const CompressedClip& compressed, const Skeleton& skeleton, float sampleRate) {
+		CompressionReport report;
+		report.rawBytes = raw.getMemorySize();
+		report.compressedBytes = compressed.getMemorySize();
+		report.keysIn = raw.getKeyCount();
+		report.keysOut = compressed.getKeyCount();
+		report.constantChannels = compressed.getConstantChannelCount();
+		// aiVectorKey and aiQuatKey are both a double time plus the value, 24 bytes each
+		report.assimpBytes = static_cast<size_t>(report.keysIn) * 24;
+
+		Skeleton reference = skeleton, decoded = skeleton;
+		AnimationSampler rawSampler;
+		CompressedClipSampler compressedSampler;
+		rawSampler.setClip(&raw);
+		compressedSampler.setClip(&compressed);
+
+		uint32_t samples = static_cast<uint32_t>(raw.getDuration() * sampleRate) + 1;
+		for (uint32_t s = 0; s < samples; s++) {
+			float time = std::min(raw.getDuration(), s / sampleRate);
+			rawSampler.sample(time, reference, false);
+			compressedSampler.sample(time, decoded, false);
+			reference.calculateGlobalTransforms();
+			decoded.calculateGlobalTransforms();
+
+			for (int n = 0; n < reference.getNodeCount(); n++) {
+				glm::vec3 a(reference.getGlobalTransform(n)[3]);
+				glm::vec3 b(decoded.getGlobalTransform(n)[3]);
+				report.maxWorldError = std::max(report.maxWorldError, glm::length(a - b));
+			}
+		}
+		return report;
+	}
+
+	namespace {
+		// a 60-bone chain with a 10 s mocap-like clip at 30 keys/s: smooth rotations, some static channels
+		void makeBenchmarkClip(AnimationClip& clip, Skeleton& skeleton, uint32_t bones) {
+			std::mt19937 rng(17);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			const uint32_t keys = 300;
+			const float duration = 10.0f;
+
+			clip = AnimationClip("bench", duration);
+			for (uint32_t b = 0; b < bones; b++) {
+				glm::mat4 offset(1.0f);
+				offset[3] = glm::vec4(0.0f, 0.1f, 0.0f, 1.0f);
+				skeleton.addNode("bone" + std::to_string(b), b == 0 ? -1 : b - 1, offset);
+
+				float frequency = 0.5f + unit(rng) * 0.4f, phase = unit(rng) * 3.0f, amplitude = 0.3f * unit(rng);
+				bool animatedTranslation = b == 0;
+				clip.beginTrack(b);
+				for (uint32_t k = 0; k < keys; k++) {
+					float t = duration * k / (keys - 1);
+					clip.addTranslationKey(t, animatedTranslation ? glm::vec3(std::sin(t), 0.1f, std::cos(t * 0.5f)) : glm::vec3(0.0f, 0.1f, 0.0f));
+				}
+				for (uint32_t k = 0; k < keys; k++) {
+					float t = duration * k / (keys - 1);
+					float angle = amplitude * std::sin(frequency * t + phase);
+					clip.addRotationKey(t, glm::quat(std::cos(angle * 0.5f), std::sin(angle * 0.5f), 0.0f, 0.0f));
+				}
+				for (uint32_t k = 0; k < keys; k++)
+					clip.addScaleKey(duration * k / (keys - 1), glm::vec3(1.0f));
+			}
+		}
+
+		void benchmarkAnimationCompression(std::vector<BenchmarkResult>& results) {
+			AnimationClip clip;
+			Skeleton skeleton;
+			makeBenchmarkClip(clip, skeleton, 60);
+
+			CompressedClip compressed;
+			BenchmarkResult compress = runBenchmark("compress clip (60 bones, 10 s)", 5, [&](uint32_t) { compressed.compress(clip); });
+			compress.itemsPerIteration = clip.getKeyCount();
+			compress.itemName = "key";
+			results.push_back(compress);
+
+			CompressionReport report = measureCompression(clip, compressed, skeleton);
+			printf("[bench] compression: %zu -> %zu bytes (%.1fx, %.1fx vs assimp keys), %u -> %u keys, %u constant channels, max world error %.5f\n",
+				report.rawBytes, report.compressedBytes, report.ratio(), report.compressedBytes ? double(report.assimpBytes) / report.compressedBytes : 0.0,
+				report.keysIn, report.keysOut, report.constantChannels, report.maxWorldError);
+
+			// decode throughput, 100 characters playing the compressed clip
+			const uint32_t characters = 100;
+			std::vector<Skeleton> skeletons(characters, skeleton);
+			std::vector<CompressedClipSampler> samplers(characters);
+			for (CompressedClipSampler& sampler : samplers)
+				sampler.setClip(&compressed);
+
+			const float dt = 1.0f / 60.0f;
+			BenchmarkResult decode = runBenchmark("decode compressed, 100 x 60 bones", 600, [&](uint32_t frame) {
+				for (uint32_t c = 0; c < characters; c++)
+					samplers[c].sample(frame * dt + c * 0.05f, skeletons[c]);
+			});
+			decode.itemsPerIteration = characters * clip.getTrackCount();
+			decode.itemName = "bone";
+			results.push_back(decode);
+
+			std::vector<AnimationSampler> rawSamplers(characters);
+			for (AnimationSampler& sampler : rawSamplers)
+				sampler.setClip(&clip);
+			BenchmarkResult raw = runBenchmark("sample raw, 100 x 60 bones", 600, [&](uint32_t frame) {
+				for (uint32_t c = 0; c < characters; c++)
+					rawSamplers[c].sample(frame * dt + c * 0.05f, skeletons[c]);
+			});
+			raw.itemsPerIteration = characters * clip.getTrackCount();
+			raw.itemName = "bone";
+			results.push_back(raw);
+		}
+
+		bool sRegistered = registerBenchmark("animation-compression", &benchmarkAnimationCompression);
+	}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Animation.h"
+
+namespace Gizmo {
+
+	struct CompressionSettings {
+		float translationTolerance = 0.0005f; // scene units
+		float rotationTolerance = 0.001f;     // radians
+		float scaleTolerance = 0.0005f;
+	};
+
+	// Compressed form of an AnimationClip:
+	//  - constant channels keep a single float value and no keys
+	//  - the other channels keep only the keys that linear (slerp) interpolation cannot rebuild within tolerance
+	//  - key times are 16 bit fractions of the clip duration
+	//  - translations and scales are 16 bit per component inside the channel's bounding box
+	//  - rotations are smallest-three: the largest component is dropped, the other three are stored in
+	//    15 bits each and the index of the dropped one in the top bits of the first two words
+	class CompressedClip {
+	public:
+		struct Channel {
+			uint32_t firstKey = 0;
+			uint32_t keyCount = 0;   // 0 = constant channel
+			bool animated = true;    // false when the source had no keys, the sampler leaves the pose alone
+			glm::vec4 base;          // constant value, or quantization minimum for translation/scale
+			glm::vec3 extent;        // quantization range for translation/scale
+		};
+
+		struct Track {
+			uint32_t node;
+			Channel translation, rotation, scale;
+		};
+
+		void compress(const AnimationClip& clip, const CompressionSettings& settings = CompressionSettings());
+
+		const std::string& getName() const { return mName; }
+		float getDuration() const { return mDuration; }
+		uint32_t getTrackCount() const { return static_cast<uint32_t>(mTracks.size()); }
+		const Track& getTrack(uint32_t index) const { return mTracks[index]; }
+
+		uint32_t getKeyCount() const { return static_cast<uint32_t>(mTranslationTimes.size() + mRotationTimes.size() + mScaleTimes.size()); }
+		uint32_t getConstantChannelCount() const { return mConstantChannels; }
+		size_t getMemorySize() const;
+
+	private:
+		friend class CompressedClipSampler;
+
+		std::string mName;
+		float mDuration = 0.0f;
+		uint32_t mConstantChannels = 0;
+		std::vector<Track> mTracks;
+
+		std::vector<uint16_t> mTranslationTimes, mRotationTimes, mScaleTimes;
+		std::vector<uint16_t> mTranslations, mRotations, mScales; // three words per key
+	};
+
+	// Decodes a CompressedClip straight into the skeleton's local transforms. Only the two keys
+	// around the playhead of each channel are dequantized; cursors advance like AnimationSampler's.
+	class CompressedClipSampler {
+	public:
+		void setClip(const CompressedClip* clip);
+		const CompressedClip* getClip() const { return mClip; }
+
+		void sample(float time, LocalPose& pose, bool loop = true);
+		void sample(float time, Skeleton& skeleton, bool loop = true) { sample(time, skeleton.getLocalPose(), loop); }
+
+	private:
+		struct Cursor {
+			uint32_t translation = 0, rotation = 0, scale = 0;
+		};
+
+		const CompressedClip* mClip = nullptr;
+		std::vector<Cursor> mCursors;
+	};
+
+	struct CompressionReport {
+		size_t rawBytes = 0;          // AnimationClip key store
+		size_t assimpBytes = 0;       // the same keys as aiVectorKey / aiQuatKey
+		size_t compressedBytes = 0;
+		uint32_t keysIn = 0, keysOut = 0;
+		uint32_t constantChannels = 0;
+		float maxWorldError = 0.0f;   // largest node position difference over the clip, in scene units
+
+		double ratio() const { return compressedBytes ? static_cast<double>(rawBytes) / compressedBytes : 0.0; }
+	};
+
+	// Plays both clips on copies of <skeleton> at <sampleRate> Hz and compares the global node positions.
+	CompressionReport measureCompression(const AnimationClip& raw, const CompressedClip& compressed, const Skeleton& skeleton, float sampleRate = 60.0f);
+
+}
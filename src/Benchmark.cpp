@@ -0,0 +1,51 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+
+namespace Gizmo {
+
+	namespace {
+		struct RegisteredBenchmark {
+			const char* name;
+			BenchmarkFn fn;
+		};
+
+		std::vector<RegisteredBenchmark>& registry() {
+			static std::vector<RegisteredBenchmark> benchmarks;
+			return benchmarks;
+		}
+	}
+
+	bool registerBenchmark(const char* name, BenchmarkFn fn) {
+		registry().push_back({ name, fn });
+		return true;
+	}
+
+	int runBenchmarks(const std::string& filter) {
+		int ran = 0;
+		for (const RegisteredBenchmark& benchmark : registry()) {
+			if (!filter.empty() && std::string(benchmark.name).find(filter) == std::string::npos)
+				continue;
+
+			printf("[bench] --- %s ---\n", benchmark.name);
+			std::vector<BenchmarkResult> results;
+			benchmark.fn(results);
+			for (const BenchmarkResult& result : results)
+				printBenchmark(result);
+			ran++;
+		}
+
+		if (ran == 0)
+			printf("[bench] no benchmark matches '%s'\n", filter.c_str());
+		return ran;
+	}
+
+	void printBenchmark(const BenchmarkResult& result) {
+		printf("[bench] %-40s %6u it  mean %9.4f ms  min %9.4f ms  max %9.4f ms",
+			result.name.c_str(), result.iterations, result.meanMs(), result.minMs, result.maxMs);
+		if (result.itemsPerIteration > 0.0)
+			printf("  %.3g %s/s", result.itemsPerSecond(), result.itemName);
+		printf("\n");
+	}
+
+}
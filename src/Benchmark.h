@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace Gizmo {
+
+	class Timer {
+	public:
+		Timer() { reset(); }
+
+		void reset() { mStart = std::chrono::steady_clock::now(); }
+		double elapsedMs() const {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point mStart;
+	};
+
+	struct BenchmarkResult {
+		std::string name;
+		uint32_t iterations = 0;
+		double totalMs = 0.0, minMs = 0.0, maxMs = 0.0;
+		double itemsPerIteration = 0.0; // optional, turns into a throughput column
+		const char* itemName = "";
+
+		double meanMs() const { return iterations ? totalMs / iterations : 0.0; }
+		double itemsPerSecond() const { return totalMs > 0.0 ? itemsPerIteration * iterations / (totalMs * 1e-3) : 0.0; }
+	};
+
+	template<typename Fn>
+	BenchmarkResult runBenchmark(const std::string& name, uint32_t iterations, Fn&& fn) {
+		BenchmarkResult result;
+		result.name = name;
+		result.iterations = iterations;
+		result.minMs = 1e30;
+
+		for (uint32_t i = 0; i < iterations; i++) {
+			Timer timer;
+			fn(i);
+			double ms = timer.elapsedMs();
+			result.totalMs += ms;
+			result.minMs = std::min(result.minMs, ms);
+			result.maxMs = std::max(result.maxMs, ms);
+		}
+		return result;
+	}
+
+	void printBenchmark(const BenchmarkResult& result);
+
+	// Modules register their benchmarks at static-init time; `Gizmos --bench <filter>` runs the ones
+	// whose name contains <filter> after the context and the model are up (use --backend egl on CI).
+	using BenchmarkFn = void(*)(std::vector<BenchmarkResult>& results);
+	bool registerBenchmark(const char* name, BenchmarkFn fn);
+	// returns the number of benchmarks that ran
+	int runBenchmarks(const std::string& filter);
+
+}
@@ -1,16 +1,18 @@
 #include "Buffer.h"
 #include <GL/glew.h>
 
+#include "OpenGLUtil.h"
+
 namespace Gizmo {
 
-	VertexBuffer::VertexBuffer(uint32_t size) {
+	VertexBuffer::VertexBuffer(uint32_t size) : m_tracking(ResourceCategory::VertexBuffer, size, "vertex buffer") {
 		glCreateBuffers(1, &m_vertexBufferID);
 		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
 		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	};
 
-	VertexBuffer::VertexBuffer(float* vertices, uint32_t size) {
+	VertexBuffer::VertexBuffer(float* vertices, uint32_t size) : m_tracking(ResourceCategory::VertexBuffer, size, "vertex buffer") {
 		glCreateBuffers(1, &m_vertexBufferID);
 		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
 		glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
@@ -33,7 +35,13 @@ namespace Gizmo {
 		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
 	};
 
-	IndexBuffer::IndexBuffer(uint32_t* indices, uint32_t count) : m_count(count), mIndexForamt(IndexType::UInt32) {
+	void VertexBuffer::SetName(const std::string& name) {
+		m_tracking.rename(name);
+		glLabelObject(GL_BUFFER, m_vertexBufferID, name.c_str());
+	};
+
+	IndexBuffer::IndexBuffer(uint32_t* indices, uint32_t count)
+		: m_count(count), m_tracking(ResourceCategory::IndexBuffer, count * sizeof(uint32_t), "index buffer"), mIndexForamt(IndexType::UInt32) {
 
 		glCreateBuffers(1, &m_indexBufferID);
 		glBindBuffer(GL_ARRAY_BUFFER, m_indexBufferID);
@@ -41,14 +49,16 @@ namespace Gizmo {
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	};
 
-	IndexBuffer::IndexBuffer(uint16_t* indices, uint32_t count) : m_count(count), mIndexForamt(IndexType::UInt16) {
+	IndexBuffer::IndexBuffer(uint16_t* indices, uint32_t count)
+		: m_count(count), m_tracking(ResourceCategory::IndexBuffer, count * sizeof(uint16_t), "index buffer"), mIndexForamt(IndexType::UInt16) {
 		glCreateBuffers(1, &m_indexBufferID);
 		glBindBuffer(GL_ARRAY_BUFFER, m_indexBufferID);
 		glBufferData(GL_ARRAY_BUFFER, m_count * sizeof(uint16_t), indices, GL_DYNAMIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	};
 
-	IndexBuffer::IndexBuffer(uint8_t* indices, uint32_t count, IndexType indexFormat) : m_count(count), mIndexForamt(indexFormat) {
+	IndexBuffer::IndexBuffer(uint8_t* indices, uint32_t count, IndexType indexFormat)
+		: m_count(count), m_tracking(ResourceCategory::IndexBuffer, count * (indexFormat == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t)), "index buffer"), mIndexForamt(indexFormat) {
 		glCreateBuffers(1, &m_indexBufferID);
 		glBindBuffer(GL_ARRAY_BUFFER, m_indexBufferID);
 		if(indexFormat == IndexType::UInt16){
@@ -63,6 +73,11 @@ namespace Gizmo {
 		glDeleteBuffers(1, &m_indexBufferID);
 	};
 
+	void IndexBuffer::SetName(const std::string& name) {
+		m_tracking.rename(name);
+		glLabelObject(GL_BUFFER, m_indexBufferID, name.c_str());
+	};
+
 	void IndexBuffer::Bind() const {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
 	};
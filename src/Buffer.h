@@ -2,10 +2,13 @@
 #include <GL/glew.h>
 
 #include <vector>
+#include <string>
 
 #include <cassert>
 #define assertm(exp, msg) assert((void(msg), exp))
 
+#include "ResourceRegistry.h"
+
 namespace Gizmo {
 	enum ShaderDataType { None = 0, Float, Float2, Float3, Float4, Int, Int2, Int3 };
 
@@ -112,12 +115,18 @@ namespace Gizmo {
 
 		void SetData(const void* data, uint32_t size, uint32_t offset = 0);
 
+		uint32_t GetID() const { return m_vertexBufferID; }
+
 		const BufferLayout& GetLayout() const { return m_Layout; };
 		void SetLayout(const BufferLayout& layout) { m_Layout = layout; };
 
+		// debug name in the resource registry and GL debug output
+		void SetName(const std::string& name);
+
 	private:
 		uint32_t m_vertexBufferID;
 		BufferLayout m_Layout;
+		TrackedResource m_tracking;
 	};
 
 	enum class IndexType { UInt16, UInt32 }; 
@@ -133,9 +142,13 @@ namespace Gizmo {
 		void Unbind() const;
 
 		virtual uint32_t GetCount() const { return m_count; }
+		uint32_t GetID() const { return m_indexBufferID; }
+
+		void SetName(const std::string& name);
 	private:
 		uint32_t m_indexBufferID;
 		uint32_t m_count;
+		TrackedResource m_tracking;
 
 		IndexType mIndexForamt; 
 	};
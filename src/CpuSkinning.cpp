@@ -0,0 +1,330 @@
+#include "CpuSkinning.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include "Benchmark.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GIZMOS_SKINNING_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Gizmo {
+
+	namespace {
+		// below this a range is not worth waking a worker for
+		const uint32_t kMinVerticesPerChunk = 2048;
+
+		// how far the weights of a vertex may sum away from one for getPosedBounds to still hold
+		const float kBlendTolerance = 1e-3f;
+
+		const float kIdentity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+		// Blended matrix of a vertex, column-major like glm. Mirrors v_texture.glsl: unused slots
+		// are -1, an id outside the palette leaves the vertex in bind pose.
+		inline bool collectInfluences(const SkinningSource::Vertex& v, uint32_t paletteSize, int32_t* bones, float* weights, uint32_t& count) {
+			count = 0;
+			for (uint32_t k = 0; k < CpuSkinning::kMaxInfluences; k++) {
+				int32_t bone = v.bones[k];
+				if (bone < 0)
+					continue;
+				if (static_cast<uint32_t>(bone) >= paletteSize)
+					return false;
+				bones[count] = bone;
+				weights[count] = v.weights[k];
+				count++;
+			}
+			return count > 0;
+		}
+
+		void skinRangeScalar(const SkinningSource::Vertex* vertices, const float* palette, uint32_t paletteSize,
+			glm::vec3* positions, glm::vec3* normals, uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				const SkinningSource::Vertex& v = vertices[i];
+
+				float m[16];
+				int32_t bones[CpuSkinning::kMaxInfluences];
+				float weights[CpuSkinning::kMaxInfluences];
+				uint32_t count;
+				if (collectInfluences(v, paletteSize, bones, weights, count)) {
+					std::fill(m, m + 16, 0.0f);
+					for (uint32_t k = 0; k < count; k++) {
+						const float* bone = palette + bones[k] * 16;
+						for (int j = 0; j < 16; j++)
+							m[j] += weights[k] * bone[j];
+					}
+				}
+				else {
+					std::copy(kIdentity, kIdentity + 16, m);
+				}
+
+				const float* p = v.position;
+				const float* n = v.normal;
+				positions[i] = glm::vec3(
+					m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12],
+					m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+					m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+
+				float nx = m[0] * n[0] + m[4] * n[1] + m[8] * n[2];
+				float ny = m[1] * n[0] + m[5] * n[1] + m[9] * n[2];
+				float nz = m[2] * n[0] + m[6] * n[1] + m[10] * n[2];
+				float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+				float scale = length > 0.0f ? 1.0f / length : 0.0f;
+				normals[i] = glm::vec3(nx * scale, ny * scale, nz * scale);
+			}
+		}
+
+#ifdef GIZMOS_SKINNING_SSE
+		void skinRangeSSE(const SkinningSource::Vertex* vertices, const float* palette, uint32_t paletteSize,
+			glm::vec3* positions, glm::vec3* normals, uint32_t begin, uint32_t end) {
+			const __m128 identity0 = _mm_setr_ps(1, 0, 0, 0), identity1 = _mm_setr_ps(0, 1, 0, 0);
+			const __m128 identity2 = _mm_setr_ps(0, 0, 1, 0), identity3 = _mm_setr_ps(0, 0, 0, 1);
+			const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+			alignas(16) float out[4];
+			for (uint32_t i = begin; i < end; i++) {
+				const SkinningSource::Vertex& v = vertices[i];
+
+				__m128 c0, c1, c2, c3;
+				int32_t bones[CpuSkinning::kMaxInfluences];
+				float weights[CpuSkinning::kMaxInfluences];
+				uint32_t count;
+				if (collectInfluences(v, paletteSize, bones, weights, count)) {
+					c0 = c1 = c2 = c3 = _mm_setzero_ps();
+					for (uint32_t k = 0; k < count; k++) {
+						// the palette is a plain std::vector<glm::mat4>, no 16 byte alignment guarantee
+						const float* bone = palette + bones[k] * 16;
+						__m128 w = _mm_set1_ps(weights[k]);
+						c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(bone + 0)));
+						c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(bone + 4)));
+						c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(bone + 8)));
+						c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(bone + 12)));
+					}
+				}
+				else {
+					c0 = identity0; c1 = identity1; c2 = identity2; c3 = identity3;
+				}
+
+				__m128 p = _mm_load_ps(v.position);
+				__m128 pos = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(c1, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)))),
+					_mm_add_ps(_mm_mul_ps(c2, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2))), c3));
+				_mm_store_ps(out, pos);
+				positions[i] = glm::vec3(out[0], out[1], out[2]);
+
+				__m128 n = _mm_load_ps(v.normal);
+				__m128 nrm = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(n, n, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(c1, _mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 1, 1, 1)))),
+					_mm_mul_ps(c2, _mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 2, 2, 2))));
+
+				nrm = _mm_and_ps(nrm, xyzMask);
+				__m128 sq = _mm_mul_ps(nrm, nrm);
+				sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+				sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+				__m128 length = _mm_sqrt_ps(sq);
+				__m128 valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+				nrm = _mm_and_ps(_mm_div_ps(nrm, length), valid);
+				_mm_store_ps(out, nrm);
+				normals[i] = glm::vec3(out[0], out[1], out[2]);
+			}
+		}
+#endif
+	}
+
+	void SkinningSource::build(const StaticMesh& mesh, const SkinnedVertexLayout& layout) {
+		build(mesh.getVertices(), mesh.getVertexStride(), layout);
+	}
+
+	void SkinningSource::build(const std::vector<float>& vertices, uint32_t stride, const SkinnedVertexLayout& layout) {
+		uint32_t count = stride ? static_cast<uint32_t>(vertices.size() / stride) : 0;
+		mVertices.resize(count);
+		mBoneBounds.clear();
+		mUnskinnedBounds = Bounds();
+		mBlended = true;
+
+		for (uint32_t i = 0; i < count; i++) {
+			const float* src = vertices.data() + static_cast<size_t>(i) * stride;
+			Vertex& v = mVertices[i];
+			for (int k = 0; k < 3; k++) {
+				v.position[k] = src[layout.positionOffset + k];
+				v.normal[k] = src[layout.normalOffset + k];
+			}
+			v.position[3] = 1.0f;
+			v.normal[3] = 0.0f;
+			for (int k = 0; k < 4; k++) {
+				// ids are stored as floats for the vertex attribute, -1 marks an empty slot
+				v.bones[k] = static_cast<int32_t>(src[layout.boneIDOffset + k]);
+				v.weights[k] = src[layout.weightOffset + k];
+			}
+
+			// a posed vertex is a weighted average of its bones' transforms of it, so it stays inside
+			// the union of the posed boxes of those bones
+			const glm::vec3 position(v.position[0], v.position[1], v.position[2]);
+			float weightSum = 0.0f;
+			bool influenced = false;
+			for (uint32_t k = 0; k < CpuSkinning::kMaxInfluences; k++) {
+				if (v.bones[k] < 0)
+					continue;
+				if (static_cast<size_t>(v.bones[k]) >= mBoneBounds.size())
+					mBoneBounds.resize(v.bones[k] + 1);
+				Bounds& bounds = mBoneBounds[v.bones[k]];
+				bounds.min = glm::min(bounds.min, position);
+				bounds.max = glm::max(bounds.max, position);
+				mBlended = mBlended && v.weights[k] >= 0.0f;
+				weightSum += v.weights[k];
+				influenced = true;
+			}
+			if (!influenced) {
+				mUnskinnedBounds.min = glm::min(mUnskinnedBounds.min, position);
+				mUnskinnedBounds.max = glm::max(mUnskinnedBounds.max, position);
+			}
+			else if (std::fabs(weightSum - 1.0f) > kBlendTolerance) {
+				mBlended = false;
+			}
+		}
+	}
+
+	bool SkinningSource::getPosedBounds(const std::vector<glm::mat4>& palette, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+		if (!mBlended)
+			return false;
+
+		boundsMin = mUnskinnedBounds.min;
+		boundsMax = mUnskinnedBounds.max;
+		for (size_t bone = 0; bone < mBoneBounds.size(); bone++) {
+			const Bounds& bounds = mBoneBounds[bone];
+			if (bounds.min.x > bounds.max.x)
+				continue;
+			if (bone >= palette.size())
+				return false; // those vertices fall back to the bind pose, and so do their other bones
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 p((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y, (corner & 4) ? bounds.max.z : bounds.min.z);
+				glm::vec3 posed = glm::vec3(palette[bone] * glm::vec4(p, 1.0f));
+				boundsMin = glm::min(boundsMin, posed);
+				boundsMax = glm::max(boundsMax, posed);
+			}
+		}
+
+		// weights summing to 1 +- kBlendTolerance scale the point about the origin by as much
+		if (boundsMin.x <= boundsMax.x) {
+			glm::vec3 margin = glm::max(glm::abs(boundsMin), glm::abs(boundsMax)) * kBlendTolerance;
+			boundsMin -= margin;
+			boundsMax += margin;
+		}
+		return true;
+	}
+
+	CpuSkinning::CpuSkinning(uint32_t threadCount, JobSystem& jobs) : mJobs(jobs) {
+		setThreadCount(threadCount);
+	}
+
+	void CpuSkinning::setThreadCount(uint32_t threadCount) {
+		mThreadCount = threadCount == 0 ? mJobs.getThreadCount() : std::min(threadCount, mJobs.getThreadCount());
+	}
+
+	void CpuSkinning::skin(const SkinningSource& source, const std::vector<glm::mat4>& palette, SkinnedPose& pose) {
+		const uint32_t count = source.getVertexCount();
+		pose.positions.resize(count);
+		pose.normals.resize(count);
+		if (count == 0)
+			return;
+
+		mJob.source = &source;
+		mJob.palette = palette.empty() ? kIdentity : &palette[0][0][0];
+		mJob.paletteSize = static_cast<uint32_t>(palette.size());
+		mJob.pose = &pose;
+
+		uint32_t chunkCount = std::min(getThreadCount(), (count + kMinVerticesPerChunk - 1) / kMinVerticesPerChunk);
+		chunkCount = std::max(1u, chunkCount);
+		mJob.chunkCount = chunkCount;
+		mJob.chunkSize = (count + chunkCount - 1) / chunkCount;
+
+		if (chunkCount == 1) {
+			runChunk(0);
+			return;
+		}
+
+		JobCounter counter;
+		for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+			mJobs.run([this, chunk] { runChunk(chunk); }, &counter);
+		runChunk(0);
+		mJobs.wait(counter);
+	}
+
+	void CpuSkinning::runChunk(uint32_t chunk) {
+		const uint32_t count = mJob.source->getVertexCount();
+		uint32_t begin = chunk * mJob.chunkSize;
+		uint32_t end = std::min(count, begin + mJob.chunkSize);
+		if (begin >= end)
+			return;
+
+		glm::vec3* positions = mJob.pose->positions.data();
+		glm::vec3* normals = mJob.pose->normals.data();
+#ifdef GIZMOS_SKINNING_SSE
+		if (mUseSimd) {
+			skinRangeSSE(mJob.source->data(), mJob.palette, mJob.paletteSize, positions, normals, begin, end);
+			return;
+		}
+#endif
+		skinRangeScalar(mJob.source->data(), mJob.palette, mJob.paletteSize, positions, normals, begin, end);
+	}
+
+	namespace {
+		void benchmarkCpuSkinning(std::vector<BenchmarkResult>& results) {
+			// character-sized input: 100k vertices, three influences out of 64 bones
+			const uint32_t vertexCount = 100000, boneCount = 64, stride = 16;
+			std::mt19937 rng(7);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			std::uniform_int_distribution<int> boneDist(0, boneCount - 1);
+
+			std::vector<float> vertices(static_cast<size_t>(vertexCount) * stride);
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				float* v = &vertices[static_cast<size_t>(i) * stride];
+				glm::vec3 n = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+				v[0] = unit(rng); v[1] = unit(rng) + 1.0f; v[2] = unit(rng);
+				v[3] = n.x; v[4] = n.y; v[5] = n.z;
+				float w0 = 0.6f + 0.2f * unit(rng), w1 = (1.0f - w0) * 0.7f;
+				v[8] = float(boneDist(rng)); v[9] = float(boneDist(rng)); v[10] = float(boneDist(rng)); v[11] = -1.0f;
+				v[12] = w0; v[13] = w1; v[14] = 1.0f - w0 - w1; v[15] = 0.0f;
+			}
+
+			SkinningSource source;
+			source.build(vertices, stride);
+
+			std::vector<glm::mat4> palette(boneCount);
+			for (uint32_t b = 0; b < boneCount; b++) {
+				float* m = &palette[b][0][0];
+				float angle = 0.05f * b, c = std::cos(angle), s = std::sin(angle);
+				const float bone[16] = { c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  0.01f * b, 0, 0, 1 };
+				std::copy(bone, bone + 16, m);
+			}
+
+			SkinnedPose pose;
+			CpuSkinning skinning(1);
+			skinning.setUseSimd(false);
+			BenchmarkResult scalar = runBenchmark("skinning scalar, 1 thread", 20, [&](uint32_t) { skinning.skin(source, palette, pose); });
+			scalar.itemsPerIteration = vertexCount;
+			scalar.itemName = "vert";
+			results.push_back(scalar);
+
+			skinning.setUseSimd(true);
+			uint32_t hardwareThreads = JobSystem::get().getThreadCount();
+			for (uint32_t threads = 1; ; threads *= 2) {
+				threads = std::min(threads, hardwareThreads);
+				skinning.setThreadCount(threads);
+				skinning.skin(source, palette, pose); // wake the pool once before timing
+				BenchmarkResult simd = runBenchmark("skinning simd, " + std::to_string(threads) + " threads", 50,
+					[&](uint32_t) { skinning.skin(source, palette, pose); });
+				simd.itemsPerIteration = vertexCount;
+				simd.itemName = "vert";
+				results.push_back(simd);
+				if (threads == hardwareThreads)
+					break;
+			}
+		}
+
+		bool sRegistered = registerBenchmark("skinning", &benchmarkCpuSkinning);
+	}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "JobSystem.h"
+
+namespace Gizmo {
+
+	// float offsets inside an interleaved skinned vertex, the defaults match ProcessAiMesh
+	struct SkinnedVertexLayout {
+		uint32_t positionOffset = 0;
+		uint32_t normalOffset = 3;
+		uint32_t boneIDOffset = 8;
+		uint32_t weightOffset = 12;
+	};
+
+	// Skinning inputs repacked once per mesh: one cache line per vertex, ready for 4-wide loads.
+	class SkinningSource {
+	public:
+		struct alignas(16) Vertex {
+			float position[4];
+			float normal[4];
+			int32_t bones[4];
+			float weights[4];
+		};
+
+		void build(const StaticMesh& mesh, const SkinnedVertexLayout& layout = SkinnedVertexLayout());
+		void build(const std::vector<float>& vertices, uint32_t stride, const SkinnedVertexLayout& layout = SkinnedVertexLayout());
+
+		uint32_t getVertexCount() const { return static_cast<uint32_t>(mVertices.size()); }
+		const Vertex* data() const { return mVertices.data(); }
+
+		// box around the vertices posed with <palette>, without skinning them. false when some vertex
+		// is not a plain blend (weights not summing to one, ids outside the palette), skin it then
+		bool getPosedBounds(const std::vector<glm::mat4>& palette, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	private:
+		struct Bounds {
+			glm::vec3 min = glm::vec3(1e30f);
+			glm::vec3 max = glm::vec3(-1e30f);
+		};
+
+		std::vector<Vertex> mVertices;
+		std::vector<Bounds> mBoneBounds; // bind pose box of the vertices each bone id influences
+		Bounds mUnskinnedBounds;         // vertices without influences stay in bind pose
+		bool mBlended = true;
+	};
+
+	struct SkinnedPose {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+	};
+
+	// Poses vertices on the CPU with the same palette the vertex shader gets
+	// (Skeleton::calculateSkinningMatrices). Vertex ranges run as jobs on a JobSystem, the
+	// calling thread takes the first range.
+	class CpuSkinning {
+	public:
+		// v_texture.glsl only reads the first three influences, keep the CPU pose identical
+		static const uint32_t kMaxInfluences = 3;
+
+		CpuSkinning(uint32_t threadCount = 0, JobSystem& jobs = JobSystem::get()); // 0 = every thread of <jobs>
+
+		CpuSkinning(const CpuSkinning&) = delete;
+		CpuSkinning& operator=(const CpuSkinning&) = delete;
+
+		void skin(const SkinningSource& source, const std::vector<glm::mat4>& palette, SkinnedPose& pose);
+
+		// upper bound on the ranges one skin() call is split into
+		void setThreadCount(uint32_t threadCount);
+		uint32_t getThreadCount() const { return mThreadCount; }
+
+		// the scalar path is kept for comparison and for targets without SSE
+		void setUseSimd(bool useSimd) { mUseSimd = useSimd; }
+		bool getUseSimd() const { return mUseSimd; }
+
+	private:
+		struct Job {
+			const SkinningSource* source = nullptr;
+			const float* palette = nullptr;
+			uint32_t paletteSize = 0;
+			SkinnedPose* pose = nullptr;
+			uint32_t chunkSize = 0;
+			uint32_t chunkCount = 0;
+		};
+
+		void runChunk(uint32_t chunk);
+
+		JobSystem& mJobs;
+		Job mJob;
+		uint32_t mThreadCount = 1;
+		bool mUseSimd = true;
+	};
+
+}
@@ -0,0 +1,220 @@
+#include "Crowd.h"
+
+#include <cmath>
+
+#include "OpenGLUtil.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
+
+namespace Gizmo {
+
+	namespace {
+		// storage buffer bindings in v_crowd.glsl
+		const GLuint kPaletteBinding = 4;
+		const GLuint kModelBinding = 5;
+	}
+
+	Crowd::Crowd(const Ref<SkeletonDefinition>& definition)
+		: mDefinition(definition), mBoneCount(static_cast<uint32_t>(definition->getBoneCount())) {}
+
+	Crowd::~Crowd() {
+		// buffers are created on the first upload, a CPU-only crowd never touches GL
+		if (mPaletteBuffer)
+			glDeleteBuffers(1, &mPaletteBuffer);
+		if (mModelBuffer)
+			glDeleteBuffers(1, &mModelBuffer);
+	}
+
+	uint32_t Crowd::addInstance(const glm::mat4& model, const AnimationClip* clip, float timeOffset) {
+		Instance instance = { Skeleton(mDefinition), AnimationSampler(), timeOffset };
+		instance.sampler.setClip(clip);
+		mInstances.push_back(instance);
+		mModels.push_back(model);
+		mPalettes.resize(mInstances.size() * mBoneCount, glm::mat4(1.0f));
+		return static_cast<uint32_t>(mInstances.size() - 1);
+	}
+
+	uint32_t Crowd::addMesh(const Ref<StaticMesh>& mesh) {
+		mMeshes.push_back(mesh);
+		return static_cast<uint32_t>(mMeshes.size() - 1);
+	}
+
+	void Crowd::updateInstance(uint32_t index, float time, JobSystem* levelJobs, glm::mat4* palette) {
+		Instance& instance = mInstances[index];
+		if (instance.sampler.getClip())
+			instance.sampler.sample(time + instance.timeOffset, instance.skeleton);
+		if (levelJobs)
+			instance.skeleton.calculateGlobalTransformsByLevel(*levelJobs);
+		else
+			instance.skeleton.calculateGlobalTransforms();
+		if (mBoneCount)
+			instance.skeleton.calculateSkinningMatrices(palette + static_cast<size_t>(index) * mBoneCount);
+	}
+
+	void Crowd::update(float time, std::vector<glm::mat4>& palettes) {
+		palettes.resize(mInstances.size() * mBoneCount, glm::mat4(1.0f));
+		glm::mat4* palette = palettes.data();
+
+		JobSystem& jobs = JobSystem::get();
+		SkeletonUpdate strategy = mUpdateStrategy;
+		if (strategy == SkeletonUpdate::Auto)
+			strategy = chooseSkeletonUpdate(*mDefinition, getInstanceCount(), jobs.getThreadCount());
+		mLastUpdateStrategy = strategy;
+
+		if (strategy == SkeletonUpdate::PerInstance) {
+			// instances share nothing but the definition, a batch of them is one job
+			jobs.parallelFor(getInstanceCount(), 16, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++)
+					updateInstance(i, time, nullptr, palette);
+			});
+			return;
+		}
+
+		JobSystem* levelJobs = strategy == SkeletonUpdate::PerLevel ? &jobs : nullptr;
+		for (uint32_t i = 0; i < getInstanceCount(); i++)
+			updateInstance(i, time, levelJobs, palette);
+	}
+
+	void Crowd::reserveBuffer(GLuint& buffer, size_t& capacity, size_t size, const char* label) {
+		if (!buffer) {
+			glCreateBuffers(1, &buffer);
+			glLabelObject(GL_BUFFER, buffer, label);
+		}
+		if (size > capacity) {
+			glNamedBufferData(buffer, size, nullptr, GL_DYNAMIC_DRAW);
+			capacity = size;
+		}
+	}
+
+	void Crowd::upload(const std::vector<glm::mat4>& palettes, StreamingBuffer* stream) {
+		if (mInstances.empty())
+			return;
+
+		GLsizeiptr paletteSize = palettes.size() * sizeof(glm::mat4), modelSize = mModels.size() * sizeof(glm::mat4);
+		if (stream) {
+			mPaletteRange = paletteSize ? stream->upload(palettes.data(), paletteSize) : StreamingBuffer::Allocation();
+			mModelRange = stream->upload(mModels.data(), modelSize);
+			if (mModelRange && (mPaletteRange || !paletteSize))
+				return;
+		}
+
+		// no stream, or it is too small for this crowd
+		reserveBuffer(mPaletteBuffer, mPaletteCapacity, paletteSize, "crowd palettes");
+		reserveBuffer(mModelBuffer, mModelCapacity, modelSize, "crowd models");
+		if (paletteSize)
+			glNamedBufferSubData(mPaletteBuffer, 0, paletteSize, palettes.data());
+		glNamedBufferSubData(mModelBuffer, 0, modelSize, mModels.data());
+
+		mPaletteRange.buffer = mPaletteBuffer;
+		mPaletteRange.offset = 0;
+		mPaletteRange.size = paletteSize;
+		mModelRange.buffer = mModelBuffer;
+		mModelRange.offset = 0;
+		mModelRange.size = modelSize;
+	}
+
+	void Crowd::bind(ShaderProgram& shader) {
+		if (mPaletteRange.size)
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, kPaletteBinding, mPaletteRange.buffer, mPaletteRange.offset, mPaletteRange.size);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, kModelBinding, mModelRange.buffer, mModelRange.offset, mModelRange.size);
+		glUniform1ui(shader.u("uBoneCount"), mBoneCount);
+	}
+
+	void Crowd::drawMesh(uint32_t index, int subMesh) {
+		if (mInstances.empty())
+			return;
+
+		const Ref<StaticMesh>& mesh = mMeshes[index];
+		mesh->bindSubMesh(subMesh);
+		const SubMesh& sub = mesh->getSubMesh(subMesh);
+		GLenum type = sub.mIndexFormat == IndexType::UInt32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+		glDrawElementsInstanced(GL_TRIANGLES, sub.getCount(), type, nullptr, static_cast<GLsizei>(mInstances.size()));
+	}
+
+	namespace {
+		void benchmarkCrowd(std::vector<BenchmarkResult>& results) {
+			// 1,000 characters with a Stormtrooper-sized skeleton: 70 nodes, 50 of them bones
+			const uint32_t characters = 1000, nodes = 70, bones = 50, keys = 60;
+
+			Skeleton builder;
+			AnimationClip clip("walk", 2.0f);
+			buildBenchmarkCharacter(builder, clip, nodes, bones, keys);
+
+			Crowd crowd(builder.getDefinition());
+			for (uint32_t c = 0; c < characters; c++)
+				crowd.addInstance(glm::mat4(1.0f), &clip, c * 0.013f);
+
+			const float dt = 1.0f / 60.0f;
+			BenchmarkResult update = runBenchmark("crowd update, 1000 x 70 nodes", 120, [&](uint32_t frame) {
+				crowd.update(frame * dt);
+			});
+			update.itemsPerIteration = characters;
+			update.itemName = "character";
+			results.push_back(update);
+
+			size_t perInstance = sizeof(Skeleton) + nodes * (2 * sizeof(glm::vec3) + sizeof(glm::quat) + sizeof(glm::mat4)) + bones * sizeof(glm::mat4);
+			printf("[bench] crowd: %u instances, about %zu bytes each, %zu KB of palettes per frame\n",
+				characters, perInstance, crowd.getPalettes().size() * sizeof(glm::mat4) / 1024);
+		}
+
+		const char* strategyName(SkeletonUpdate strategy) {
+			switch (strategy) {
+			case SkeletonUpdate::Serial: return "serial";
+			case SkeletonUpdate::PerInstance: return "per instance";
+			case SkeletonUpdate::PerLevel: return "per level";
+			default: return "auto";
+			}
+		}
+
+		void benchmarkSkeletonUpdate(std::vector<BenchmarkResult>& results) {
+			// global transforms only, bind pose, every strategy on a grid of skeleton sizes and
+			// crowd sizes; the fan-out of 4 gives wide levels like a hair or foliage rig would
+			const uint32_t nodeCounts[] = { 64, 512, 4096, 32768 };
+			const uint32_t instanceCounts[] = { 1, 4, 16, 256 };
+			const SkeletonUpdate strategies[] = { SkeletonUpdate::Serial, SkeletonUpdate::PerInstance, SkeletonUpdate::PerLevel };
+			uint32_t threads = JobSystem::get().getThreadCount();
+
+			for (uint32_t nodes : nodeCounts) {
+				Skeleton builder;
+				for (uint32_t n = 0; n < nodes; n++) {
+					glm::mat4 offset = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)), 0.01f * n, glm::vec3(0.0f, 0.0f, 1.0f));
+					builder.addNode("node" + std::to_string(n), n == 0 ? -1 : static_cast<int32_t>((n - 1) / 4), offset);
+				}
+
+				for (uint32_t instances : instanceCounts) {
+					// keep every cell of the grid in the same ballpark of work
+					if (static_cast<uint64_t>(nodes) * instances > (1u << 18))
+						continue;
+
+					Crowd crowd(builder.getDefinition());
+					for (uint32_t c = 0; c < instances; c++)
+						crowd.addInstance(glm::mat4(1.0f), nullptr);
+
+					double best = 0.0;
+					SkeletonUpdate bestStrategy = SkeletonUpdate::Serial;
+					for (SkeletonUpdate strategy : strategies) {
+						crowd.setUpdateStrategy(strategy);
+						BenchmarkResult result = runBenchmark(std::to_string(nodes) + " nodes x " + std::to_string(instances) + ", " + strategyName(strategy), 20,
+							[&](uint32_t frame) { crowd.update(frame * 0.01f); });
+						result.itemsPerIteration = static_cast<double>(nodes) * instances;
+						result.itemName = "node";
+						results.push_back(result);
+						if (best == 0.0 || result.meanMs() < best) {
+							best = result.meanMs();
+							bestStrategy = strategy;
+						}
+					}
+
+					crowd.setUpdateStrategy(SkeletonUpdate::Auto);
+					crowd.update(0.0f);
+					printf("[bench] skeleton-update: %u nodes x %u instances on %u threads: fastest %s, auto picks %s\n",
+						nodes, instances, threads, strategyName(bestStrategy), strategyName(crowd.getLastUpdateStrategy()));
+				}
+			}
+		}
+
+		bool sRegistered = registerBenchmark("crowd", &benchmarkCrowd);
+		bool sRegisteredUpdate = registerBenchmark("skeleton-update", &benchmarkSkeletonUpdate);
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Base.h"
+#include "Mesh.h"
+#include "Animation.h"
+#include "StreamingBuffer.h"
+#include "shaderprogram.h"
+
+namespace Gizmo {
+
+	// Many instances of one skinned character. The SkeletonDefinition is shared; an instance only
+	// owns its pose (a Skeleton on that definition), a clip cursor, a model matrix and its slice of
+	// one big palette array. Palettes and model matrices live in two storage buffers and every
+	// mesh is drawn once for the whole crowd with v_crowd.glsl and glDrawElementsInstanced.
+	class Crowd {
+	public:
+		Crowd(const Ref<SkeletonDefinition>& definition);
+		~Crowd();
+
+		Crowd(const Crowd&) = delete;
+		Crowd& operator=(const Crowd&) = delete;
+
+		// <clip> may be null for a character standing in bind pose
+		uint32_t addInstance(const glm::mat4& model, const AnimationClip* clip, float timeOffset = 0.0f);
+		uint32_t getInstanceCount() const { return static_cast<uint32_t>(mInstances.size()); }
+		Skeleton& getInstance(uint32_t index) { return mInstances[index].skeleton; }
+		void setModel(uint32_t index, const glm::mat4& model) { mModels[index] = model; }
+
+		// <mesh> uses the ProcessAiMesh vertex layout
+		uint32_t addMesh(const Ref<StaticMesh>& mesh);
+		uint32_t getMeshCount() const { return static_cast<uint32_t>(mMeshes.size()); }
+
+		// samples every instance at its own time and writes its palette slice, CPU only, on the JobSystem
+		void update(float time) { update(time, mPalettes); }
+		// same, into <palettes> instead of the crowd's own array, e.g. a frame packet's that another thread draws from
+		void update(float time, std::vector<glm::mat4>& palettes);
+		void setUpdateStrategy(SkeletonUpdate strategy) { mUpdateStrategy = strategy; }
+		// what the last update() actually did, Auto resolved
+		SkeletonUpdate getLastUpdateStrategy() const { return mLastUpdateStrategy; }
+		// uploads palettes and model matrices, call after update() with the context current; with
+		// <stream> both are sub-allocated from it for this frame instead of the crowd's own buffers
+		void upload(StreamingBuffer* stream = nullptr) { upload(mPalettes, stream); }
+		void upload(const std::vector<glm::mat4>& palettes, StreamingBuffer* stream = nullptr);
+
+		// binds the storage buffers and sets uBoneCount on <shader>, which must be in use
+		void bind(ShaderProgram& shader);
+		void drawMesh(uint32_t index, int subMesh = 0);
+
+		const std::vector<glm::mat4>& getPalettes() const { return mPalettes; }
+		uint32_t getBoneCount() const { return mBoneCount; }
+
+	private:
+		struct Instance {
+			Skeleton skeleton;
+			AnimationSampler sampler;
+			float timeOffset;
+		};
+
+		void reserveBuffer(GLuint& buffer, size_t& capacity, size_t size, const char* label);
+		void updateInstance(uint32_t index, float time, JobSystem* levelJobs, glm::mat4* palette);
+
+		Ref<SkeletonDefinition> mDefinition;
+		uint32_t mBoneCount;
+		std::vector<Instance> mInstances;
+		std::vector<glm::mat4> mModels;
+		std::vector<glm::mat4> mPalettes; // mBoneCount matrices per instance
+		std::vector<Ref<StaticMesh>> mMeshes;
+		SkeletonUpdate mUpdateStrategy = SkeletonUpdate::Auto;
+		SkeletonUpdate mLastUpdateStrategy = SkeletonUpdate::Serial;
+
+		GLuint mPaletteBuffer = 0, mModelBuffer = 0;
+		size_t mPaletteCapacity = 0, mModelCapacity = 0;
+		StreamingBuffer::Allocation mPaletteRange, mModelRange; // what bind() binds, set by upload()
+	};
+
+}
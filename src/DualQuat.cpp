@@ -0,0 +1,152 @@
+#include "DualQuat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "Benchmark.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GIZMOS_DUALQUAT_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Gizmo {
+
+	namespace {
+		// Branchless matrix to quaternion: the magnitudes come from the diagonal, the signs
+		// from the off-diagonal differences. <m> is column-major with unit-length columns.
+		inline void matrixToDualQuat(const float* m, DualQuat& out) {
+			float sx = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+			float sy = std::sqrt(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]);
+			float sz = std::sqrt(m[8] * m[8] + m[9] * m[9] + m[10] * m[10]);
+			float m00 = m[0] / sx, m11 = m[5] / sy, m22 = m[10] / sz;
+			float m21 = m[6] / sy, m12 = m[9] / sz;  // row 2 col 1, row 1 col 2
+			float m02 = m[8] / sz, m20 = m[2] / sx;
+			float m10 = m[1] / sx, m01 = m[4] / sy;
+
+			float w = 0.5f * std::sqrt(std::fmax(0.0f, 1.0f + m00 + m11 + m22));
+			float x = std::copysign(0.5f * std::sqrt(std::fmax(0.0f, 1.0f + m00 - m11 - m22)), m21 - m12);
+			float y = std::copysign(0.5f * std::sqrt(std::fmax(0.0f, 1.0f - m00 + m11 - m22)), m02 - m20);
+			float z = std::copysign(0.5f * std::sqrt(std::fmax(0.0f, 1.0f - m00 - m11 + m22)), m10 - m01);
+			float inv = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+			x *= inv; y *= inv; z *= inv; w *= inv;
+
+			// dual = 0.5 * (t, 0) * real
+			float tx = m[12], ty = m[13], tz = m[14];
+			out.real = glm::vec4(x, y, z, w);
+			out.dual = glm::vec4(
+				0.5f * (tx * w + ty * z - tz * y),
+				0.5f * (-tx * z + ty * w + tz * x),
+				0.5f * (tx * y - ty * x + tz * w),
+				-0.5f * (tx * x + ty * y + tz * z));
+		}
+
+#ifdef GIZMOS_DUALQUAT_SSE
+		inline __m128 copySign(__m128 magnitude, __m128 sign) {
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			return _mm_or_ps(_mm_andnot_ps(signMask, magnitude), _mm_and_ps(signMask, sign));
+		}
+
+		inline __m128 length3(__m128 a, __m128 b, __m128 c) {
+			return _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c)));
+		}
+
+		// four matrices at a time, transposed so that every lane is one bone
+		void convertFourSSE(const float* m0, const float* m1, const float* m2, const float* m3, DualQuat* out) {
+			__m128 col[4][4]; // col[c][r]: element (row r, column c) of the four bones
+			for (int c = 0; c < 4; c++) {
+				__m128 a = _mm_loadu_ps(m0 + c * 4), b = _mm_loadu_ps(m1 + c * 4);
+				__m128 d = _mm_loadu_ps(m2 + c * 4), e = _mm_loadu_ps(m3 + c * 4);
+				_MM_TRANSPOSE4_PS(a, b, d, e);
+				col[c][0] = a; col[c][1] = b; col[c][2] = d; col[c][3] = e;
+			}
+
+			const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+			__m128 invSx = _mm_div_ps(one, length3(col[0][0], col[0][1], col[0][2]));
+			__m128 invSy = _mm_div_ps(one, length3(col[1][0], col[1][1], col[1][2]));
+			__m128 invSz = _mm_div_ps(one, length3(col[2][0], col[2][1], col[2][2]));
+
+			__m128 m00 = _mm_mul_ps(col[0][0], invSx), m10 = _mm_mul_ps(col[0][1], invSx), m20 = _mm_mul_ps(col[0][2], invSx);
+			__m128 m01 = _mm_mul_ps(col[1][0], invSy), m11 = _mm_mul_ps(col[1][1], invSy), m21 = _mm_mul_ps(col[1][2], invSy);
+			__m128 m02 = _mm_mul_ps(col[2][0], invSz), m12 = _mm_mul_ps(col[2][1], invSz), m22 = _mm_mul_ps(col[2][2], invSz);
+
+			__m128 w = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(_mm_add_ps(one, m00), _mm_add_ps(m11, m22)))));
+			__m128 x = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_add_ps(one, m00), _mm_add_ps(m11, m22)))));
+			__m128 y = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_add_ps(one, m11), _mm_add_ps(m00, m22)))));
+			__m128 z = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_add_ps(one, m22), _mm_add_ps(m00, m11)))));
+			x = copySign(x, _mm_sub_ps(m21, m12));
+			y = copySign(y, _mm_sub_ps(m02, m20));
+			z = copySign(z, _mm_sub_ps(m10, m01));
+
+			__m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)))));
+			x = _mm_mul_ps(x, inv); y = _mm_mul_ps(y, inv); z = _mm_mul_ps(z, inv); w = _mm_mul_ps(w, inv);
+
+			__m128 tx = col[3][0], ty = col[3][1], tz = col[3][2];
+			__m128 dx = _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(tx, w), _mm_mul_ps(ty, z)), _mm_mul_ps(tz, y)));
+			__m128 dy = _mm_mul_ps(half, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ty, w), _mm_mul_ps(tx, z)), _mm_mul_ps(tz, x)));
+			__m128 dz = _mm_mul_ps(half, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(tx, y), _mm_mul_ps(ty, x)), _mm_mul_ps(tz, w)));
+			__m128 dw = _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, x), _mm_mul_ps(ty, y)), _mm_mul_ps(tz, z)));
+
+			// back to one bone per register: (x y z w) real, (x y z w) dual
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_MM_TRANSPOSE4_PS(dx, dy, dz, dw);
+			float* dst = &out[0].real[0];
+			_mm_storeu_ps(dst + 0, x);  _mm_storeu_ps(dst + 4, dx);
+			_mm_storeu_ps(dst + 8, y);  _mm_storeu_ps(dst + 12, dy);
+			_mm_storeu_ps(dst + 16, z); _mm_storeu_ps(dst + 20, dz);
+			_mm_storeu_ps(dst + 24, w); _mm_storeu_ps(dst + 28, dw);
+		}
+#endif
+	}
+
+	void convertToDualQuatsScalar(const glm::mat4* matrices, uint32_t count, DualQuat* out) {
+		for (uint32_t i = 0; i < count; i++)
+			matrixToDualQuat(&matrices[i][0][0], out[i]);
+	}
+
+	void convertToDualQuats(const glm::mat4* matrices, uint32_t count, DualQuat* out) {
+		uint32_t i = 0;
+#ifdef GIZMOS_DUALQUAT_SSE
+		for (; i + 4 <= count; i += 4)
+			convertFourSSE(&matrices[i][0][0], &matrices[i + 1][0][0], &matrices[i + 2][0][0], &matrices[i + 3][0][0], out + i);
+#endif
+		convertToDualQuatsScalar(matrices + i, count - i, out + i);
+	}
+
+	namespace {
+		void benchmarkDualQuats(std::vector<BenchmarkResult>& results) {
+			// 100 characters x 200 bones worth of palette
+			const uint32_t count = 20000;
+			std::mt19937 rng(11);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+			std::vector<glm::mat4> matrices(count);
+			for (glm::mat4& matrix : matrices) {
+				float qx = unit(rng), qy = unit(rng), qz = unit(rng), qw = unit(rng);
+				float inv = 1.0f / std::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+				qx *= inv; qy *= inv; qz *= inv; qw *= inv;
+				const float m[16] = {
+					1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy + qz * qw), 2 * (qx * qz - qy * qw), 0,
+					2 * (qx * qy - qz * qw), 1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz + qx * qw), 0,
+					2 * (qx * qz + qy * qw), 2 * (qy * qz - qx * qw), 1 - 2 * (qx * qx + qy * qy), 0,
+					unit(rng), unit(rng), unit(rng), 1 };
+				std::copy(m, m + 16, &matrix[0][0]);
+			}
+
+			std::vector<DualQuat> dualQuats(count);
+			BenchmarkResult scalar = runBenchmark("mat4 -> dual quat, scalar", 50, [&](uint32_t) { convertToDualQuatsScalar(matrices.data(), count, dualQuats.data()); });
+			scalar.itemsPerIteration = count;
+			scalar.itemName = "bone";
+			results.push_back(scalar);
+
+			BenchmarkResult simd = runBenchmark("mat4 -> dual quat, simd", 50, [&](uint32_t) { convertToDualQuats(matrices.data(), count, dualQuats.data()); });
+			simd.itemsPerIteration = count;
+			simd.itemName = "bone";
+			results.push_back(simd);
+		}
+
+		bool sRegistered = registerBenchmark("dualquat", &benchmarkDualQuats);
+	}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace Gizmo {
+
+	// Unit dual quaternion, 32 bytes, laid out like the std430 struct in c_skinning.glsl.
+	// Quaternions are stored (x, y, z, w).
+	struct DualQuat {
+		glm::vec4 real;
+		glm::vec4 dual;
+	};
+
+	// Converts rigid transforms (rotation + translation, scale is dropped) to dual quaternions.
+	// Four matrices are converted per SSE iteration, the remainder goes through the scalar path.
+	void convertToDualQuats(const glm::mat4* matrices, uint32_t count, DualQuat* out);
+	void convertToDualQuatsScalar(const glm::mat4* matrices, uint32_t count, DualQuat* out);
+
+}
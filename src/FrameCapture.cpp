@@ -0,0 +1,239 @@
+#include "FrameCapture.h"
+
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+#include "OpenGLUtil.h"
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		const GLbitfield kMapFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	}
+
+	FrameCapture::FrameCapture(uint32_t ringSize) : mSlots(std::max(1u, ringSize)) {
+		mWorker = std::thread(&FrameCapture::workerLoop, this);
+	}
+
+	FrameCapture::~FrameCapture() {
+		flush();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+		}
+		mQueueChanged.notify_all();
+		mWorker.join();
+
+		for (Slot& slot : mSlots) {
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			release(slot);
+		}
+	}
+
+	bool FrameCapture::allocate(Slot& slot, size_t size) {
+		release(slot);
+		glCreateBuffers(1, &slot.pbo);
+		glLabelObject(GL_BUFFER, slot.pbo, "capture PBO");
+		glNamedBufferStorage(slot.pbo, size, nullptr, kMapFlags | GL_CLIENT_STORAGE_BIT);
+		slot.mapped = static_cast<const uint8_t*>(glMapNamedBufferRange(slot.pbo, 0, size, kMapFlags));
+		if (!slot.mapped) {
+			std::cerr << "Failed to map capture buffer" << std::endl;
+			release(slot);
+			return false;
+		}
+		slot.capacity = size;
+		return true;
+	}
+
+	void FrameCapture::release(Slot& slot) {
+		if (!slot.pbo)
+			return;
+		if (slot.mapped)
+			glUnmapNamedBuffer(slot.pbo);
+		glDeleteBuffers(1, &slot.pbo);
+		slot.pbo = 0;
+		slot.mapped = nullptr;
+		slot.capacity = 0;
+	}
+
+	bool FrameCapture::capture(GLuint framebuffer, uint32_t attachment, uint32_t width, uint32_t height, const std::string& path, Callback callback) {
+		Slot& slot = mSlots[mHead];
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (slot.state != SlotState::Free) {
+				mDropped++;
+				return false;
+			}
+		}
+
+		size_t size = static_cast<size_t>(width) * height * 4;
+		if (slot.capacity < size && !allocate(slot, size)) {
+			mDropped++;
+			return false;
+		}
+
+		// with a pack buffer bound glReadPixels only queues a copy and returns immediately
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0 + attachment);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.width = width;
+		slot.height = height;
+		slot.path = path;
+		slot.callback = std::move(callback);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			slot.state = SlotState::Reading;
+		}
+
+		mHead = (mHead + 1) % mSlots.size();
+		mInFlight++;
+		mCaptured++;
+		return true;
+	}
+
+	bool FrameCapture::retire(uint32_t index, GLuint64 timeout) {
+		Slot& slot = mSlots[index];
+		GLenum status = glClientWaitSync(slot.fence, timeout ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+		if (status == GL_TIMEOUT_EXPIRED)
+			return false;
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		if (status == GL_WAIT_FAILED) {
+			// lost context or a bad sync, the readback is never going to land
+			std::cerr << "Capture fence wait failed, dropping the frame" << std::endl;
+			slot.path.clear();
+			slot.callback = nullptr;
+			mDropped++;
+			std::lock_guard<std::mutex> lock(mMutex);
+			slot.state = SlotState::Free;
+			return true;
+		}
+
+		// the mapping is coherent: past the fence the pixels are visible to the worker as they are
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			slot.state = SlotState::Copying;
+			mQueue.push_back({ index, std::move(slot.path), std::move(slot.callback) });
+		}
+		mQueueChanged.notify_all();
+		return true;
+	}
+
+	void FrameCapture::update() {
+		// slots complete in submission order, stop at the first one the GPU has not reached yet
+		while (mInFlight > 0 && retire(mTail, 0)) {
+			mTail = (mTail + 1) % mSlots.size();
+			mInFlight--;
+		}
+	}
+
+	void FrameCapture::flush() {
+		const GLuint64 oneSecond = 1000000000ull;
+		while (mInFlight > 0) {
+			if (!retire(mTail, oneSecond))
+				continue;
+			mTail = (mTail + 1) % mSlots.size();
+			mInFlight--;
+		}
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mQueueChanged.wait(lock, [this] { return mQueue.empty() && !mBusy; });
+	}
+
+	uint32_t FrameCapture::getEncodedCount() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mEncoded;
+	}
+
+	void FrameCapture::workerLoop() {
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;) {
+			mQueueChanged.wait(lock, [this] { return mStop || !mQueue.empty(); });
+			if (mQueue.empty())
+				return;
+
+			EncodeJob job = std::move(mQueue.front());
+			mQueue.pop_front();
+			mBusy = true;
+			Slot& slot = mSlots[job.slot];
+			lock.unlock();
+
+			// readbacks are bottom-up, copying row by row flips for free
+			Image image;
+			image.width = slot.width;
+			image.height = slot.height;
+			image.pixels.resize(static_cast<size_t>(slot.width) * slot.height * 4);
+			const size_t rowSize = static_cast<size_t>(slot.width) * 4;
+			for (uint32_t y = 0; y < slot.height; y++)
+				std::memcpy(image.pixels.data() + y * rowSize, slot.mapped + (slot.height - 1 - y) * rowSize, rowSize);
+
+			lock.lock();
+			slot.state = SlotState::Free;
+			lock.unlock();
+
+			if (!job.path.empty())
+				writePNG(job.path, image);
+			else if (job.callback)
+				job.callback(image);
+
+			lock.lock();
+			mBusy = false;
+			mEncoded++;
+			mQueueChanged.notify_all();
+		}
+	}
+
+	namespace {
+		void benchmarkFrameCapture(std::vector<BenchmarkResult>& results) {
+			// a 1080p frame at 60 Hz with and without a capture every frame; glFinish closes each frame
+			// so the GPU side of the readback is counted too, the encode runs on the worker
+			const uint32_t width = 1920, height = 1080, frames = 120;
+			GLuint texture = 0, framebuffer = 0;
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+			glCreateFramebuffers(1, &framebuffer);
+			glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+
+			FrameCapture capture;
+			uint32_t delivered = 0;
+			auto frame = [&](uint32_t index, bool capturing) {
+				glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+				glViewport(0, 0, width, height);
+				glClearColor((index % 60) / 60.0f, 0.2f, 0.3f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				if (capturing)
+					capture.capture(framebuffer, 0, width, height, "", [&delivered](Image&) { delivered++; });
+				capture.update();
+				glFinish();
+			};
+
+			BenchmarkResult off = runBenchmark("1080p frame, no capture", frames, [&](uint32_t i) { frame(i, false); });
+			results.push_back(off);
+			BenchmarkResult on = runBenchmark("1080p frame, capture every frame", frames, [&](uint32_t i) { frame(i, true); });
+			results.push_back(on);
+			capture.flush();
+
+			double cost = on.meanMs() - off.meanMs();
+			printf("[bench] capture: +%.3f ms a frame, %.1f%% of a 60 Hz frame; %u captured, %u dropped, %u delivered\n",
+				cost, cost / (1000.0 / 60.0) * 100.0, capture.getCapturedCount(), capture.getDroppedCount(), delivered);
+
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteTextures(1, &texture);
+		}
+
+		bool sRegistered = registerBenchmark("frame-capture", &benchmarkFrameCapture);
+	}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include "Image.h"
+
+namespace Gizmo {
+
+	// Reads frames back into a ring of persistently mapped pixel buffer objects. Each readback is
+	// fenced, and once the GPU has passed the fence (a few frames later) the slot goes to a worker
+	// thread that copies the pixels out of the mapping, flips and encodes them; the render thread
+	// never touches the pixels. A slot stays busy until the worker has copied it, so a slow encoder
+	// costs dropped captures rather than memory or frame time.
+	class FrameCapture {
+	public:
+		using Callback = std::function<void(Image&)>;
+
+		FrameCapture(uint32_t ringSize = 4);
+		~FrameCapture();
+
+		FrameCapture(const FrameCapture&) = delete;
+		FrameCapture& operator=(const FrameCapture&) = delete;
+
+		// Queues a readback of <attachment> of <framebuffer> (0 = back buffer). The result is
+		// written to <path> as PNG, or passed to <callback> on the worker thread when no path is given.
+		// Returns false and drops the capture when the next slot is still in flight or being copied.
+		bool capture(GLuint framebuffer, uint32_t attachment, uint32_t width, uint32_t height, const std::string& path, Callback callback = nullptr);
+
+		// Polls the fences without blocking; call once per frame.
+		void update();
+
+		// Blocks until every queued capture is written, for shutdown and tests.
+		void flush();
+
+		uint32_t getCapturedCount() const { return mCaptured; }
+		uint32_t getDroppedCount() const { return mDropped; }
+		uint32_t getEncodedCount() const;
+		uint32_t getInFlightCount() const { return mInFlight; }
+
+	private:
+		enum class SlotState { Free, Reading, Copying };
+
+		struct Slot {
+			GLuint pbo = 0;
+			const uint8_t* mapped = nullptr; // whole buffer, mapped for as long as it exists
+			GLsync fence = nullptr;
+			uint32_t width = 0, height = 0;
+			size_t capacity = 0;
+			SlotState state = SlotState::Free; // guarded by mMutex, the worker frees Copying slots
+			std::string path;
+			Callback callback;
+		};
+
+		struct EncodeJob {
+			uint32_t slot;
+			std::string path;
+			Callback callback;
+		};
+
+		// immutable storage cannot grow, a bigger frame gets a new buffer
+		bool allocate(Slot& slot, size_t size);
+		void release(Slot& slot);
+		// true once the readback of <slot> landed and went to the worker, or was dropped after a failed wait
+		bool retire(uint32_t index, GLuint64 timeout);
+		void workerLoop();
+
+		std::vector<Slot> mSlots;
+		uint32_t mHead = 0;     // next slot to fill
+		uint32_t mTail = 0;     // oldest slot waiting for its fence
+		uint32_t mInFlight = 0; // slots waiting for their fence
+
+		uint32_t mCaptured = 0;
+		uint32_t mDropped = 0;
+
+		std::thread mWorker;
+		mutable std::mutex mMutex;
+		std::condition_variable mQueueChanged;
+		std::deque<EncodeJob> mQueue; // at most one job per slot
+		uint32_t mEncoded = 0;
+		bool mBusy = false;
+		bool mStop = false;
+	};
+
+}
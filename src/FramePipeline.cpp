@@ -0,0 +1,63 @@
+#include "FramePipeline.h"
+
+#include <string>
+
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		struct BenchmarkInput {
+			double sampledMs = 0.0;
+		};
+
+		struct BenchmarkPacket {
+			double sampledMs = 0.0; // of the input this packet was built from
+			uint64_t checksum = 0;
+		};
+
+		uint64_t spin(double ms) {
+			Timer timer;
+			uint64_t checksum = 0;
+			while (timer.elapsedMs() < ms)
+				checksum = checksum * 31 + 7;
+			return checksum;
+		}
+
+		void benchmarkFramePipeline(std::vector<BenchmarkResult>& results) {
+			// 4 ms of simulation and 4 ms of submission per frame: serially that is 8 ms a frame,
+			// pipelined the two overlap at the price of a frame of latency
+			const double updateMs = 4.0, renderMs = 4.0;
+			const uint32_t frames = 60;
+
+			for (bool threaded : { false, true }) {
+				Timer clock;
+				FramePipeline<BenchmarkInput, BenchmarkPacket> pipeline([&](const BenchmarkInput& input, BenchmarkPacket& packet) {
+					packet.sampledMs = input.sampledMs;
+					packet.checksum = spin(updateMs);
+				}, threaded);
+
+				double latencyMs = 0.0, maxLatencyMs = 0.0;
+				BenchmarkResult result = runBenchmark(std::string("frame, ") + (threaded ? "pipelined" : "serial"), frames, [&](uint32_t) {
+					pipeline.getInput().sampledMs = clock.elapsedMs();
+					pipeline.submitInput();
+					const BenchmarkPacket& packet = pipeline.acquirePacket();
+					spin(renderMs);
+					double latency = clock.elapsedMs() - packet.sampledMs;
+					latencyMs += latency;
+					maxLatencyMs = std::max(maxLatencyMs, latency);
+				});
+				result.itemsPerIteration = 1;
+				result.itemName = "frame";
+				results.push_back(result);
+
+				printf("[bench] frame-pipeline: %s, input to end of frame %.2f ms avg, %.2f ms max, %llu updates for %u frames\n",
+					threaded ? "pipelined" : "serial", latencyMs / frames, maxLatencyMs,
+					static_cast<unsigned long long>(pipeline.getUpdateCount()), frames);
+			}
+		}
+
+		bool sRegistered = registerBenchmark("frame-pipeline", &benchmarkFramePipeline);
+	}
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+namespace Gizmo {
+
+	// Lock-free handoff between one producer and one consumer. The producer fills its own slot and
+	// publish() swaps it with the shared one; acquire() swaps the shared slot in if it is newer.
+	// Neither side ever waits and the consumer always sees the latest complete value.
+	template<typename T>
+	class TripleBuffer {
+	public:
+		T& getWriteBuffer() { return mSlots[mWrite]; }
+
+		void publish() {
+			uint32_t previous = mShared.exchange(mWrite | kFresh, std::memory_order_acq_rel);
+			mWrite = previous & kIndexMask;
+		}
+
+		// true when acquire() would return something new
+		bool isFresh() const { return (mShared.load(std::memory_order_acquire) & kFresh) != 0; }
+
+		// true when a value was published since the last acquire(), getReadBuffer() then returns it
+		bool acquire() {
+			if (!(mShared.load(std::memory_order_relaxed) & kFresh))
+				return false;
+			uint32_t previous = mShared.exchange(mRead, std::memory_order_acq_rel);
+			mRead = previous & kIndexMask;
+			return true;
+		}
+
+		T& getReadBuffer() { return mSlots[mRead]; }
+		const T& getReadBuffer() const { return mSlots[mRead]; }
+
+	private:
+		static const uint32_t kFresh = 4, kIndexMask = 3;
+
+		T mSlots[3];
+		uint32_t mWrite = 0, mRead = 1;
+		std::atomic<uint32_t> mShared{ 2 };
+	};
+
+	// Runs the simulation half of a frame one frame ahead of rendering. The render thread submits
+	// an Input (sampled keys, UI state, edits), the update thread turns the newest one into an
+	// immutable Packet (camera, poses, palettes) and the render thread draws the newest Packet
+	// while the next one is being built. Unthreaded, submitInput() runs the update inline, so
+	// both modes go through the same code.
+	template<typename Input, typename Packet>
+	class FramePipeline {
+	public:
+		using UpdateFn = std::function<void(const Input& input, Packet& packet)>;
+
+		FramePipeline(UpdateFn update, bool threaded) : mUpdate(std::move(update)), mThreaded(threaded) {
+			if (mThreaded)
+				mThread = std::thread(&FramePipeline::updateLoop, this);
+		}
+
+		~FramePipeline() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop.store(true, std::memory_order_release);
+			}
+			mInputReady.notify_one();
+			if (mThread.joinable())
+				mThread.join();
+		}
+
+		FramePipeline(const FramePipeline&) = delete;
+		FramePipeline& operator=(const FramePipeline&) = delete;
+
+		// fill the returned slot, then submitInput()
+		Input& getInput() { return mInputs.getWriteBuffer(); }
+
+		void submitInput() {
+			if (!mThreaded) {
+				mUpdate(mInputs.getWriteBuffer(), mPackets.getWriteBuffer());
+				mPackets.publish();
+				mUpdateCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			mInputs.publish();
+			// taken after publishing, so the update thread is either before its check or already waiting
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+			}
+			mInputReady.notify_one();
+		}
+
+		// newest packet; only blocks until the very first one exists
+		const Packet& acquirePacket() {
+			if (mPackets.acquire())
+				mHasPacket = true;
+			if (!mHasPacket) {
+				std::unique_lock<std::mutex> lock(mMutex);
+				mPacketReady.wait(lock, [this] { return mPackets.isFresh(); });
+				mHasPacket = mPackets.acquire();
+			}
+			return mPackets.getReadBuffer();
+		}
+
+		bool isThreaded() const { return mThreaded; }
+		uint64_t getUpdateCount() const { return mUpdateCount.load(std::memory_order_relaxed); }
+
+	private:
+		void updateLoop() {
+			for (;;) {
+				// one update per submitted input, the render thread sets the pace; asleep in between
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mInputReady.wait(lock, [this] { return mStop.load(std::memory_order_acquire) || mInputs.isFresh(); });
+					if (mStop.load(std::memory_order_acquire))
+						return;
+				}
+				mInputs.acquire();
+				mUpdate(mInputs.getReadBuffer(), mPackets.getWriteBuffer());
+				mPackets.publish();
+				mUpdateCount.fetch_add(1, std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+				}
+				mPacketReady.notify_one();
+			}
+		}
+
+		UpdateFn mUpdate;
+		bool mThreaded;
+		bool mHasPacket = false;
+		TripleBuffer<Input> mInputs;
+		TripleBuffer<Packet> mPackets;
+		std::atomic<uint64_t> mUpdateCount{ 0 };
+		std::atomic<bool> mStop{ false };
+		std::mutex mMutex;
+		std::condition_variable mInputReady;  // submitInput() to the update thread
+		std::condition_variable mPacketReady; // update thread to the first acquirePacket()
+		std::thread mThread;
+	};
+
+}
@@ -0,0 +1,118 @@
+#include "Framebuffer.h"
+
+#include <iostream>
+
+#include "OpenGLUtil.h"
+
+namespace Gizmo {
+
+	Framebuffer::Framebuffer(const FramebufferSpec& spec) : mSpec(spec) {
+		invalidate();
+	}
+
+	Framebuffer::~Framebuffer() {
+		release();
+	}
+
+	void Framebuffer::release() {
+		if (mFramebufferID == 0)
+			return;
+
+		glDeleteFramebuffers(1, &mFramebufferID);
+		glDeleteTextures(static_cast<GLsizei>(mColorAttachments.size()), mColorAttachments.data());
+		glDeleteRenderbuffers(1, &mDepthAttachment);
+
+		mFramebufferID = 0;
+		mDepthAttachment = 0;
+		mColorAttachments.clear();
+		mColorFormats.clear();
+	}
+
+	void Framebuffer::invalidate() {
+		release();
+
+		glCreateFramebuffers(1, &mFramebufferID);
+
+		std::vector<GLenum> drawBuffers;
+		for (FramebufferFormat format : mSpec.attachments) {
+			switch (format)
+			{
+			case FramebufferFormat::RGBA8: {
+				uint32_t texture;
+				glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+				glTextureStorage2D(texture, 1, GL_RGBA8, mSpec.width, mSpec.height);
+				glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+				GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(mColorAttachments.size());
+				glNamedFramebufferTexture(mFramebufferID, attachment, texture, 0);
+				drawBuffers.push_back(attachment);
+				mColorAttachments.push_back(texture);
+				mColorFormats.push_back(format);
+				glLabelObject(GL_TEXTURE, texture, "framebuffer color");
+				break;
+			}
+			case FramebufferFormat::RGBA32UI: {
+				// integer ids, never filtered
+				uint32_t texture;
+				glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+				glTextureStorage2D(texture, 1, GL_RGBA32UI, mSpec.width, mSpec.height);
+				glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+				glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+				GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(mColorAttachments.size());
+				glNamedFramebufferTexture(mFramebufferID, attachment, texture, 0);
+				drawBuffers.push_back(attachment);
+				mColorAttachments.push_back(texture);
+				mColorFormats.push_back(format);
+				glLabelObject(GL_TEXTURE, texture, "framebuffer id");
+				break;
+			}
+			case FramebufferFormat::Depth24Stencil8:
+				glCreateRenderbuffers(1, &mDepthAttachment);
+				glNamedRenderbufferStorage(mDepthAttachment, GL_DEPTH24_STENCIL8, mSpec.width, mSpec.height);
+				glNamedFramebufferRenderbuffer(mFramebufferID, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mDepthAttachment);
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (!drawBuffers.empty())
+			glNamedFramebufferDrawBuffers(mFramebufferID, static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+
+		if (glCheckNamedFramebufferStatus(mFramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cerr << "Framebuffer is incomplete" << std::endl;
+
+		glLabelObject(GL_FRAMEBUFFER, mFramebufferID, "framebuffer");
+	}
+
+	void Framebuffer::Bind() const {
+		glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
+		glViewport(0, 0, mSpec.width, mSpec.height);
+	}
+
+	void Framebuffer::Unbind() const {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void Framebuffer::Resize(uint32_t width, uint32_t height) {
+		if (width == 0 || height == 0 || (width == mSpec.width && height == mSpec.height))
+			return;
+
+		mSpec.width = width;
+		mSpec.height = height;
+		invalidate();
+	}
+
+	void Framebuffer::ReadPixels(uint32_t attachment, std::vector<uint8_t>& pixels) const {
+		pixels.resize(static_cast<size_t>(mSpec.width) * mSpec.height * 4);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebufferID);
+		glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, mSpec.width, mSpec.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "Base.h"
+
+namespace Gizmo {
+
+	enum class FramebufferFormat { None = 0, RGBA8, RGBA32UI, Depth24Stencil8 };
+
+	struct FramebufferSpec {
+		uint32_t width = 0, height = 0;
+		std::vector<FramebufferFormat> attachments;
+	};
+
+	class Framebuffer {
+	public:
+		Framebuffer(const FramebufferSpec& spec);
+		~Framebuffer();
+
+		Framebuffer(const Framebuffer&) = delete;
+		Framebuffer& operator=(const Framebuffer&) = delete;
+
+		void Bind() const;
+		void Unbind() const;
+
+		void Resize(uint32_t width, uint32_t height);
+
+		// synchronous read of a color attachment, RGBA8 rows bottom-up as GL returns them
+		void ReadPixels(uint32_t attachment, std::vector<uint8_t>& pixels) const;
+
+		uint32_t GetColorAttachment(uint32_t index = 0) const { return mColorAttachments[index]; }
+		const FramebufferSpec& GetSpec() const { return mSpec; }
+		uint32_t GetID() const { return mFramebufferID; }
+
+	private:
+		void invalidate();
+		void release();
+
+		FramebufferSpec mSpec;
+		uint32_t mFramebufferID = 0;
+		std::vector<uint32_t> mColorAttachments;
+		std::vector<FramebufferFormat> mColorFormats;
+		uint32_t mDepthAttachment = 0;
+	};
+
+}
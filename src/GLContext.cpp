@@ -0,0 +1,252 @@
+#include "GLContext.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#ifdef GIZMOS_WITH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef GIZMOS_WITH_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+namespace Gizmo {
+
+	class WindowContext : public GLContext {
+	public:
+		WindowContext(uint32_t width, uint32_t height) : GLContext(ContextBackend::Window, width, height) {}
+
+		~WindowContext() override {
+			if (mWindow)
+				glfwDestroyWindow(mWindow);
+			glfwTerminate();
+		}
+
+		bool init(const char* title) {
+			if (!glfwInit()) {
+				std::cerr << "Failed to initialize GLFW" << std::endl;
+				return false;
+			}
+
+#ifdef GIZMOS_DEBUG
+			glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+			mWindow = glfwCreateWindow(mWidth, mHeight, title, nullptr, nullptr);
+			if (!mWindow) {
+				std::cerr << "Failed to create GLFW window" << std::endl;
+				return false;
+			}
+			glfwMakeContextCurrent(mWindow);
+
+			if (glewInit() != GLEW_OK) {
+				std::cerr << "Failed to initialize GLEW" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		void swapBuffers() override { glfwSwapBuffers(mWindow); }
+		void pollEvents() override { glfwPollEvents(); }
+		bool shouldClose() const override { return glfwWindowShouldClose(mWindow); }
+		double getTime() const override { return glfwGetTime(); }
+		void setVSync(bool enabled) override { glfwSwapInterval(enabled ? 1 : 0); }
+
+		GLFWwindow* getWindow() const override { return mWindow; }
+
+	private:
+		GLFWwindow* mWindow = nullptr;
+	};
+
+	// shared by the offscreen backends: there is no window to poll or close, the caller decides when to stop
+	class HeadlessContext : public GLContext {
+	public:
+		HeadlessContext(ContextBackend backend, uint32_t width, uint32_t height)
+			: GLContext(backend, width, height), mStart(std::chrono::steady_clock::now()) {}
+
+		void swapBuffers() override { glFlush(); }
+		void pollEvents() override {}
+		bool shouldClose() const override { return false; }
+		void setVSync(bool) override {}
+
+		double getTime() const override {
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+		}
+
+	protected:
+		bool initGlew() {
+			// glewInit would also try to load the window-system entry points, which needs a display
+			glewExperimental = GL_TRUE;
+			if (glewContextInit() != GLEW_OK) {
+				std::cerr << "Failed to initialize GLEW" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point mStart;
+	};
+
+#ifdef GIZMOS_WITH_EGL
+	class EGLSurfacelessContext : public HeadlessContext {
+	public:
+		EGLSurfacelessContext(uint32_t width, uint32_t height) : HeadlessContext(ContextBackend::EGLSurfaceless, width, height) {}
+
+		~EGLSurfacelessContext() override {
+			if (mDisplay != EGL_NO_DISPLAY) {
+				eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+				if (mContext != EGL_NO_CONTEXT)
+					eglDestroyContext(mDisplay, mContext);
+				eglTerminate(mDisplay);
+			}
+		}
+
+		bool init() {
+			auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+			if (getPlatformDisplay)
+				mDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			if (mDisplay == EGL_NO_DISPLAY)
+				mDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+			EGLint major = 0, minor = 0;
+			if (mDisplay == EGL_NO_DISPLAY || !eglInitialize(mDisplay, &major, &minor)) {
+				std::cerr << "Failed to initialize EGL display" << std::endl;
+				return false;
+			}
+
+			const EGLint configAttribs[] = {
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+				EGL_DEPTH_SIZE, 24,
+				EGL_NONE
+			};
+			EGLConfig config;
+			EGLint numConfigs = 0;
+			if (!eglChooseConfig(mDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+				std::cerr << "No EGL config for desktop OpenGL" << std::endl;
+				return false;
+			}
+
+			eglBindAPI(EGL_OPENGL_API);
+			const EGLint contextAttribs[] = {
+				EGL_CONTEXT_MAJOR_VERSION, 4,
+				EGL_CONTEXT_MINOR_VERSION, 5,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifdef GIZMOS_DEBUG
+				EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+				EGL_NONE
+			};
+			mContext = eglCreateContext(mDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+			if (mContext == EGL_NO_CONTEXT) {
+				std::cerr << "Failed to create EGL context" << std::endl;
+				return false;
+			}
+
+			// EGL_KHR_surfaceless_context: no pbuffer, everything goes to our framebuffer objects
+			if (!eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext)) {
+				std::cerr << "Failed to make EGL context current (surfaceless)" << std::endl;
+				return false;
+			}
+
+			std::cout << "EGL " << major << "." << minor << " surfaceless context" << std::endl;
+			return initGlew();
+		}
+
+	private:
+		EGLDisplay mDisplay = EGL_NO_DISPLAY;
+		EGLContext mContext = EGL_NO_CONTEXT;
+	};
+#endif
+
+#ifdef GIZMOS_WITH_OSMESA
+	class OSMesaContextBackend : public HeadlessContext {
+	public:
+		OSMesaContextBackend(uint32_t width, uint32_t height) : HeadlessContext(ContextBackend::OSMesa, width, height) {}
+
+		~OSMesaContextBackend() override {
+			if (mContext)
+				OSMesaDestroyContext(mContext);
+		}
+
+		bool init() {
+			const int attribs[] = {
+				OSMESA_FORMAT, OSMESA_RGBA,
+				OSMESA_DEPTH_BITS, 24,
+				OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+				OSMESA_CONTEXT_MAJOR_VERSION, 4,
+				OSMESA_CONTEXT_MINOR_VERSION, 5,
+				0
+			};
+			mContext = OSMesaCreateContextAttribs(attribs, nullptr);
+			if (!mContext) {
+				std::cerr << "Failed to create OSMesa context" << std::endl;
+				return false;
+			}
+
+			// OSMesa needs a color buffer to make the context current, the frames themselves go to FBOs
+			mBackBuffer.resize(static_cast<size_t>(mWidth) * mHeight * 4);
+			if (!OSMesaMakeCurrent(mContext, mBackBuffer.data(), GL_UNSIGNED_BYTE, mWidth, mHeight)) {
+				std::cerr << "Failed to make OSMesa context current" << std::endl;
+				return false;
+			}
+
+			std::cout << "OSMesa context" << std::endl;
+			return initGlew();
+		}
+
+	private:
+		OSMesaContext mContext = nullptr;
+		std::vector<uint8_t> mBackBuffer;
+	};
+#endif
+
+	Scope<GLContext> GLContext::Create(ContextBackend backend, uint32_t width, uint32_t height, const char* title) {
+		switch (backend)
+		{
+		case ContextBackend::Window: {
+			auto context = CreateScope<WindowContext>(width, height);
+			if (context->init(title))
+				return context;
+			return nullptr;
+		}
+		case ContextBackend::EGLSurfaceless: {
+#ifdef GIZMOS_WITH_EGL
+			auto context = CreateScope<EGLSurfacelessContext>(width, height);
+			if (context->init())
+				return context;
+#else
+			std::cerr << "Built without EGL support (GIZMOS_HEADLESS_EGL)" << std::endl;
+#endif
+			return nullptr;
+		}
+		case ContextBackend::OSMesa: {
+#ifdef GIZMOS_WITH_OSMESA
+			auto context = CreateScope<OSMesaContextBackend>(width, height);
+			if (context->init())
+				return context;
+#else
+			std::cerr << "Built without OSMesa support (GIZMOS_HEADLESS_OSMESA)" << std::endl;
+#endif
+			return nullptr;
+		}
+		}
+		return nullptr;
+	}
+
+	bool GLContext::ParseBackend(const std::string& name, ContextBackend& backend) {
+		if (name == "window") { backend = ContextBackend::Window; return true; }
+		if (name == "egl") { backend = ContextBackend::EGLSurfaceless; return true; }
+		if (name == "osmesa") { backend = ContextBackend::OSMesa; return true; }
+		return false;
+	}
+
+}
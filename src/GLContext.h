@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "Base.h"
+
+struct GLFWwindow;
+
+namespace Gizmo {
+
+	enum class ContextBackend { Window = 0, EGLSurfaceless, OSMesa };
+
+	// Owns the GL context and the clock. The window backend goes through GLFW, the headless
+	// backends create an offscreen context with no default framebuffer, so render into a Framebuffer.
+	class GLContext {
+	public:
+		virtual ~GLContext() = default;
+
+		static Scope<GLContext> Create(ContextBackend backend, uint32_t width, uint32_t height, const char* title);
+		static bool ParseBackend(const std::string& name, ContextBackend& backend);
+
+		virtual void swapBuffers() = 0;
+		virtual void pollEvents() = 0;
+		virtual bool shouldClose() const = 0;
+		virtual double getTime() const = 0;
+		virtual void setVSync(bool enabled) = 0;
+
+		virtual GLFWwindow* getWindow() const { return nullptr; }
+		bool isHeadless() const { return mBackend != ContextBackend::Window; }
+
+		ContextBackend getBackend() const { return mBackend; }
+		uint32_t getWidth() const { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+
+	protected:
+		GLContext(ContextBackend backend, uint32_t width, uint32_t height) : mBackend(backend), mWidth(width), mHeight(height) {}
+
+		ContextBackend mBackend;
+		uint32_t mWidth;
+		uint32_t mHeight;
+	};
+
+}
@@ -5,7 +5,7 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/quaternion.hpp>
 
-#include "openglUtil.h"
+#include "OpenGLUtil.h"
 #include "shaderprogram.h"
 #include "Input.h"
 
@@ -22,10 +22,11 @@ std::vector<GLfloat> vertices[3];
 std::vector<GLuint> indices[3];
 GLuint VAO[3], VBO[3], EBO[3];
 GLuint circVAO, circVBO, circEBO;
+Gizmo::StreamingBuffer* gStream = nullptr;
 
 struct Context {
 
-	Context() :usingGizmo(false) {};
+	Context() :usingGizmo(false), pickedType(-1) {};
 
 	glm::mat4 viewMat;
 	glm::mat4 projectionMat;
@@ -52,6 +53,8 @@ struct Context {
 	uint32_t type;
 	uint32_t mainType;
 	bool usingGizmo;
+
+	int pickedType; // from the id pass, -1 when picking is not running
 };
 
 struct Context gContext;
@@ -99,6 +102,10 @@ namespace gizmo {
 
 			//glBindBuffer(GL_ARRAY_BUFFER, 0);
 			glBindVertexArray(0);
+
+			glLabelObject(GL_VERTEX_ARRAY, VAO[axis], "gizmo ring VAO");
+			glLabelObject(GL_BUFFER, VBO[axis], "gizmo ring VBO");
+			glLabelObject(GL_BUFFER, EBO[axis], "gizmo ring EBO");
 		}
 
 		std::vector<glm::vec3> circleVert(numSegments);
@@ -122,6 +129,9 @@ namespace gizmo {
 		glEnableVertexAttribArray(0);
 
 		glBindVertexArray(0);
+
+		glLabelObject(GL_VERTEX_ARRAY, circVAO, "gizmo circle VAO");
+		glLabelObject(GL_BUFFER, circVBO, "gizmo circle VBO");
 	}
 
 	void DecomposeTransform(const glm::mat4& modelMatrix, glm::vec3& translation, glm::vec3& rotation, glm::vec3& scale) {
@@ -332,6 +342,9 @@ namespace gizmo {
 			}
 		}
 
+		if (gContext.pickedType >= 0)
+			gContext.type = gContext.pickedType;
+
 
 		if (!gContext.usingGizmo) {
 			gContext.mainType = gContext.type;
@@ -396,7 +409,7 @@ namespace gizmo {
 
 	}
 
-	void drawRotationGizmo() {
+	void updateRotationGizmo() {
 		glm::vec4 cameraToModelNormalized = glm::normalize(gContext.model[3] - gContext.cameraEye);
 		cameraToModelNormalized = TransformVector(glm::inverse(gContext.model), cameraToModelNormalized);
 
@@ -416,6 +429,26 @@ namespace gizmo {
 				vertices[axis].push_back(axisPos.y);
 				vertices[axis].push_back(axisPos.z);
 			}
+
+			glBindVertexArray(VAO[axis]);
+			Gizmo::StreamingBuffer::Allocation streamed;
+			if (gStream)
+				streamed = gStream->upload(vertices[axis].data(), sizeof(float) * vertices[axis].size());
+			if (streamed) {
+				glBindBuffer(GL_ARRAY_BUFFER, streamed.buffer);
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<const GLvoid*>(streamed.offset));
+			}
+			else {
+				glBindBuffer(GL_ARRAY_BUFFER, VBO[axis]);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices[axis].size(), vertices[axis].data(), GL_DYNAMIC_DRAW);
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+			}
+		}
+		glBindVertexArray(0);
+	}
+
+	void drawRotationGizmo() {
+		for (unsigned int axis = 0; axis < 3; axis++) {
 			glm::vec3 axisColor = (axis == 0) ? glm::vec3(1.0f, 0.0f, 0.0f) : (axis == 1) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
 
 			if (axis == gContext.mainType - 1) {
@@ -426,8 +459,6 @@ namespace gizmo {
 			gDefaultShader.use();
 
 			glBindVertexArray(VAO[axis]);
-			glBindBuffer(GL_ARRAY_BUFFER, VBO[axis]);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices[axis].size(), vertices[axis].data(), GL_DYNAMIC_DRAW);
 
 			glUniformMatrix4fv(gDefaultShader.u("V"), 1, GL_FALSE, glm::value_ptr(gContext.viewMat));
 			glUniformMatrix4fv(gDefaultShader.u("P"), 1, GL_FALSE, glm::value_ptr(gContext.projectionMat));
@@ -466,4 +497,32 @@ namespace gizmo {
 		glEnable(GL_DEPTH_TEST);
 		
 	}
+
+	void drawRotationGizmoIds(ShaderProgram& shader, uint32_t objectID) {
+		glDisable(GL_DEPTH_TEST);
+		shader.use();
+
+		glUniformMatrix4fv(shader.u("V"), 1, GL_FALSE, glm::value_ptr(gContext.viewMat));
+		glUniformMatrix4fv(shader.u("P"), 1, GL_FALSE, glm::value_ptr(gContext.projectionMat));
+		glUniformMatrix4fv(shader.u("M"), 1, GL_FALSE, glm::value_ptr(gContext.model));
+
+		// wider than the visible ring so the hit area is comfortable to grab
+		glLineWidth(9.0f);
+		for (unsigned int axis = 0; axis < 3; axis++) {
+			glUniform4ui(shader.u("uID"), objectID, axis + 1, 0xFFFFFFFFu, 0xFFFFFFFFu);
+			glBindVertexArray(VAO[axis]);
+			glDrawElements(GL_LINES, static_cast<GLsizei>(indices[axis].size()), GL_UNSIGNED_INT, 0);
+		}
+		glLineWidth(3.0f);
+
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	void setStreamingBuffer(Gizmo::StreamingBuffer* stream) {
+		gStream = stream;
+	}
+
+	void setPickedAxis(int axis) {
+		gContext.pickedType = axis;
+	}
 }
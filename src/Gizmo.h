@@ -10,6 +10,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "shaderprogram.h"
+#include "StreamingBuffer.h"
+
 namespace gizmo {
 	void DecomposeTransform(const glm::mat4& modelMatrix, glm::vec3& translation, glm::vec3& rotation, glm::vec3& scale);
 	glm::vec4 TransformVector(const glm::mat4& matrix, glm::vec4 in);
@@ -21,10 +24,19 @@ namespace gizmo {
 	float IntersectRayPlane(const glm::vec4& rOrigin, const glm::vec4& rVector, const glm::vec4& plan);
 
 	void init();
+	// the ring vertices rebuilt every frame go to <stream>, nullptr goes back to glBufferData
+	void setStreamingBuffer(Gizmo::StreamingBuffer* stream);
 
 	void manipulate(glm::mat4* view, glm::mat4* projection, glm::mat4* matrix, glm::mat4* delta); 
 
+	// rebuilds and uploads the ring vertices, once a frame before drawRotationGizmo and drawRotationGizmoIds
+	void updateRotationGizmo();
 	void drawRotationGizmo();
+
+	// draws the rings into an id pass, uID = (objectID, axis 1..3, -, -)
+	void drawRotationGizmoIds(ShaderProgram& shader, uint32_t objectID);
+	// hovered axis from the id pass (0 = none), overrides the screen-distance test; -1 goes back to it
+	void setPickedAxis(int axis);
 }
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "GpuTimer.h"
+
+namespace Gizmo {
+
+	GpuTimer::GpuTimer(uint32_t ringSize) : mSlots(ringSize) {
+		for (Slot& slot : mSlots)
+			glGenQueries(2, slot.queries);
+	}
+
+	GpuTimer::~GpuTimer() {
+		for (Slot& slot : mSlots)
+			glDeleteQueries(2, slot.queries);
+	}
+
+	void GpuTimer::begin() {
+		collect();
+		mSkipping = mInFlight == mSlots.size();
+		if (mSkipping)
+			return;
+
+		glQueryCounter(mSlots[mHead].queries[0], GL_TIMESTAMP);
+	}
+
+	void GpuTimer::end() {
+		if (mSkipping)
+			return;
+
+		Slot& slot = mSlots[mHead];
+		glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+		slot.pending = true;
+		mHead = (mHead + 1) % mSlots.size();
+		mInFlight++;
+	}
+
+	void GpuTimer::collect() {
+		while (mInFlight > 0) {
+			Slot& slot = mSlots[mTail];
+			GLint available = 0;
+			glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				return;
+
+			GLuint64 start = 0, stop = 0;
+			glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &stop);
+			mLastMs = (stop - start) * 1e-6;
+			mTotalMs += mLastMs;
+			mSamples++;
+
+			slot.pending = false;
+			mTail = (mTail + 1) % mSlots.size();
+			mInFlight--;
+		}
+	}
+
+}
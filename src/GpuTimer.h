@@ -0,0 +1,46 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace Gizmo {
+
+	// GPU time between begin() and end(), measured with timestamp queries so timers may nest
+	// and interleave. Results are read a few frames late and never block; when every slot is
+	// still waiting for the GPU the measurement is skipped.
+	class GpuTimer {
+	public:
+		GpuTimer(uint32_t ringSize = 4);
+		~GpuTimer();
+
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+
+		void begin();
+		void end();
+
+		// newest finished measurement and a running average over the finished ones
+		double getMs() const { return mLastMs; }
+		double getAverageMs() const { return mSamples ? mTotalMs / mSamples : 0.0; }
+		uint32_t getSampleCount() const { return mSamples; }
+		void resetAverage() { mTotalMs = 0.0; mSamples = 0; }
+
+	private:
+		struct Slot {
+			GLuint queries[2] = { 0, 0 };
+			bool pending = false;
+		};
+
+		void collect();
+
+		std::vector<Slot> mSlots;
+		uint32_t mHead = 0, mTail = 0, mInFlight = 0;
+		bool mSkipping = false;
+
+		double mLastMs = 0.0;
+		double mTotalMs = 0.0;
+		uint32_t mSamples = 0;
+	};
+
+}
@@ -0,0 +1,166 @@
+#include "Image.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <stb_image.h>
+
+namespace Gizmo {
+
+	namespace {
+
+		struct CrcTable {
+			uint32_t entries[256];
+		};
+
+		uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+			// built once by the thread-safe static init, PNGs are written from the capture worker too
+			static const CrcTable crcTable = [] {
+				CrcTable table;
+				for (uint32_t n = 0; n < 256; n++) {
+					uint32_t c = n;
+					for (int k = 0; k < 8; k++)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					table.entries[n] = c;
+				}
+				return table;
+			}();
+
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++)
+				crc = crcTable.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		void putU32(std::vector<uint8_t>& out, uint32_t value) {
+			out.push_back(static_cast<uint8_t>(value >> 24));
+			out.push_back(static_cast<uint8_t>(value >> 16));
+			out.push_back(static_cast<uint8_t>(value >> 8));
+			out.push_back(static_cast<uint8_t>(value));
+		}
+
+		void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+			putU32(out, static_cast<uint32_t>(data.size()));
+			size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			putU32(out, crc32(out.data() + start, out.size() - start));
+		}
+	}
+
+	void encodePNG(const Image& image, std::vector<uint8_t>& out) {
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		static const uint8_t colorTypes[5] = { 0, 0, 4, 2, 6 }; // by channel count
+
+		out.clear();
+		out.insert(out.end(), signature, signature + 8);
+
+		std::vector<uint8_t> header;
+		putU32(header, image.width);
+		putU32(header, image.height);
+		header.push_back(8);
+		header.push_back(colorTypes[image.channels]);
+		header.push_back(0); header.push_back(0); header.push_back(0);
+		putChunk(out, "IHDR", header);
+
+		// scanlines with filter byte 0, wrapped in stored deflate blocks of at most 65535 bytes
+		const size_t rowSize = static_cast<size_t>(image.width) * image.channels;
+		std::vector<uint8_t> raw;
+		raw.reserve((rowSize + 1) * image.height);
+		for (uint32_t y = 0; y < image.height; y++) {
+			raw.push_back(0);
+			const uint8_t* row = image.pixels.data() + y * rowSize;
+			raw.insert(raw.end(), row, row + rowSize);
+		}
+
+		std::vector<uint8_t> zlib;
+		zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+		zlib.push_back(0x78);
+		zlib.push_back(0x01);
+
+		uint32_t a = 1, b = 0;
+		size_t offset = 0;
+		do {
+			size_t blockSize = std::min<size_t>(65535, raw.size() - offset);
+			bool last = offset + blockSize == raw.size();
+			zlib.push_back(last ? 1 : 0);
+			zlib.push_back(static_cast<uint8_t>(blockSize));
+			zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+			zlib.push_back(static_cast<uint8_t>(~blockSize));
+			zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+			for (size_t i = 0; i < blockSize; i++) {
+				uint8_t value = raw[offset + i];
+				zlib.push_back(value);
+				a = (a + value) % 65521;
+				b = (b + a) % 65521;
+			}
+			offset += blockSize;
+		} while (offset < raw.size());
+		putU32(zlib, (b << 16) | a);
+
+		putChunk(out, "IDAT", zlib);
+		putChunk(out, "IEND", {});
+	}
+
+	bool writePNG(const std::string& path, const Image& image) {
+		std::vector<uint8_t> png;
+		encodePNG(image, png);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open " << path << " for writing" << std::endl;
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(png.data()), png.size());
+		return static_cast<bool>(file);
+	}
+
+	bool loadImage(const std::string& path, Image& image) {
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load_thread(false);
+		unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+		if (!data) {
+			std::cerr << "Failed to load image: " << path << "\n";
+			return false;
+		}
+
+		image.width = width;
+		image.height = height;
+		image.channels = 4;
+		image.pixels.assign(data, data + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(data);
+		return true;
+	}
+
+	void flipVertically(Image& image) {
+		const size_t rowSize = static_cast<size_t>(image.width) * image.channels;
+		for (uint32_t y = 0; y < image.height / 2; y++) {
+			uint8_t* top = image.pixels.data() + y * rowSize;
+			uint8_t* bottom = image.pixels.data() + (image.height - 1 - y) * rowSize;
+			std::swap_ranges(top, top + rowSize, bottom);
+		}
+	}
+
+	bool compareImages(const Image& a, const Image& b, ImageDiff& diff) {
+		diff = ImageDiff();
+		if (a.width != b.width || a.height != b.height || a.channels != b.channels)
+			return false;
+
+		uint64_t total = 0;
+		for (size_t p = 0; p < a.pixels.size(); p += a.channels) {
+			bool differs = false;
+			for (uint32_t c = 0; c < a.channels; c++) {
+				uint32_t error = static_cast<uint32_t>(std::abs(int(a.pixels[p + c]) - int(b.pixels[p + c])));
+				total += error;
+				diff.maxError = std::max(diff.maxError, error);
+				differs |= error != 0;
+			}
+			diff.differingPixels += differs ? 1 : 0;
+		}
+		diff.meanError = a.pixels.empty() ? 0.0 : double(total) / double(a.pixels.size());
+		return true;
+	}
+
+}
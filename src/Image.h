@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Gizmo {
+
+	struct Image {
+		uint32_t width = 0, height = 0;
+		uint32_t channels = 4;
+		std::vector<uint8_t> pixels; // rows top-down
+	};
+
+	// PNG with stored (uncompressed) deflate blocks: no zlib dependency and cheap enough for captures
+	void encodePNG(const Image& image, std::vector<uint8_t>& out);
+	bool writePNG(const std::string& path, const Image& image);
+	bool loadImage(const std::string& path, Image& image);
+
+	// GL readbacks are bottom-up
+	void flipVertically(Image& image);
+
+	struct ImageDiff {
+		double meanError = 0.0;   // mean absolute channel difference, 0..255
+		uint32_t maxError = 0;
+		uint32_t differingPixels = 0;
+	};
+
+	bool compareImages(const Image& a, const Image& b, ImageDiff& diff);
+
+}
@@ -9,6 +9,7 @@ void Input::Init(GLFWwindow* window) {
 bool Input::IsKeyPressed(int32_t key)
 {
 	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return false;
 	auto state = glfwGetKey(window, static_cast<int32_t>(key));
 	return state == GLFW_PRESS;
 }
@@ -16,6 +17,7 @@ bool Input::IsKeyPressed(int32_t key)
 bool Input::IsKeyReleased(int32_t key)
 {
 	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return true;
 	auto state = glfwGetKey(window, static_cast<int32_t>(key));
 	return state == GLFW_RELEASE;
 }
@@ -23,6 +25,7 @@ bool Input::IsKeyReleased(int32_t key)
 bool Input::IsMouseButtonPressed(int32_t button)
 {
 	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return false;
 	auto state = glfwGetMouseButton(window, static_cast<int32_t>(button));
 	return state == GLFW_PRESS;
 }
@@ -30,6 +33,7 @@ bool Input::IsMouseButtonPressed(int32_t button)
 bool Input::IsMouseButtonReleased(int32_t button)
 {
 	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return true;
 	auto state = glfwGetMouseButton(window, static_cast<int32_t>(button));
 	return state == GLFW_RELEASE;
 }
@@ -37,12 +41,25 @@ bool Input::IsMouseButtonReleased(int32_t button)
 glm::vec2 Input::GetMousePosition()
 {
 	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return { 0.0f, 0.0f }; // headless, no cursor
 	double xpos, ypos;
 	glfwGetCursorPos(window, &xpos, &ypos);
 
 	return { (float)xpos, (float)ypos };
 }
 
+glm::vec2 Input::GetFramebufferScale()
+{
+	auto* window = static_cast<GLFWwindow*>(sWindow);
+	if (!window) return { 1.0f, 1.0f };
+	int windowWidth, windowHeight, framebufferWidth, framebufferHeight;
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	if (windowWidth <= 0 || windowHeight <= 0) return { 1.0f, 1.0f }; // minimised
+
+	return { (float)framebufferWidth / windowWidth, (float)framebufferHeight / windowHeight };
+}
+
 float Input::GetMouseX()
 {
 	return GetMousePosition().x;
@@ -14,6 +14,8 @@ public:
 	static glm::vec2 GetMousePosition();
 	static float GetMouseX();
 	static float GetMouseY();
+	// framebuffer pixels per window unit, above 1 on HiDPI displays
+	static glm::vec2 GetFramebufferScale();
 	static void Init(GLFWwindow* window); 
 private: 
 	static GLFWwindow* sWindow; 
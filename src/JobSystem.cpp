@@ -0,0 +1,241 @@
+#include "JobSystem.h"
+
+#include <cmath>
+
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		// which system the current thread works for and the queue it owns there
+		thread_local const JobSystem* tOwner = nullptr;
+		thread_local uint32_t tQueue = 0;
+	}
+
+	JobSystem::JobSystem(uint32_t threadCount) : mQueued(0), mSteals(0), mStop(false) {
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			mQueues.push_back(std::unique_ptr<Queue>(new Queue()));
+		for (uint32_t i = 0; i + 1 < threadCount; i++)
+			mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mStop = true;
+		}
+		mWake.notify_all();
+		for (std::thread& worker : mWorkers)
+			worker.join();
+	}
+
+	JobSystem& JobSystem::get() {
+		static JobSystem instance;
+		return instance;
+	}
+
+	uint32_t JobSystem::currentQueue() const {
+		return tOwner == this ? tQueue : 0;
+	}
+
+	void JobSystem::run(std::function<void()> job, JobCounter* counter) {
+		if (counter)
+			counter->mValue.fetch_add(1, std::memory_order_relaxed);
+		push({ std::move(job), counter });
+	}
+
+	void JobSystem::runAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter) {
+		if (counter)
+			counter->mValue.fetch_add(1, std::memory_order_relaxed);
+		{
+			// finish() decrements under the same lock, so the job is either parked or queued here, never lost
+			std::lock_guard<std::mutex> lock(dependency.mMutex);
+			if (dependency.mValue.load(std::memory_order_acquire) != 0) {
+				dependency.mContinuations.emplace_back(std::move(job), counter);
+				return;
+			}
+		}
+		push({ std::move(job), counter });
+	}
+
+	void JobSystem::wait(JobCounter& counter) {
+		while (!counter.isDone()) {
+			if (!tryRunOne(false))
+				std::this_thread::yield();
+		}
+		// the last finish() may still hold the lock, the counter must outlive it
+		std::lock_guard<std::mutex> lock(counter.mMutex);
+	}
+
+	void JobSystem::runBackground(std::function<void()> job, JobCounter* counter) {
+		if (counter)
+			counter->mValue.fetch_add(1, std::memory_order_relaxed);
+		push(mBackground, { std::move(job), counter });
+	}
+
+	void JobSystem::waitBackground(JobCounter& counter) {
+		while (!counter.isDone()) {
+			Job job;
+			if (!popBackground(job)) {
+				std::this_thread::yield();
+				continue;
+			}
+			job.function();
+			finish(job);
+		}
+		std::lock_guard<std::mutex> lock(counter.mMutex);
+	}
+
+	void JobSystem::push(Job job) {
+		push(*mQueues[currentQueue()], std::move(job));
+	}
+
+	void JobSystem::push(Queue& queue, Job job) {
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+			mQueued.fetch_add(1, std::memory_order_release);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+		}
+		mWake.notify_one();
+	}
+
+	bool JobSystem::pop(uint32_t index, Job& job) {
+		Queue& queue = *mQueues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return false;
+		job = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+		mQueued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool JobSystem::popBackground(Job& job) {
+		std::lock_guard<std::mutex> lock(mBackground.mutex);
+		if (mBackground.jobs.empty())
+			return false;
+		job = std::move(mBackground.jobs.front());
+		mBackground.jobs.pop_front();
+		mQueued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool JobSystem::steal(uint32_t thief, Job& job) {
+		const uint32_t count = static_cast<uint32_t>(mQueues.size());
+		for (uint32_t i = 1; i < count; i++) {
+			Queue& queue = *mQueues[(thief + i) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty())
+				continue;
+			// oldest job: usually the biggest remaining piece and cold in the owner's cache anyway
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			mQueued.fetch_sub(1, std::memory_order_relaxed);
+			mSteals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	bool JobSystem::tryRunOne(bool background) {
+		uint32_t queue = currentQueue();
+		Job job;
+		// background jobs last
+		if (!pop(queue, job) && !steal(queue, job) && (!background || !popBackground(job)))
+			return false;
+
+		job.function();
+		finish(job);
+		return true;
+	}
+
+	void JobSystem::finish(Job& job) {
+		if (!job.counter)
+			return;
+
+		std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job.counter->mMutex);
+			if (job.counter->mValue.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				continuations.swap(job.counter->mContinuations);
+		}
+		for (auto& continuation : continuations)
+			push({ std::move(continuation.first), continuation.second });
+	}
+
+	void JobSystem::workerLoop(uint32_t index) {
+		tOwner = this;
+		tQueue = index + 1;
+		while (!mStop.load(std::memory_order_acquire)) {
+			if (tryRunOne(true))
+				continue;
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			mWake.wait(lock, [this] { return mStop.load() || mQueued.load(std::memory_order_acquire) > 0; });
+		}
+	}
+
+	namespace {
+		void benchmarkJobSystem(std::vector<BenchmarkResult>& results) {
+			// a compute bound parallel-for and a flood of tiny jobs, for 1, 2, 4, ... threads
+			const uint32_t items = 1 << 20, tinyJobs = 10000;
+			std::vector<float> data(items);
+			uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+			for (uint32_t threads = 1; ; threads *= 2) {
+				threads = std::min(threads, hardwareThreads);
+				JobSystem jobs(threads);
+
+				BenchmarkResult work = runBenchmark("parallelFor 1M items, " + std::to_string(threads) + " threads", 20, [&](uint32_t iteration) {
+					jobs.parallelFor(items, 4096, [&](uint32_t begin, uint32_t end) {
+						for (uint32_t i = begin; i < end; i++)
+							data[i] = std::sin(i * 0.001f + iteration) * std::cos(i * 0.002f);
+					});
+				});
+				work.itemsPerIteration = items;
+				work.itemName = "item";
+				results.push_back(work);
+
+				std::atomic<uint32_t> sum(0);
+				BenchmarkResult tiny = runBenchmark("10k empty jobs, " + std::to_string(threads) + " threads", 20, [&](uint32_t) {
+					JobCounter counter;
+					for (uint32_t j = 0; j < tinyJobs; j++)
+						jobs.run([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+					jobs.wait(counter);
+				});
+				tiny.itemsPerIteration = tinyJobs;
+				tiny.itemName = "job";
+				results.push_back(tiny);
+
+				// a chain of dependent stages, each one waiting on the counter of the previous
+				BenchmarkResult chain = runBenchmark("100 dependent stages, " + std::to_string(threads) + " threads", 20, [&](uint32_t) {
+					std::vector<std::unique_ptr<JobCounter>> stages;
+					stages.push_back(std::unique_ptr<JobCounter>(new JobCounter()));
+					jobs.run([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, stages.back().get());
+					for (int s = 1; s < 100; s++) {
+						stages.push_back(std::unique_ptr<JobCounter>(new JobCounter()));
+						jobs.runAfter(*stages[s - 1], [&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, stages.back().get());
+					}
+					jobs.wait(*stages.back());
+					for (auto& stage : stages)
+						jobs.wait(*stage);
+				});
+				chain.itemsPerIteration = 100;
+				chain.itemName = "stage";
+				results.push_back(chain);
+
+				printf("[bench] jobs: %u threads, %llu steals\n", threads, static_cast<unsigned long long>(jobs.getStealCount()));
+				if (threads == hardwareThreads)
+					break;
+			}
+		}
+
+		bool sRegistered = registerBenchmark("jobs", &benchmarkJobSystem);
+	}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+namespace Gizmo {
+
+	// Number of jobs in flight, used as a fence (JobSystem::wait) and as a dependency
+	// (JobSystem::runAfter). A counter may be reused once it reached zero.
+	class JobCounter {
+	public:
+		JobCounter() : mValue(0) {}
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool isDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int32_t> mValue;
+		std::mutex mMutex;
+		std::vector<std::pair<std::function<void()>, JobCounter*>> mContinuations; // released when mValue hits zero
+	};
+
+	// Work-stealing scheduler: every worker owns a deque, pushes and pops at the back (newest
+	// first, cache warm) and steals from the front of the others when it runs dry. Threads
+	// that are not workers push to a shared queue. A thread waiting on a counter runs jobs
+	// instead of blocking, so jobs may wait on jobs they spawned.
+	class JobSystem {
+	public:
+		JobSystem(uint32_t threadCount = 0); // including the calling thread, 0 = one per hardware thread
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// engine-wide instance, created on first use
+		static JobSystem& get();
+
+		// <counter> is incremented now and decremented when <job> has run
+		void run(std::function<void()> job, JobCounter* counter = nullptr);
+		// <job> is only queued once <dependency> reached zero
+		void runAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+		void wait(JobCounter& counter);
+
+		// Low priority work, off the frame's critical path: workers take it only when they find
+		// nothing else and wait() never runs it, so a frame waiting on its own jobs is not held up
+		// by it. Keep each job short, a worker is busy with it until it returns.
+		void runBackground(std::function<void()> job, JobCounter* counter = nullptr);
+		// for the thread that queued background work: runs background jobs, and only those, until <counter> reached zero
+		void waitBackground(JobCounter& counter);
+
+		// fn(begin, end) over [0, count) in ranges of at least <minBatch>; the caller takes the first range
+		template<typename Fn>
+		void parallelFor(uint32_t count, uint32_t minBatch, Fn&& fn) {
+			if (count == 0)
+				return;
+			// a few ranges per thread so stealing can even out uneven ranges
+			uint32_t batches = std::min(getThreadCount() * 4, (count + std::max(1u, minBatch) - 1) / std::max(1u, minBatch));
+			if (batches <= 1) {
+				fn(0u, count);
+				return;
+			}
+
+			uint32_t size = (count + batches - 1) / batches;
+			JobCounter counter;
+			for (uint32_t begin = size; begin < count; begin += size) {
+				uint32_t end = std::min(count, begin + size);
+				run([&fn, begin, end] { fn(begin, end); }, &counter);
+			}
+			fn(0u, size);
+			wait(counter);
+		}
+
+		uint32_t getThreadCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+		uint64_t getStealCount() const { return mSteals.load(std::memory_order_relaxed); }
+
+	private:
+		struct Job {
+			std::function<void()> function;
+			JobCounter* counter;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void push(Job job);
+		void push(Queue& queue, Job job);
+		bool popBackground(Job& job);
+		// <background> only from a worker's own loop, a wait() must not get stuck behind background work
+		bool tryRunOne(bool background);
+		bool pop(uint32_t queue, Job& job);
+		bool steal(uint32_t thief, Job& job);
+		void finish(Job& job);
+		void workerLoop(uint32_t index);
+		uint32_t currentQueue() const;
+
+		std::vector<std::unique_ptr<Queue>> mQueues; // 0 is shared by non-worker threads, worker i owns i + 1
+		Queue mBackground;
+		std::vector<std::thread> mWorkers;
+		std::mutex mSleepMutex;
+		std::condition_variable mWake;
+		std::atomic<uint32_t> mQueued;
+		std::atomic<uint64_t> mSteals;
+		std::atomic<bool> mStop;
+	};
+
+}
@@ -0,0 +1,109 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Gizmo {
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			close();
+			std::swap(mData, other.mData);
+			std::swap(mSize, other.mSize);
+			std::swap(mOpen, other.mOpen);
+#ifdef _WIN32
+			std::swap(mFile, other.mFile);
+			std::swap(mMapping, other.mMapping);
+#endif
+		}
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path) {
+		close();
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) {
+			CloseHandle(file);
+			return false;
+		}
+		mFile = file;
+		mSize = static_cast<size_t>(size.QuadPart);
+		mOpen = true;
+		if (mSize == 0)
+			return true;
+
+		mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		mData = mMapping ? static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!mData) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile)
+			CloseHandle(mFile);
+		mData = nullptr;
+		mMapping = mFile = nullptr;
+		mSize = 0;
+		mOpen = false;
+	}
+#else
+	bool MappedFile::open(const std::string& path) {
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			return false;
+		}
+		mSize = static_cast<size_t>(info.st_size);
+		mOpen = true;
+		if (mSize > 0) {
+			// the mapping keeps its own reference to the file
+			void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				::close(fd);
+				close();
+				return false;
+			}
+			madvise(data, mSize, MADV_SEQUENTIAL);
+			mData = static_cast<const uint8_t*>(data);
+		}
+		::close(fd);
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (mData)
+			munmap(const_cast<uint8_t*>(mData), mSize);
+		mData = nullptr;
+		mSize = 0;
+		mOpen = false;
+	}
+#endif
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace Gizmo {
+
+	// Read-only view of a whole file through the OS page cache, no copy into process memory.
+	// Pages are faulted in on first touch, so opening is cheap whatever the file size.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile() { close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// false when the file is missing or cannot be mapped; an empty file opens with size 0
+		bool open(const std::string& path);
+		void close();
+
+		const uint8_t* data() const { return mData; }
+		size_t size() const { return mSize; }
+		bool isOpen() const { return mOpen; }
+
+	private:
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+		bool mOpen = false;
+#ifdef _WIN32
+		void* mFile = nullptr;
+		void* mMapping = nullptr;
+#endif
+	};
+
+}
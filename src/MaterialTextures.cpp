@@ -0,0 +1,79 @@
+#include "MaterialTextures.h"
+
+#include <algorithm>
+#include <string>
+
+namespace Gizmo {
+
+	MaterialTextures::MaterialTextures(const std::vector<TextureHandle>& textures, uint32_t slot) : mMaterials(textures.size()) {
+		struct Group {
+			uint32_t width, height, levelCount;
+			GLenum format;
+			std::vector<uint32_t> materials;
+		};
+		std::vector<Group> groups;
+		for (uint32_t i = 0; i < textures.size(); i++) {
+			Texture2D* texture = textures[i] ? textures[i].get() : nullptr;
+			if (!texture || texture->getInternalFormat() == 0)
+				continue;
+
+			uint32_t width = texture->getWidth(), height = texture->getHeight();
+			auto group = std::find_if(groups.begin(), groups.end(), [&](const Group& g) {
+				return g.width == width && g.height == height && g.format == texture->getInternalFormat();
+			});
+			if (group == groups.end())
+				group = groups.insert(groups.end(), { width, height, texture->getLevelCount(), texture->getInternalFormat(), {} });
+			group->levelCount = std::min(group->levelCount, texture->getLevelCount());
+			group->materials.push_back(i);
+		}
+
+		for (const Group& group : groups) {
+			int32_t array = static_cast<int32_t>(mArrays.size());
+			std::string name = "materials " + std::to_string(group.width) + "x" + std::to_string(group.height);
+			mArrays.push_back(CreateScope<TextureArray>(group.width, group.height, static_cast<uint32_t>(group.materials.size()),
+				group.levelCount, group.format, name, slot));
+
+			mLayers.emplace_back();
+			for (uint32_t material : group.materials) {
+				mMaterials[material] = { array, static_cast<float>(mLayers.back().size()) };
+				mLayers.back().push_back({ textures[material], material, group.levelCount });
+			}
+		}
+
+		// its own 1x1 array, no layer of the material arrays has to be complete for it
+		const uint8_t white[4] = { 255, 255, 255, 255 };
+		mDefault = { static_cast<int32_t>(mArrays.size()), 0.0f };
+		mArrays.push_back(CreateScope<TextureArray>(1, 1, 1, 1, GL_RGBA8, "materials default", slot));
+		mArrays.back()->clearLayer(0, white);
+		mLayers.emplace_back();
+		update();
+	}
+
+	void MaterialTextures::update() {
+		mPending = 0;
+		for (uint32_t a = 0; a < mArrays.size(); a++) {
+			TextureArray& array = *mArrays[a];
+			uint32_t base = 0;
+			for (uint32_t index = 0; index < mLayers[a].size(); index++) {
+				Layer& layer = mLayers[a][index];
+				if (layer.texture) {
+					// keeps the source bound this frame, so the manager does not evict it half copied
+					Texture2D* source = layer.texture.get();
+					uint32_t resident = source->getBaseLevel();
+					if (resident < layer.copiedBase) {
+						array.copyLevels(index, *source, resident, layer.copiedBase - 1);
+						layer.copiedBase = resident;
+					}
+					if (layer.copiedBase == 0)
+						layer.texture.reset();
+					else
+						mPending++;
+				}
+				base = std::max(base, layer.copiedBase);
+			}
+			if (base != array.getBaseLevel())
+				array.setBaseLevel(base);
+		}
+	}
+
+}
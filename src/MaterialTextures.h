@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Base.h"
+#include "TextureArray.h"
+#include "TextureManager.h"
+
+namespace Gizmo {
+
+	// Packs material textures into as few TextureArrays as their sizes and formats allow, so a
+	// pass binds each array once and every draw only picks a layer. Levels are copied on the GPU
+	// as they become resident, which follows a TextureStreamer's refinement: an array samples from
+	// the smallest level every layer holds. A layer drops its handle once it is complete, the
+	// TextureManager then keeps the source only until its budget evicts it. GL thread only.
+	class MaterialTextures {
+	public:
+		struct Material {
+			int32_t array = -1;     // -1 when the texture could not be loaded
+			float layer = 0.0f;
+		};
+
+		// one material per handle, in order; empty handles become materials without a texture
+		MaterialTextures(const std::vector<TextureHandle>& textures, uint32_t slot = 0);
+
+		MaterialTextures(const MaterialTextures&) = delete;
+		MaterialTextures& operator=(const MaterialTextures&) = delete;
+
+		// copies the levels that became resident since the last call; once per frame before drawing
+		void update();
+
+		uint32_t getMaterialCount() const { return static_cast<uint32_t>(mMaterials.size()); }
+		const Material& getMaterial(uint32_t index) const { return mMaterials[index]; }
+		// plain white layer for meshes without a material or whose texture failed to load
+		const Material& getDefaultMaterial() const { return mDefault; }
+		uint32_t getArrayCount() const { return static_cast<uint32_t>(mArrays.size()); }
+		TextureArray& getArray(uint32_t index) { return *mArrays[index]; }
+		// layers still waiting for levels
+		uint32_t getPendingCount() const { return mPending; }
+
+	private:
+		struct Layer {
+			TextureHandle texture;  // reset once every level is copied
+			uint32_t material;
+			uint32_t copiedBase;    // smallest level copied so far, the level count before the first copy
+		};
+
+		std::vector<Material> mMaterials;
+		Material mDefault;
+		std::vector<Scope<TextureArray>> mArrays;
+		std::vector<std::vector<Layer>> mLayers; // per array, in layer order
+		uint32_t mPending = 0;
+	};
+
+}
@@ -1,8 +1,10 @@
 #include "Mesh.h"
 
+#include "JobSystem.h"
+
 namespace Gizmo{
 	StaticMesh::StaticMesh(const std::vector<float>& vertecies, const std::vector<SubMesh>& subMeshes, const BufferLayout& layout)
-		: mVertices(vertecies), mSubMeshes(subMeshes), mVertCount(vertecies.size()/(layout.GetStride()/sizeof(float))) {
+		: mVertices(vertecies), mSubMeshes(subMeshes), mVertCount(vertecies.size()/(layout.GetStride()/sizeof(float))), mVertexStride(layout.GetStride()/sizeof(float)) {
 		mVao = CreateRef<VertexArray>();
 
 		mVbo = CreateRef<VertexBuffer>(mVertices.data(), mVertices.size() * sizeof(float));
@@ -16,9 +18,74 @@ namespace Gizmo{
 
 		mVao->AddVertexBuffer(mVbo);
 		mVao->SetIndexBuffer(mIbo[0]);
+
+		mCpuTracking = TrackedResource(ResourceCategory::MeshData, getCpuCopySize(), "mesh");
 	};
 
+	uint64_t StaticMesh::getCpuCopySize() const {
+		uint64_t bytes = mVertices.size() * sizeof(float);
+		for (const SubMesh& subMesh : mSubMeshes)
+			bytes += subMesh.mIndices.size();
+		return bytes;
+	}
+
+	void StaticMesh::releaseCpuCopy() {
+		std::vector<float>().swap(mVertices);
+		for (SubMesh& subMesh : mSubMeshes)
+			std::vector<uint8_t>().swap(subMesh.mIndices);
+		mCpuTracking.resize(0);
+	}
+
+	void StaticMesh::setName(const std::string& name) {
+		mVao->SetName(name);
+		mVbo->SetName(name + " vertices");
+		for (size_t i = 0; i < mIbo.size(); i++)
+			mIbo[i]->SetName(name + " indices " + std::to_string(i));
+		mCpuTracking.rename(name);
+	}
+
 	void StaticMesh::bindSubMesh(int index) { mVao->SetIndexBuffer(mIbo[index]); }
 
-	SubMesh StaticMesh::getSubMesh(int index) { return mSubMeshes[index]; };
+	const SubMesh& StaticMesh::getSubMesh(int index) const { return mSubMeshes[index]; };
+
+	void Skeleton::calculateGlobalTransformsByLevel(JobSystem& jobs) {
+		const SkeletonDefinition& definition = *mDefinition;
+		if (!definition.isParentOrdered()) {
+			calculateGlobalTransforms();
+			return;
+		}
+
+		// locals first, they have no dependencies at all
+		jobs.parallelFor(getNodeCount(), 256, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++)
+				composeTransform(mLocalPose.translations[i], mLocalPose.rotations[i], mLocalPose.scales[i], mGlobalTransforms[i]);
+		});
+
+		// level 0 holds the roots, which are already global
+		for (uint32_t depth = 1; depth < definition.getLevelCount(); depth++) {
+			const std::vector<uint32_t>& level = definition.getLevel(depth);
+			jobs.parallelFor(static_cast<uint32_t>(level.size()), 128, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					uint32_t node = level[i];
+					mGlobalTransforms[node] = mGlobalTransforms[definition.getNode(node).mParentIndex] * mGlobalTransforms[node];
+				}
+			});
+		}
+	}
+
+	SkeletonUpdate chooseSkeletonUpdate(const SkeletonDefinition& definition, uint32_t instanceCount, uint32_t threadCount) {
+		// below a few thousand node evaluations the fork and join costs more than it saves
+		const uint32_t minParallelNodes = 2048;
+		// levels narrower than this on average leave the threads mostly waiting on each other
+		const uint32_t minLevelWidth = 256;
+
+		uint32_t nodeCount = static_cast<uint32_t>(definition.getNodeCount());
+		if (threadCount <= 1 || static_cast<uint64_t>(nodeCount) * instanceCount < minParallelNodes)
+			return SkeletonUpdate::Serial;
+		if (instanceCount >= threadCount)
+			return SkeletonUpdate::PerInstance;
+		if (definition.getLevelCount() > 0 && nodeCount / definition.getLevelCount() >= minLevelWidth)
+			return SkeletonUpdate::PerLevel;
+		return instanceCount > 1 ? SkeletonUpdate::PerInstance : SkeletonUpdate::Serial;
+	}
 }
\ No newline at end of file
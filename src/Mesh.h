@@ -1,14 +1,21 @@
+#pragma once
+
 #include <string>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Base.h"
 #include "VertexArray.h"
 #include "Buffer.h"
+#include "DualQuat.h"
+#include "Pose.h"
+#include "ResourceRegistry.h"
 
 #include <vector>
 
 namespace Gizmo {
 
+	class JobSystem;
+
 	struct SubMesh {
 		SubMesh(const std::vector<uint32_t>& indices, uint32_t materialIndex) : mMaterialIndex(materialIndex), mCount(indices.size()), mIndexFormat(IndexType::UInt32) {
 			mIndices.resize(indices.size() * sizeof(uint32_t));
@@ -25,9 +32,16 @@ namespace Gizmo {
 		uint32_t mCount;
 		IndexType mIndexFormat; 
 
-		uint16_t* getIndexData16() { return reinterpret_cast<uint16_t*>(mIndices.data()); }
-		uint32_t* getIndexData32() { return reinterpret_cast<uint32_t*>(mIndices.data()); }
-		uint8_t*  getIndexData8() { return mIndices.data(); }
+		// the CPU indices are gone after StaticMesh::releaseCpuCopy, mCount still sizes the draws
+		bool hasCpuIndices() const { return mCount == 0 || !mIndices.empty(); }
+
+		uint16_t* getIndexData16() { assertm(hasCpuIndices(), "indices were released"); return reinterpret_cast<uint16_t*>(mIndices.data()); }
+		uint32_t* getIndexData32() { assertm(hasCpuIndices(), "indices were released"); return reinterpret_cast<uint32_t*>(mIndices.data()); }
+		uint8_t*  getIndexData8() { assertm(hasCpuIndices(), "indices were released"); return mIndices.data(); }
+		const uint16_t* getIndexData16() const { assertm(hasCpuIndices(), "indices were released"); return reinterpret_cast<const uint16_t*>(mIndices.data()); }
+		const uint32_t* getIndexData32() const { assertm(hasCpuIndices(), "indices were released"); return reinterpret_cast<const uint32_t*>(mIndices.data()); }
+
+		uint32_t getIndex(uint32_t i) const { return mIndexFormat == IndexType::UInt32 ? getIndexData32()[i] : getIndexData16()[i]; }
 
 		uint32_t getCount() const { return mCount; }
 	};
@@ -37,11 +51,27 @@ namespace Gizmo {
 		StaticMesh(const std::vector<float>& vertecies, const std::vector<SubMesh>& subMeshes, const BufferLayout& layout);
 
 		void bindSubMesh(int index);
-		uint32_t subMeshCount() { return mSubMeshes.size(); };
+		uint32_t subMeshCount() const { return mSubMeshes.size(); };
+
+		const SubMesh& getSubMesh(int index) const;
+		const Ref<VertexBuffer>& getVertexBuffer() const { return mVbo; }
+		const Ref<IndexBuffer>& getIndexBuffer(int index) const { return mIbo[index]; }
+
+		// CPU copy of the interleaved vertices, <getVertexStride()> floats per vertex, position first
+		const std::vector<float>& getVertices() const { return mVertices; }
+		uint32_t getVertexStride() const { return mVertexStride; }
+		uint32_t getVertexCount() const { return mVertCount; }
+
+		// frees the CPU copy of vertices and indices, for meshes nobody ray casts or skins on the CPU
+		void releaseCpuCopy();
+		bool hasCpuCopy() const { return !mVertices.empty(); }
 
-		SubMesh getSubMesh(int index);
+		// names the GL objects and the CPU copy in the resource registry
+		void setName(const std::string& name);
 
 	private:
+		uint64_t getCpuCopySize() const;
+
 		Ref<VertexArray> mVao;
 		Ref<VertexBuffer> mVbo;
 		std::vector<float> mVertices;
@@ -49,6 +79,8 @@ namespace Gizmo {
 		std::vector<Ref<IndexBuffer>> mIbo;
 		IndexType mIndexFormat;
 		uint32_t mVertCount;
+		uint32_t mVertexStride;
+		TrackedResource mCpuTracking;
 	};
 
 	struct Bone {
@@ -59,103 +91,205 @@ namespace Gizmo {
 	};
 
 	struct Node {
-		Node(std::string name, int32_t parentIndex, glm::mat4 localTransform) 
-			: mName(name), mParentIndex(parentIndex), mLocalTransform(localTransform), mGlobalTransform(glm::mat4(1.0f)) {}
+		Node(std::string name, int32_t parentIndex) 
+			: mName(name), mParentIndex(parentIndex) {}
 
 		std::string mName; 
 		int32_t mParentIndex; 
-		glm::mat4 mLocalTransform; 
-		glm::mat4 mGlobalTransform; //cache
+	};
+
+	// Immutable part of a skeleton: hierarchy, names, bind pose and inverse bind matrices. Built once
+	// at import, then shared by every Skeleton instance of that character.
+	class SkeletonDefinition {
+	public:
+		int addNode(const std::string& name, int32_t parentIndex, const glm::mat4& localTransform) {
+			uint32_t index = mNodes.size();
+			mNodeNameToIndex[name] = index;
+			mNodes.push_back(Node(name, parentIndex));
+			mBindPose.resize(mNodes.size());
+			mBindPose.setTransform(index, localTransform);
+			mParentOrdered = mParentOrdered && parentIndex < static_cast<int32_t>(index);
+			if (mParentOrdered) {
+				uint32_t depth = parentIndex < 0 ? 0 : mDepths[parentIndex] + 1;
+				mDepths.push_back(depth);
+				if (depth >= mLevels.size())
+					mLevels.resize(depth + 1);
+				mLevels[depth].push_back(index);
+			}
+			else {
+				mDepths.clear();
+				mLevels.clear();
+			}
+			return index;
+		}
+
+		int addBone(const std::string& name, uint32_t nodeIndex, const glm::mat4& invBindPose) {
+			auto it = mBoneNameToIndex.find(name);
+			if (it != mBoneNameToIndex.end())
+				return it->second;
+			mBoneNameToIndex[name] = mBones.size();
+			mBones.push_back(Bone(nodeIndex, invBindPose));
+			return mBones.size() - 1;
+		}
+
+		int findNodeIndex(const std::string& name) const {
+			auto it = mNodeNameToIndex.find(name);
+			return it == mNodeNameToIndex.end() ? -1 : static_cast<int>(it->second);
+		}
 
+		const Node& getNode(int index) const { return mNodes[index]; }
+		const Bone& getBone(uint32_t index) const { return mBones[index]; }
+		int getNodeCount() const { return mNodes.size(); }
+		int getBoneCount() const { return mBones.size(); }
+		const LocalPose& getBindPose() const { return mBindPose; }
 
+		// true when every parent is stored before its children (assimp's depth-first order),
+		// the global pass is then a single forward loop
+		bool isParentOrdered() const { return mParentOrdered; }
+
+		// nodes grouped by depth, parent ordered definitions only: the parents of level d + 1 are
+		// all in level d, so the nodes of one level can be evaluated in parallel
+		uint32_t getLevelCount() const { return static_cast<uint32_t>(mLevels.size()); }
+		const std::vector<uint32_t>& getLevel(uint32_t depth) const { return mLevels[depth]; }
+
+	private:
+		std::vector<Node> mNodes;
+		std::vector<Bone> mBones;
+		LocalPose mBindPose;
+		std::unordered_map<std::string, uint32_t> mNodeNameToIndex;
+		std::unordered_map<std::string, uint32_t> mBoneNameToIndex;
+		bool mParentOrdered = true;
+		std::vector<uint32_t> mDepths;
+		std::vector<std::vector<uint32_t>> mLevels;
 	};
 
+	// One posed instance of a SkeletonDefinition: only the local pose and the global transforms
+	// are per instance. A default constructed Skeleton owns a fresh definition that addNode and
+	// addBone build up; copies share it, so finish building before instancing.
 	class Skeleton {
 	public:
-		Skeleton() {
-			mNodes.clear(); 
-			mBones.clear(); 
+		Skeleton() : mDefinition(CreateRef<SkeletonDefinition>()) {}
+
+		explicit Skeleton(const Ref<SkeletonDefinition>& definition) : mDefinition(definition) {
+			resetToBindPose();
 		}
 
 		int addNode(const std::string& name, const uint32_t& parentIndex, const glm::mat4& localTransform) {
-			uint32_t index = mNodes.size();
-			mNodeNameToIndex[name] = index;
-			mNodes.push_back(Node(name, parentIndex, localTransform));  
+			int index = mDefinition->addNode(name, parentIndex, localTransform);
+			mLocalPose.resize(index + 1);
+			mLocalPose.setTransform(index, localTransform);
+			mGlobalTransforms.resize(index + 1, glm::mat4(1.0f));
 			return index; 
 		}
 
-		int addNode(const Node& node) { 
-			uint32_t index = mNodes.size();
-			mNodeNameToIndex[node.mName] = index;
-			mNodes.push_back(node); 
-			return index; 
+		int addBone(const std::string& name, uint32_t nodeIndex, glm::mat4 invBindPose) {
+			return mDefinition->addBone(name, nodeIndex, invBindPose);
 		}
 
-		int addBone(const std::string& name, uint32_t nodeIndex, glm::mat4 invBindPose) {
-			if (mBoneNameToIndex.count(name) == 0) {
-				mBoneNameToIndex[name] = mBones.size(); 
-				mBones.push_back(Bone(nodeIndex, invBindPose)); 
-			}
-			return mBoneNameToIndex[name];
+		const Ref<SkeletonDefinition>& getDefinition() const { return mDefinition; }
+
+		void resetToBindPose() {
+			mLocalPose = mDefinition->getBindPose();
+			mGlobalTransforms.assign(mDefinition->getNodeCount(), glm::mat4(1.0f));
 		}
 
-		void setNodeLocalTrans(uint32_t index, glm::mat4 localTrans) {
-			mNodes[index].mLocalTransform = localTrans; 
+		void setNodeLocalTrans(uint32_t index, glm::mat4 localTrans) { // decomposes, prefer writing the pose directly
+			mLocalPose.setTransform(index, localTrans); 
 		}
 
-		uint32_t getNodeIndex(std::string name) { return mNodeNameToIndex[name]; }
+		glm::mat4 getNodeLocalTrans(uint32_t index) const { return mLocalPose.getTransform(index); }
+
+		LocalPose& getLocalPose() { return mLocalPose; }
+		const LocalPose& getLocalPose() const { return mLocalPose; }
+
+		uint32_t getNodeIndex(std::string name) const { int index = mDefinition->findNodeIndex(name); return index < 0 ? 0 : index; }
 
-		Node getNode(int index) { return mNodes[index]; }
+		int findNodeIndex(const std::string& name) const { return mDefinition->findNodeIndex(name); }
+
+		const Node& getNode(int index) const { return mDefinition->getNode(index); }
 
 		void calculateGlobalTransforms() {
-			calculateRecursive(0, glm::mat4(1.0f));
+			if (!mDefinition->isParentOrdered()) {
+				calculateRecursive(0, glm::mat4(1.0f));
+				return;
+			}
+			for (int i = 0; i < getNodeCount(); i++) {
+				glm::mat4 local;
+				composeTransform(mLocalPose.translations[i], mLocalPose.rotations[i], mLocalPose.scales[i], local);
+				int32_t parent = mDefinition->getNode(i).mParentIndex;
+				mGlobalTransforms[i] = parent < 0 ? local : mGlobalTransforms[parent] * local;
+			}
 		}
 
+		// same result as calculateGlobalTransforms(), spread over <jobs>: every local matrix is
+		// composed in parallel, then each depth level is one parallelFor on top of the one above
+		void calculateGlobalTransformsByLevel(JobSystem& jobs);
+
 		const glm::mat4& getGlobalTransform(int index) const {
-			return mNodes[index].mGlobalTransform;
+			return mGlobalTransforms[index];
 		}
 
-		int getNodeCount() {
-			return mNodes.size(); 
+		int getNodeCount() const {
+			return mDefinition->getNodeCount(); 
 		}
 
-		int getBoneCount() {
-			return mBones.size(); 
+		int getBoneCount() const {
+			return mDefinition->getBoneCount(); 
 		}
 
-		Bone getBone(uint32_t index) {
-			return mBones[index]; 
+		const Bone& getBone(uint32_t index) const {
+			return mDefinition->getBone(index); 
 		}
 
-		std::vector<glm::mat4> calculateSkinningMatrices() const { // first call calculateGlobalTransforms(); 
-			std::vector<glm::mat4> skinningMatrices;
-			for (size_t i = 0; i < mBones.size(); ++i) {
-				uint32_t nodeIndex = mBones[i].mNodeIndex;
-				glm::mat4 globalTransform = getGlobalTransform(nodeIndex);
-				glm::mat4 skinMatrix = globalTransform * mBones[i].mInvBindPose;
-				skinningMatrices.push_back(skinMatrix);
+		// first call calculateGlobalTransforms(); writes getBoneCount() matrices to <out>
+		void calculateSkinningMatrices(glm::mat4* out) const {
+			for (int i = 0; i < getBoneCount(); ++i) {
+				const Bone& bone = getBone(i);
+				out[i] = getGlobalTransform(bone.mNodeIndex) * bone.mInvBindPose;
 			}
+		}
+
+		std::vector<glm::mat4> calculateSkinningMatrices() const { // first call calculateGlobalTransforms(); 
+			std::vector<glm::mat4> skinningMatrices(getBoneCount());
+			calculateSkinningMatrices(skinningMatrices.data());
 			return skinningMatrices;
 		}
 
-		std::unordered_map<std::string, uint32_t> mBoneNameToIndex;
+		std::vector<DualQuat> calculateSkinningDualQuats() const { // same palette as calculateSkinningMatrices(), 32 bytes per bone
+			std::vector<glm::mat4> skinningMatrices = calculateSkinningMatrices();
+			std::vector<DualQuat> dualQuats(skinningMatrices.size());
+			convertToDualQuats(skinningMatrices.data(), static_cast<uint32_t>(skinningMatrices.size()), dualQuats.data());
+			return dualQuats;
+		}
+
 	private:
-		std::vector<Node> mNodes;
-		std::vector<Bone> mBones; 
-		std::unordered_map<std::string, uint32_t> mNodeNameToIndex; 
-		
+		Ref<SkeletonDefinition> mDefinition;
+		LocalPose mLocalPose;
+		std::vector<glm::mat4> mGlobalTransforms;
 
 		void calculateRecursive(int nodeIndex, const glm::mat4& parentTransform) {
-			Node& node = mNodes[nodeIndex];
-			node.mGlobalTransform = parentTransform * node.mLocalTransform;
+			glm::mat4 local;
+			composeTransform(mLocalPose.translations[nodeIndex], mLocalPose.rotations[nodeIndex], mLocalPose.scales[nodeIndex], local);
+			mGlobalTransforms[nodeIndex] = parentTransform * local;
 
-			for (int i = 0; i < mNodes.size(); ++i) {
-				if (mNodes[i].mParentIndex == nodeIndex)
-					calculateRecursive(i, node.mGlobalTransform);
+			for (int i = 0; i < getNodeCount(); ++i) {
+				if (mDefinition->getNode(i).mParentIndex == nodeIndex)
+					calculateRecursive(i, mGlobalTransforms[nodeIndex]);
 			}
 		}
 	};
 
+	// How a batch of skeletons sharing one definition gets its global transforms
+	enum class SkeletonUpdate {
+		Auto,        // chooseSkeletonUpdate() decides
+		Serial,      // one thread, one instance after the other
+		PerInstance, // whole instances are the jobs, best whenever there are enough of them
+		PerLevel     // one instance at a time, its depth levels split across threads
+	};
+
+	// picks a strategy from the node and instance counts, see the "skeleton-update" benchmark for the crossovers
+	SkeletonUpdate chooseSkeletonUpdate(const SkeletonDefinition& definition, uint32_t instanceCount, uint32_t threadCount);
+
 	class SkinnedMesh : public StaticMesh {
 	public: 
 		SkinnedMesh(const std::vector<float>& vertecies,
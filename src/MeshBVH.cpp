@@ -0,0 +1,429 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cassert>
+#include <iostream>
+
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	namespace {
+		const uint32_t kBins = 12;
+		const uint32_t kMaxLeafTriangles = 4;
+
+		struct Bounds {
+			glm::vec3 min = glm::vec3(1e30f);
+			glm::vec3 max = glm::vec3(-1e30f);
+
+			void grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+			void grow(const Bounds& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+			float area() const {
+				glm::vec3 e = max - min;
+				return (e.x < 0.0f) ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+			}
+		};
+
+		// slab test, returns the entry distance or 1e30 on a miss
+		inline float intersectBox(const glm::vec3& bmin, const glm::vec3& bmax, const glm::vec3& origin, const glm::vec3& invDir, float maxT) {
+			float tx1 = (bmin.x - origin.x) * invDir.x, tx2 = (bmax.x - origin.x) * invDir.x;
+			float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
+			float ty1 = (bmin.y - origin.y) * invDir.y, ty2 = (bmax.y - origin.y) * invDir.y;
+			tmin = std::max(tmin, std::min(ty1, ty2)); tmax = std::min(tmax, std::max(ty1, ty2));
+			float tz1 = (bmin.z - origin.z) * invDir.z, tz2 = (bmax.z - origin.z) * invDir.z;
+			tmin = std::max(tmin, std::min(tz1, tz2)); tmax = std::min(tmax, std::max(tz1, tz2));
+			return (tmax >= tmin && tmin < maxT && tmax > 0.0f) ? tmin : 1e30f;
+		}
+	}
+
+	void MeshBVH::build(const StaticMesh& mesh) {
+		if (!mesh.hasCpuCopy()) {
+			std::cerr << "MeshBVH: the mesh released its CPU copy, nothing to build from" << std::endl;
+			mNodes.clear();
+			mTriangles.clear();
+			mPositions.clear();
+			return;
+		}
+		const std::vector<float>& vertices = mesh.getVertices();
+		const uint32_t stride = mesh.getVertexStride();
+
+		mPositions.resize(mesh.getVertexCount());
+		for (uint32_t i = 0; i < mesh.getVertexCount(); i++)
+			mPositions[i] = glm::vec3(vertices[i * stride + 0], vertices[i * stride + 1], vertices[i * stride + 2]);
+
+		mTriangles.clear();
+		for (uint32_t s = 0; s < mesh.subMeshCount(); s++) {
+			const SubMesh& subMesh = mesh.getSubMesh(s);
+			for (uint32_t i = 0; i + 2 < subMesh.getCount(); i += 3)
+				mTriangles.push_back({ { subMesh.getIndex(i), subMesh.getIndex(i + 1), subMesh.getIndex(i + 2) }, s, static_cast<uint32_t>(mTriangles.size()) });
+		}
+
+		buildTree();
+	}
+
+	void MeshBVH::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+		mPositions = positions;
+		mTriangles.clear();
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			mTriangles.push_back({ { indices[i], indices[i + 1], indices[i + 2] }, 0, static_cast<uint32_t>(mTriangles.size()) });
+
+		buildTree();
+	}
+
+	void MeshBVH::buildTree() {
+		mNodes.clear();
+		mDepth = 0;
+		if (mTriangles.empty())
+			return;
+
+		mNodes.reserve(mTriangles.size() * 2);
+
+		std::vector<glm::vec3> centroids(mTriangles.size());
+		for (size_t i = 0; i < mTriangles.size(); i++) {
+			const Triangle& tri = mTriangles[i];
+			centroids[i] = (mPositions[tri.v[0]] + mPositions[tri.v[1]] + mPositions[tri.v[2]]) * (1.0f / 3.0f);
+		}
+
+		Node root;
+		root.leftFirst = 0;
+		root.count = static_cast<uint32_t>(mTriangles.size());
+		mNodes.push_back(root);
+		updateBounds(0);
+		subdivide(0, 0, centroids);
+	}
+
+	void MeshBVH::updateBounds(uint32_t nodeIndex) {
+		Node& node = mNodes[nodeIndex];
+		Bounds bounds;
+		for (uint32_t i = 0; i < node.count; i++) {
+			const Triangle& tri = mTriangles[node.leftFirst + i];
+			bounds.grow(mPositions[tri.v[0]]);
+			bounds.grow(mPositions[tri.v[1]]);
+			bounds.grow(mPositions[tri.v[2]]);
+		}
+		node.boundsMin = bounds.min;
+		node.boundsMax = bounds.max;
+	}
+
+	void MeshBVH::subdivide(uint32_t nodeIndex, uint32_t depth, std::vector<glm::vec3>& centroids) {
+		Node node = mNodes[nodeIndex];
+		if (node.count <= kMaxLeafTriangles)
+			return;
+
+		// binned SAH over the centroid bounds
+		Bounds centroidBounds;
+		for (uint32_t i = 0; i < node.count; i++)
+			centroidBounds.grow(centroids[node.leftFirst + i]);
+
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		float bestCost = 1e30f;
+		for (int axis = 0; axis < 3; axis++) {
+			float lo = centroidBounds.min[axis], hi = centroidBounds.max[axis];
+			if (hi - lo <= 1e-12f)
+				continue;
+
+			Bounds bins[kBins];
+			uint32_t counts[kBins] = {};
+			float scale = kBins / (hi - lo);
+			for (uint32_t i = 0; i < node.count; i++) {
+				const Triangle& tri = mTriangles[node.leftFirst + i];
+				uint32_t bin = std::min(kBins - 1, static_cast<uint32_t>((centroids[node.leftFirst + i][axis] - lo) * scale));
+				counts[bin]++;
+				bins[bin].grow(mPositions[tri.v[0]]);
+				bins[bin].grow(mPositions[tri.v[1]]);
+				bins[bin].grow(mPositions[tri.v[2]]);
+			}
+
+			float leftArea[kBins - 1], rightArea[kBins - 1];
+			uint32_t leftCount[kBins - 1], rightCount[kBins - 1];
+			Bounds leftBox, rightBox;
+			uint32_t leftSum = 0, rightSum = 0;
+			for (uint32_t i = 0; i < kBins - 1; i++) {
+				leftSum += counts[i];
+				leftCount[i] = leftSum;
+				leftBox.grow(bins[i]);
+				leftArea[i] = leftBox.area();
+
+				rightSum += counts[kBins - 1 - i];
+				rightCount[kBins - 2 - i] = rightSum;
+				rightBox.grow(bins[kBins - 1 - i]);
+				rightArea[kBins - 2 - i] = rightBox.area();
+			}
+
+			for (uint32_t i = 0; i < kBins - 1; i++) {
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i + 1;
+				}
+			}
+		}
+
+		Bounds nodeBounds;
+		nodeBounds.min = node.boundsMin;
+		nodeBounds.max = node.boundsMax;
+		if (bestAxis < 0 || bestCost >= node.count * nodeBounds.area())
+			return; // splitting does not pay off
+
+		// partition triangles (and their centroids) around the chosen bin boundary
+		float lo = centroidBounds.min[bestAxis];
+		float scale = kBins / (centroidBounds.max[bestAxis] - lo);
+		uint32_t i = node.leftFirst;
+		uint32_t j = node.leftFirst + node.count - 1;
+		while (i <= j) {
+			uint32_t bin = std::min(kBins - 1, static_cast<uint32_t>((centroids[i][bestAxis] - lo) * scale));
+			if (bin < bestSplit) {
+				i++;
+			}
+			else {
+				std::swap(mTriangles[i], mTriangles[j]);
+				std::swap(centroids[i], centroids[j]);
+				if (j == 0) break;
+				j--;
+			}
+		}
+
+		uint32_t leftCount = i - node.leftFirst;
+		if (leftCount == 0 || leftCount == node.count)
+			return;
+
+		uint32_t leftIndex = static_cast<uint32_t>(mNodes.size());
+		Node left, right;
+		left.leftFirst = node.leftFirst;
+		left.count = leftCount;
+		right.leftFirst = i;
+		right.count = node.count - leftCount;
+		mNodes.push_back(left);
+		mNodes.push_back(right);
+
+		mNodes[nodeIndex].leftFirst = leftIndex;
+		mNodes[nodeIndex].count = 0;
+		mDepth = std::max(mDepth, depth + 1);
+
+		updateBounds(leftIndex);
+		updateBounds(leftIndex + 1);
+		subdivide(leftIndex, depth + 1, centroids);
+		subdivide(leftIndex + 1, depth + 1, centroids);
+	}
+
+	bool MeshBVH::refit(const std::vector<glm::vec3>& positions) {
+		if (positions.size() != mPositions.size()) {
+			std::cerr << "BVH refit with " << positions.size() << " vertices, built with " << mPositions.size() << std::endl;
+			return false;
+		}
+		mPositions = positions;
+		refitNodes();
+		return true;
+	}
+
+	bool MeshBVH::refit(const float* positions, uint32_t vertexCount, uint32_t strideInFloats) {
+		if (vertexCount != mPositions.size()) {
+			std::cerr << "BVH refit with " << vertexCount << " vertices, built with " << mPositions.size() << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < mPositions.size(); i++)
+			mPositions[i] = glm::vec3(positions[i * strideInFloats + 0], positions[i * strideInFloats + 1], positions[i * strideInFloats + 2]);
+		refitNodes();
+		return true;
+	}
+
+	void MeshBVH::refitNodes() {
+		// children are always stored after their parent, so a reverse sweep is bottom-up
+		for (size_t n = mNodes.size(); n-- > 0;) {
+			Node& node = mNodes[n];
+			if (node.count > 0) {
+				updateBounds(static_cast<uint32_t>(n));
+				continue;
+			}
+			const Node& left = mNodes[node.leftFirst];
+			const Node& right = mNodes[node.leftFirst + 1];
+			node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		}
+	}
+
+	bool MeshBVH::intersect(const Ray& ray, RayHit& hit, float maxDistance) const {
+		if (mNodes.empty())
+			return false;
+
+		const glm::vec3 invDir = glm::vec3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+		float closest = maxDistance;
+		bool found = false;
+
+		// one far child per inner level at most, so the depth measured at build time always fits
+		uint32_t inlineStack[64];
+		std::vector<uint32_t> heapStack;
+		uint32_t* stack = inlineStack;
+		if (mDepth > 64) {
+			heapStack.resize(mDepth);
+			stack = heapStack.data();
+		}
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+
+		if (intersectBox(mNodes[0].boundsMin, mNodes[0].boundsMax, ray.origin, invDir, closest) == 1e30f)
+			return false;
+
+		for (;;) {
+			const Node& node = mNodes[nodeIndex];
+			if (node.count > 0) {
+				for (uint32_t i = 0; i < node.count; i++) {
+					// Moller-Trumbore
+					const Triangle& tri = mTriangles[node.leftFirst + i];
+					const glm::vec3& p0 = mPositions[tri.v[0]];
+					glm::vec3 e1 = mPositions[tri.v[1]] - p0;
+					glm::vec3 e2 = mPositions[tri.v[2]] - p0;
+					glm::vec3 h = glm::cross(ray.direction, e2);
+					float a = glm::dot(e1, h);
+					if (std::fabs(a) < 1e-12f)
+						continue;
+					float f = 1.0f / a;
+					glm::vec3 s = ray.origin - p0;
+					float u = f * glm::dot(s, h);
+					if (u < 0.0f || u > 1.0f)
+						continue;
+					glm::vec3 q = glm::cross(s, e1);
+					float v = f * glm::dot(ray.direction, q);
+					if (v < 0.0f || u + v > 1.0f)
+						continue;
+					float t = f * glm::dot(e2, q);
+					if (t > 1e-6f && t < closest) {
+						closest = t;
+						hit.t = t;
+						hit.triangle = tri.source;
+						hit.vertices[0] = tri.v[0];
+						hit.vertices[1] = tri.v[1];
+						hit.vertices[2] = tri.v[2];
+						hit.subMesh = tri.subMesh;
+						hit.u = u;
+						hit.v = v;
+						found = true;
+					}
+				}
+			}
+			else {
+				// visit the nearer child first, push the other one
+				uint32_t near = node.leftFirst, far = node.leftFirst + 1;
+				float dNear = intersectBox(mNodes[near].boundsMin, mNodes[near].boundsMax, ray.origin, invDir, closest);
+				float dFar = intersectBox(mNodes[far].boundsMin, mNodes[far].boundsMax, ray.origin, invDir, closest);
+				if (dNear > dFar) {
+					std::swap(near, far);
+					std::swap(dNear, dFar);
+				}
+				if (dNear != 1e30f) {
+					if (dFar != 1e30f) {
+						assert(stackSize < std::max(mDepth, 1u));
+						stack[stackSize++] = far;
+					}
+					nodeIndex = near;
+					continue;
+				}
+			}
+
+			// pop, skipping nodes that are now behind the closest hit
+			bool next = false;
+			while (stackSize > 0) {
+				uint32_t candidate = stack[--stackSize];
+				if (intersectBox(mNodes[candidate].boundsMin, mNodes[candidate].boundsMax, ray.origin, invDir, closest) != 1e30f) {
+					nodeIndex = candidate;
+					next = true;
+					break;
+				}
+			}
+			if (!next)
+				break;
+		}
+
+		return found;
+	}
+
+	bool intersectBounds(const Ray& ray, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance) {
+		if (boundsMin.x > boundsMax.x || boundsMin.y > boundsMax.y || boundsMin.z > boundsMax.z)
+			return false; // empty
+		const glm::vec3 invDir = glm::vec3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+		return intersectBox(boundsMin, boundsMax, ray.origin, invDir, maxDistance) != 1e30f;
+	}
+
+	namespace {
+		// ~100k triangle closed surface, roughly character sized (1.8 units tall)
+		void makeBenchmarkMesh(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, uint32_t rings, uint32_t segments) {
+			const float PI = 3.14159265f;
+			positions.clear();
+			indices.clear();
+			for (uint32_t r = 0; r <= rings; r++) {
+				float phi = PI * r / rings;
+				for (uint32_t s = 0; s <= segments; s++) {
+					float theta = 2.0f * PI * s / segments;
+					float bulge = 1.0f + 0.15f * std::sin(theta * 5.0f) * std::sin(phi * 7.0f);
+					positions.push_back(glm::vec3(0.4f * bulge * std::sin(phi) * std::cos(theta), 0.9f * std::cos(phi) + 0.9f, 0.25f * bulge * std::sin(phi) * std::sin(theta)));
+				}
+			}
+			for (uint32_t r = 0; r < rings; r++) {
+				for (uint32_t s = 0; s < segments; s++) {
+					uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+					indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+				}
+			}
+		}
+
+		void benchmarkMeshBVH(std::vector<BenchmarkResult>& results) {
+			std::vector<glm::vec3> positions;
+			std::vector<uint32_t> indices;
+			makeBenchmarkMesh(positions, indices, 250, 200);
+
+			MeshBVH bvh;
+			BenchmarkResult build = runBenchmark("bvh build", 3, [&](uint32_t) { bvh.build(positions, indices); });
+			build.itemsPerIteration = bvh.getTriangleCount();
+			build.itemName = "tri";
+			results.push_back(build);
+
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+			const uint32_t rayCount = 10000;
+			std::vector<Ray> rays(rayCount);
+			for (Ray& ray : rays) {
+				glm::vec3 target(jitter(rng) * 0.8f, 0.9f + jitter(rng) * 1.8f, jitter(rng) * 0.5f);
+				ray.origin = glm::vec3(jitter(rng) * 2.0f, 1.0f + jitter(rng), 3.0f);
+				ray.direction = glm::normalize(target - ray.origin);
+			}
+
+			uint32_t hits = 0;
+			BenchmarkResult query = runBenchmark("bvh ray query (100k tris)", rayCount, [&](uint32_t i) {
+				RayHit hit;
+				hits += bvh.intersect(rays[i], hit) ? 1 : 0;
+			});
+			query.itemsPerIteration = 1.0;
+			query.itemName = "ray";
+			results.push_back(query);
+
+			// a pose change: sway the upper half and refit instead of rebuilding
+			std::vector<glm::vec3> posed = positions;
+			BenchmarkResult refit = runBenchmark("bvh refit (100k tris)", 20, [&](uint32_t i) {
+				float sway = 0.05f * std::sin(float(i));
+				for (size_t v = 0; v < posed.size(); v++)
+					posed[v].x = positions[v].x + sway * positions[v].y;
+				bvh.refit(posed);
+			});
+			refit.itemsPerIteration = bvh.getTriangleCount();
+			refit.itemName = "tri";
+			results.push_back(refit);
+
+			BenchmarkResult refitQuery = runBenchmark("bvh ray query after refit", rayCount, [&](uint32_t i) {
+				RayHit hit;
+				hits += bvh.intersect(rays[i], hit) ? 1 : 0;
+			});
+			refitQuery.itemsPerIteration = 1.0;
+			refitQuery.itemName = "ray";
+			results.push_back(refitQuery);
+
+			printf("[bench] bvh: %u nodes, %u/%u rays hit\n", bvh.getNodeCount(), hits, rayCount * 2);
+		}
+
+		bool sRegistered = registerBenchmark("bvh", &benchmarkMeshBVH);
+	}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+namespace Gizmo {
+
+	struct Ray {
+		glm::vec3 origin;
+		glm::vec3 direction;
+	};
+
+	struct RayHit {
+		float t = 0.0f;
+		uint32_t triangle = 0;   // index into the triangle list of the mesh, in submesh order
+		uint32_t vertices[3] = {}; // its corners, vertex indices of the mesh
+		uint32_t subMesh = 0;
+		float u = 0.0f, v = 0.0f; // barycentrics of corners 1 and 2
+	};
+
+	// Bounding volume hierarchy over the triangles of a StaticMesh (all submeshes). The topology
+	// is fixed at build time, posed vertex positions are pushed with refit(), which only updates
+	// the boxes bottom-up instead of rebuilding the tree.
+	class MeshBVH {
+	public:
+		void build(const StaticMesh& mesh);
+		void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+		// <positions> must have the vertex count the tree was built with, anything else is reported
+		// and ignored; false then
+		bool refit(const std::vector<glm::vec3>& positions);
+		bool refit(const float* positions, uint32_t vertexCount, uint32_t strideInFloats);
+
+		bool intersect(const Ray& ray, RayHit& hit, float maxDistance = 1e30f) const;
+
+		uint32_t getTriangleCount() const { return static_cast<uint32_t>(mTriangles.size()); }
+		uint32_t getNodeCount() const { return static_cast<uint32_t>(mNodes.size()); }
+		// inner nodes on the longest root to leaf path, what intersect() may have to push
+		uint32_t getDepth() const { return mDepth; }
+		const glm::vec3& getPosition(uint32_t vertex) const { return mPositions[vertex]; }
+
+	private:
+		struct Node {
+			glm::vec3 boundsMin;
+			uint32_t leftFirst; // first child (children are adjacent) or first triangle of a leaf
+			glm::vec3 boundsMax;
+			uint32_t count;     // triangles in the leaf, 0 for inner nodes
+		};
+
+		struct Triangle {
+			uint32_t v[3];
+			uint32_t subMesh;
+			uint32_t source; // position in the submesh ordered list, before the build reordered it
+		};
+
+		void buildTree();
+		void updateBounds(uint32_t nodeIndex);
+		void subdivide(uint32_t nodeIndex, uint32_t depth, std::vector<glm::vec3>& centroids);
+		void refitNodes();
+
+		std::vector<Node> mNodes;
+		std::vector<Triangle> mTriangles;     // reordered so every leaf owns a contiguous range
+		std::vector<glm::vec3> mPositions;
+		uint32_t mDepth = 0;
+	};
+
+	// slab test against a box in the space of <ray>
+	bool intersectBounds(const Ray& ray, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance = 1e30f);
+
+}
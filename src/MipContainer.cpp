@@ -0,0 +1,243 @@
+#include "MipContainer.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+
+#include <stb_image.h>
+
+#include "Texture2D.h"
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	bool MipContainer::isMipContainer(const uint8_t* data, size_t size) {
+		uint32_t magic = 0;
+		if (size < sizeof(MipContainerHeader))
+			return false;
+		std::memcpy(&magic, data, sizeof(magic));
+		return magic == MipContainerHeader::kMagic;
+	}
+
+	bool MipContainer::open(const std::string& path) {
+		if (!mFile.open(path))
+			return false;
+		if (!parse(mFile.data(), mFile.size())) {
+			mFile.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool MipContainer::parse(const uint8_t* data, size_t size) {
+		mLevels.clear();
+		if (!isMipContainer(data, size))
+			return false;
+
+		std::memcpy(&mHeader, data, sizeof(mHeader));
+		if (mHeader.version != MipContainerHeader::kVersion || (mHeader.channels != 3 && mHeader.channels != 4) ||
+			mHeader.width == 0 || mHeader.height == 0 ||
+			mHeader.levelCount == 0 || mHeader.levelCount > getMipLevelCount(mHeader.width, mHeader.height) ||
+			sizeof(MipContainerHeader) + mHeader.levelCount * sizeof(MipLevelEntry) > size) {
+			std::cerr << "Rejected mip container: bad header (" << mHeader.width << "x" << mHeader.height << ", " << mHeader.levelCount << " levels)" << std::endl;
+			return false;
+		}
+
+		const uint8_t* entries = data + sizeof(MipContainerHeader);
+		for (uint32_t i = 0; i < mHeader.levelCount; i++) {
+			MipLevelEntry entry;
+			std::memcpy(&entry, entries + i * sizeof(MipLevelEntry), sizeof(entry));
+			// level i has to be what glTexStorage2D allocates for it, anything else leaves the texture incomplete
+			if (entry.width != std::max(1u, mHeader.width >> i) || entry.height != std::max(1u, mHeader.height >> i) ||
+				entry.size != static_cast<uint64_t>(entry.width) * entry.height * mHeader.channels ||
+				entry.offset > size || entry.size > size - entry.offset) {
+				std::cerr << "Rejected mip container: level " << i << " is " << entry.width << "x" << entry.height << ", " << entry.size << " bytes" << std::endl;
+				mLevels.clear();
+				return false;
+			}
+			mLevels.push_back({ entry.width, entry.height, data + entry.offset, static_cast<size_t>(entry.size) });
+		}
+		return true;
+	}
+
+	namespace {
+		float srgbToLinear(float value) {
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linearToSrgb(float value) {
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		// <level> is in linear space when <srgb>, alpha always is
+		void quantize(const std::vector<float>& level, uint32_t channels, bool srgb, std::vector<uint8_t>& out) {
+			out.resize(level.size());
+			for (size_t i = 0; i < level.size(); i++) {
+				float value = level[i];
+				if (srgb && i % channels < 3)
+					value = linearToSrgb(value);
+				out[i] = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+
+		// 2x2 box filter, the last row/column of odd sizes is repeated
+		void downsample(const std::vector<float>& source, uint32_t width, uint32_t height, uint32_t channels, std::vector<float>& out) {
+			uint32_t outWidth = std::max(1u, width / 2), outHeight = std::max(1u, height / 2);
+			out.assign(static_cast<size_t>(outWidth) * outHeight * channels, 0.0f);
+			for (uint32_t y = 0; y < outHeight; y++) {
+				uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+				for (uint32_t x = 0; x < outWidth; x++) {
+					uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+					for (uint32_t c = 0; c < channels; c++) {
+						float sum = source[(static_cast<size_t>(y0) * width + x0) * channels + c] + source[(static_cast<size_t>(y0) * width + x1) * channels + c] +
+							source[(static_cast<size_t>(y1) * width + x0) * channels + c] + source[(static_cast<size_t>(y1) * width + x1) * channels + c];
+						out[(static_cast<size_t>(y) * outWidth + x) * channels + c] = sum * 0.25f;
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t getMipLevelCount(uint32_t width, uint32_t height) {
+		uint32_t levels = 1;
+		while (width > 1 || height > 1) {
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			levels++;
+		}
+		return levels;
+	}
+
+	bool decodeMipSource(const std::string& path, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height, uint32_t& channels) {
+		int sourceWidth, sourceHeight, sourceChannels;
+		if (!stbi_info(path.c_str(), &sourceWidth, &sourceHeight, &sourceChannels)) {
+			std::cerr << "Failed to read " << path << ": " << stbi_failure_reason() << std::endl;
+			return false;
+		}
+		// grey becomes RGB, grey + alpha RGBA, Texture2D only knows those two
+		channels = (sourceChannels == 2 || sourceChannels == 4) ? 4 : 3;
+
+		// flipped like Texture2D::decode(), so both paths upload the same rows
+		stbi_set_flip_vertically_on_load_thread(true);
+		unsigned char* data = stbi_load(path.c_str(), &sourceWidth, &sourceHeight, &sourceChannels, channels);
+		if (!data) {
+			std::cerr << "Failed to decode " << path << ": " << stbi_failure_reason() << std::endl;
+			return false;
+		}
+		width = sourceWidth;
+		height = sourceHeight;
+		pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+		stbi_image_free(data);
+		return true;
+	}
+
+	void buildMipChain(std::vector<uint8_t>&& pixels, uint32_t width, uint32_t height, uint32_t channels, bool srgb, std::vector<std::vector<uint8_t>>& levels) {
+		float toLinear[256];
+		for (int i = 0; i < 256; i++)
+			toLinear[i] = srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+
+		std::vector<float> level(pixels.size()), next;
+		for (size_t i = 0; i < level.size(); i++)
+			level[i] = (i % channels < 3) ? toLinear[pixels[i]] : pixels[i] / 255.0f;
+
+		// level 0 is kept as decoded, re-quantizing it could shift sRGB values by one
+		levels.clear();
+		levels.push_back(std::move(pixels));
+		while (width > 1 || height > 1) {
+			downsample(level, width, height, channels, next);
+			level.swap(next);
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			levels.emplace_back();
+			quantize(level, channels, srgb, levels.back());
+		}
+	}
+
+	bool bakeMipContainer(const std::string& sourcePath, const std::string& outputPath, bool srgb) {
+		std::vector<uint8_t> pixels;
+		uint32_t width, height, channels;
+		if (!decodeMipSource(sourcePath, pixels, width, height, channels))
+			return false;
+
+		MipContainerHeader header;
+		header.width = width;
+		header.height = height;
+		header.channels = channels;
+		header.flags = srgb ? MipContainerHeader::kSRGB : 0;
+
+		std::vector<std::vector<uint8_t>> levels;
+		buildMipChain(std::move(pixels), width, height, channels, srgb, levels);
+		header.levelCount = static_cast<uint32_t>(levels.size());
+
+		std::vector<MipLevelEntry> entries(levels.size());
+		for (size_t i = 0; i < levels.size(); i++) {
+			entries[i].width = std::max(1u, width >> i);
+			entries[i].height = std::max(1u, height >> i);
+			entries[i].size = levels[i].size();
+		}
+
+		uint64_t offset = sizeof(MipContainerHeader) + entries.size() * sizeof(MipLevelEntry);
+		for (MipLevelEntry& entry : entries) {
+			offset = (offset + 15) & ~15ull;
+			entry.offset = offset;
+			offset += entry.size;
+		}
+
+		std::ofstream file(outputPath, std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open " << outputPath << " for writing" << std::endl;
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MipLevelEntry));
+		uint64_t written = sizeof(MipContainerHeader) + entries.size() * sizeof(MipLevelEntry);
+		const char padding[16] = {};
+		for (size_t i = 0; i < entries.size(); i++) {
+			file.write(padding, entries[i].offset - written);
+			file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+			written = entries[i].offset + entries[i].size;
+		}
+		return static_cast<bool>(file);
+	}
+
+	namespace {
+		void benchmarkMipContainer(std::vector<BenchmarkResult>& results) {
+			const char* sources[] = { "assets/textures/wall.jpg", "assets/textures/diffuse_body.png",
+				"assets/textures/diffuse_hands.png", "assets/textures/diffuse_helmets.png" };
+			const char* bakedPath = "mip-container-bench.gmip";
+			const uint32_t iterations = 5;
+
+			for (const char* source : sources) {
+				if (!bakeMipContainer(source, bakedPath))
+					continue;
+
+				// glFinish so the stb path pays for its glGenerateMipmap as well
+				BenchmarkResult decoded = runBenchmark(std::string("stb decode + mip generation, ") + source, iterations, [&](uint32_t) {
+					Texture2D texture(source);
+					glFinish();
+				});
+				BenchmarkResult mapped = runBenchmark(std::string("mapped container, ") + source, iterations, [&](uint32_t) {
+					Texture2D texture(bakedPath);
+					glFinish();
+				});
+				decoded.itemsPerIteration = mapped.itemsPerIteration = 1;
+				decoded.itemName = mapped.itemName = "texture";
+				results.push_back(decoded);
+				results.push_back(mapped);
+
+				MappedFile sourceFile, bakedFile;
+				sourceFile.open(source);
+				bakedFile.open(bakedPath);
+				printf("[bench] mip-container: %s %.2f ms -> %.2f ms (%.1fx), file %zu KB -> %zu KB\n", source, decoded.meanMs(), mapped.meanMs(),
+					decoded.meanMs() / std::max(mapped.meanMs(), 1e-6), sourceFile.size() / 1024, bakedFile.size() / 1024);
+			}
+			std::remove(bakedPath);
+		}
+
+		bool sRegistered = registerBenchmark("mip-container", &benchmarkMipContainer);
+	}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "MappedFile.h"
+
+namespace Gizmo {
+
+	// Texture with its whole mip chain pre-filtered offline, laid out so that loading is a map and
+	// one glTexImage2D per level: no decode and no glGenerateMipmap. Levels are RGB8 or RGBA8,
+	// tightly packed, bottom row first like Texture2D::decode(), largest level first.
+	//
+	//   MipContainerHeader | MipLevelEntry[levelCount] | level data, each 16-byte aligned
+	struct MipContainerHeader {
+		static const uint32_t kMagic = 0x50494D47; // "GMIP"
+		static const uint32_t kVersion = 1;
+		static const uint32_t kSRGB = 1;
+
+		uint32_t magic = kMagic;
+		uint32_t version = kVersion;
+		uint32_t width = 0, height = 0;
+		uint32_t channels = 0;   // 3 or 4
+		uint32_t levelCount = 0;
+		uint32_t flags = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct MipLevelEntry {
+		uint64_t offset = 0; // from the start of the file
+		uint64_t size = 0;
+		uint32_t width = 0, height = 0;
+	};
+
+	class MipContainer {
+	public:
+		struct Level {
+			uint32_t width, height;
+			const uint8_t* pixels;
+			size_t size;
+		};
+
+		// maps <path> and validates it, the levels point into the mapping
+		bool open(const std::string& path);
+		// validates a container somebody else keeps in memory, nothing is copied
+		bool parse(const uint8_t* data, size_t size);
+
+		static bool isMipContainer(const uint8_t* data, size_t size);
+
+		uint32_t getWidth() const { return mHeader.width; }
+		uint32_t getHeight() const { return mHeader.height; }
+		uint32_t getChannels() const { return mHeader.channels; }
+		bool isSRGB() const { return (mHeader.flags & MipContainerHeader::kSRGB) != 0; }
+		uint32_t getLevelCount() const { return static_cast<uint32_t>(mLevels.size()); }
+		const Level& getLevel(uint32_t level) const { return mLevels[level]; }
+
+	private:
+		MappedFile mFile;
+		MipContainerHeader mHeader;
+		std::vector<Level> mLevels;
+	};
+
+	// floor(log2(max(width, height))) + 1
+	uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+	// decodes <path> to RGB8 or RGBA8 (grey is expanded), bottom row first like Texture2D::decode()
+	bool decodeMipSource(const std::string& path, std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height, uint32_t& channels);
+
+	// <pixels> becomes level 0, the smaller levels are box filtered in float, in linear space with <srgb>
+	void buildMipChain(std::vector<uint8_t>&& pixels, uint32_t width, uint32_t height, uint32_t channels, bool srgb, std::vector<std::vector<uint8_t>>& levels);
+
+	// Offline converter: decodes <sourcePath> (anything stb_image reads), filters the mip chain on
+	// the CPU and writes the container. With <srgb> the texels are averaged in linear space and
+	// the texture is uploaded as sRGB.
+	bool bakeMipContainer(const std::string& sourcePath, const std::string& outputPath, bool srgb = false);
+
+}
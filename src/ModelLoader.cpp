@@ -0,0 +1,479 @@
+#include "ModelLoader.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <assimp/Importer.hpp>
+#include <assimp/ProgressHandler.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+
+namespace Gizmo {
+
+	namespace {
+		// share of the progress bar each stage fills, the upload takes the rest
+		const float kImportShare = 0.7f;
+		const float kAssemblyShare = 0.2f;
+
+		const int kStride = 16;
+		const int kBoneIDOffset = 8, kWeightOffset = 12;
+
+		// Assimp calls this between its steps, returning false makes ReadFile give up
+		class ImportProgress : public Assimp::ProgressHandler {
+		public:
+			ImportProgress(std::atomic<float>& progress, const std::atomic<bool>& cancelled) : mProgress(progress), mCancelled(cancelled) {}
+
+			bool Update(float percentage) override {
+				if (percentage >= 0.0f)
+					mProgress = std::min(percentage, 1.0f) * kImportShare;
+				return !mCancelled;
+			}
+
+		private:
+			std::atomic<float>& mProgress;
+			const std::atomic<bool>& mCancelled;
+		};
+
+		glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from) {
+			glm::mat4 to(1.0f);
+
+			to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+			to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+			to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+			to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+
+			return to;
+		}
+
+		void buildNodeHierarchy(Skeleton& skeleton, int32_t parent, const aiNode* node) {
+			int nodeIndex = skeleton.addNode(node->mName.C_Str(), parent, aiMatrix4x4ToGlm(node->mTransformation));
+			for (unsigned int i = 0; i < node->mNumChildren; i++)
+				buildNodeHierarchy(skeleton, nodeIndex, node->mChildren[i]);
+		}
+
+		// meshes in the order of a depth first walk, each with the node that references it
+		void collectMeshes(const aiNode* node, std::vector<std::pair<const aiNode*, unsigned int>>& meshes) {
+			for (unsigned int i = 0; i < node->mNumMeshes; i++)
+				meshes.emplace_back(node, node->mMeshes[i]);
+			for (unsigned int i = 0; i < node->mNumChildren; i++)
+				collectMeshes(node->mChildren[i], meshes);
+		}
+
+		// the only part of the assembly that writes the skeleton
+		void registerBones(const aiMesh* mesh, Skeleton& skeleton, std::vector<uint32_t>& boneIndices) {
+			boneIndices.resize(mesh->mNumBones);
+			for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+				std::string boneName(mesh->mBones[i]->mName.C_Str());
+				boneIndices[i] = skeleton.addBone(boneName, skeleton.getNodeIndex(boneName), aiMatrix4x4ToGlm(mesh->mBones[i]->mOffsetMatrix));
+			}
+		}
+
+		void assembleMesh(const aiMesh* mesh, const std::vector<uint32_t>& boneIndices, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+			vertices.assign(static_cast<size_t>(mesh->mNumVertices) * kStride, 0.0f);
+			for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+				float* vertex = &vertices[static_cast<size_t>(i) * kStride];
+				vertex[0] = mesh->mVertices[i].x;
+				vertex[1] = mesh->mVertices[i].y;
+				vertex[2] = mesh->mVertices[i].z;
+				if (mesh->HasNormals()) {
+					vertex[3] = mesh->mNormals[i].x;
+					vertex[4] = mesh->mNormals[i].y;
+					vertex[5] = mesh->mNormals[i].z;
+				}
+				if (mesh->HasTextureCoords(0)) {
+					vertex[6] = mesh->mTextureCoords[0][i].x;
+					vertex[7] = mesh->mTextureCoords[0][i].y;
+				}
+				// no bone, the weights stay 0
+				for (int k = 0; k < 4; k++)
+					vertex[kBoneIDOffset + k] = -1.0f;
+			}
+
+			indices.clear();
+			indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
+			for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+				const aiFace& face = mesh->mFaces[i];
+				indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+			}
+
+			for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+				const aiBone* aibone = mesh->mBones[i];
+				float boneIndex = static_cast<float>(boneIndices[i]);
+				for (unsigned int j = 0; j < aibone->mNumWeights; j++) {
+					float* vertex = &vertices[static_cast<size_t>(aibone->mWeights[j].mVertexId) * kStride];
+					for (int k = 0; k < 4; k++) {
+						if (vertex[kWeightOffset + k] == 0.0f) {
+							vertex[kBoneIDOffset + k] = boneIndex;
+							vertex[kWeightOffset + k] = aibone->mWeights[j].mWeight;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// Bones are registered up front in mesh order, so their indices match a sequential import.
+		// The meshes are then assembled as background jobs of one mesh each, <threadCount> of them in
+		// flight: a finished job queues the next mesh. The frame never runs them and a worker is back
+		// for frame work after one mesh. False when <cancelled> stopped it.
+		bool assembleMeshes(const aiScene* scene, Skeleton& skeleton, std::vector<MeshData>& meshes, uint32_t threadCount,
+			const std::atomic<bool>& cancelled, std::atomic<float>* progress) {
+			std::vector<std::pair<const aiNode*, unsigned int>> sources;
+			collectMeshes(scene->mRootNode, sources);
+			const uint32_t count = static_cast<uint32_t>(sources.size());
+
+			std::vector<std::vector<uint32_t>> boneIndices(count);
+			for (uint32_t i = 0; i < count; i++)
+				registerBones(scene->mMeshes[sources[i].second], skeleton, boneIndices[i]);
+
+			meshes.resize(count);
+			JobSystem& jobs = JobSystem::get();
+			JobCounter counter;
+			std::atomic<uint32_t> next{ 0 }, assembled{ 0 };
+			std::function<void()> assembleNext;
+			assembleNext = [&] {
+				uint32_t i = next++;
+				if (i >= count || cancelled)
+					return;
+				meshes[i].name = sources[i].first->mName.C_Str();
+				assembleMesh(scene->mMeshes[sources[i].second], boneIndices[i], meshes[i].vertices, meshes[i].indices);
+				uint32_t done = ++assembled;
+				if (progress) {
+					// jobs finish out of order, the bar only moves forward
+					float value = kImportShare + kAssemblyShare * done / count;
+					float current = *progress;
+					while (current < value && !progress->compare_exchange_weak(current, value)) {}
+				}
+				jobs.runBackground(assembleNext, &counter);
+			};
+
+			uint32_t lanes = std::max(1u, std::min({ threadCount == 0 ? jobs.getThreadCount() : threadCount, jobs.getThreadCount(), count }));
+			for (uint32_t lane = 0; lane < lanes; lane++)
+				jobs.runBackground(assembleNext, &counter);
+			// the loader thread takes its share, and all of it when the system has no workers
+			jobs.waitBackground(counter);
+			return !cancelled;
+		}
+
+		void assembleAnimations(const aiScene* scene, const Skeleton& skeleton, std::vector<AnimationClip>& clips) {
+			for (unsigned int a = 0; a < scene->mNumAnimations; a++) {
+				const aiAnimation* animation = scene->mAnimations[a];
+				const float ticksPerSecond = animation->mTicksPerSecond > 0.0 ? static_cast<float>(animation->mTicksPerSecond) : 25.0f;
+
+				AnimationClip clip(animation->mName.C_Str(), static_cast<float>(animation->mDuration) / ticksPerSecond);
+				for (unsigned int c = 0; c < animation->mNumChannels; c++) {
+					const aiNodeAnim* channel = animation->mChannels[c];
+					int node = skeleton.findNodeIndex(channel->mNodeName.C_Str());
+					if (node < 0)
+						continue;
+
+					clip.beginTrack(node);
+					for (unsigned int k = 0; k < channel->mNumPositionKeys; k++) {
+						const aiVectorKey& key = channel->mPositionKeys[k];
+						clip.addTranslationKey(static_cast<float>(key.mTime) / ticksPerSecond, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+					}
+					for (unsigned int k = 0; k < channel->mNumRotationKeys; k++) {
+						const aiQuatKey& key = channel->mRotationKeys[k];
+						clip.addRotationKey(static_cast<float>(key.mTime) / ticksPerSecond, glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+					}
+					for (unsigned int k = 0; k < channel->mNumScalingKeys; k++) {
+						const aiVectorKey& key = channel->mScalingKeys[k];
+						clip.addScaleKey(static_cast<float>(key.mTime) / ticksPerSecond, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+					}
+				}
+				clips.push_back(std::move(clip));
+			}
+		}
+	}
+
+	const char* getLoadStateName(LoadState state) {
+		switch (state) {
+		case LoadState::Queued: return "queued";
+		case LoadState::Importing: return "importing";
+		case LoadState::Assembling: return "assembling";
+		case LoadState::Uploading: return "uploading";
+		case LoadState::Done: return "done";
+		case LoadState::Failed: return "failed";
+		case LoadState::Cancelled: return "cancelled";
+		}
+		return "";
+	}
+
+	bool ModelLoader::Load::isFinished() const {
+		LoadState state = mState;
+		return state == LoadState::Done || state == LoadState::Failed || state == LoadState::Cancelled;
+	}
+
+	ModelLoader::ModelLoader(double uploadBudgetMs, uint32_t threadCount) : mUploadBudgetMs(uploadBudgetMs), mThreadCount(threadCount) {}
+
+	ModelLoader::~ModelLoader() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+			for (const Ref<Load>& load : mQueue)
+				load->mState = LoadState::Cancelled;
+			// aborts Assimp too, exit does not wait for the import
+			if (mImporting)
+				mImporting->cancel();
+		}
+		mQueueChanged.notify_all();
+		if (mWorker.joinable())
+			mWorker.join();
+
+		mUploads.insert(mUploads.end(), mAssembled.begin(), mAssembled.end());
+
+		// whatever was uploaded so far holds GL objects, released here while the context is still current
+		for (const Ref<Load>& load : mUploads) {
+			load->mModel.meshes.clear();
+			load->mState = LoadState::Cancelled;
+		}
+	}
+
+	Ref<ModelLoader::Load> ModelLoader::load(const std::string& path) {
+		Ref<Load> load = CreateRef<Load>();
+		load->mPath = path;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mWorker.joinable())
+			mWorker = std::thread(&ModelLoader::workerLoop, this);
+		mQueue.push_back(load);
+		mQueueChanged.notify_all();
+		return load;
+	}
+
+	bool ModelLoader::import(Load& load) {
+		if (load.mCancelled) {
+			load.mState = LoadState::Cancelled;
+			return false;
+		}
+		load.mState = LoadState::Importing;
+
+		Assimp::Importer importer;
+		// the importer owns the handler and deletes it
+		importer.SetProgressHandler(new ImportProgress(load.mProgress, load.mCancelled));
+		const aiScene* scene = importer.ReadFile(load.mPath,
+			aiProcess_GlobalScale |
+			aiProcess_Triangulate |
+			aiProcess_JoinIdenticalVertices |
+			aiProcess_GenSmoothNormals |
+			aiProcess_CalcTangentSpace |
+			aiProcess_LimitBoneWeights |
+			aiProcess_ImproveCacheLocality);
+
+		if (load.mCancelled) {
+			load.mState = LoadState::Cancelled;
+			return false;
+		}
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			load.mError = importer.GetErrorString();
+			load.mState = LoadState::Failed;
+			return false;
+		}
+
+		load.mState = LoadState::Assembling;
+		load.mProgress = kImportShare;
+		Model& model = load.mModel;
+		model.skeleton = CreateRef<Skeleton>();
+		buildNodeHierarchy(*model.skeleton, -1, scene->mRootNode);
+		model.skeleton->calculateGlobalTransforms();
+
+		if (!assembleMeshes(scene, *model.skeleton, load.mPending, mThreadCount, load.mCancelled, &load.mProgress)) {
+			load.mState = LoadState::Cancelled;
+			return false;
+		}
+		assembleAnimations(scene, *model.skeleton, model.clips);
+		return true;
+	}
+
+	bool ModelLoader::uploadNext(Load& load) {
+		if (load.mCancelled)
+			return false;
+		if (load.mUploaded == load.mPending.size())
+			return false;
+
+		MeshData& data = load.mPending[load.mUploaded];
+		Ref<SkinnedMesh> mesh = CreateRef<SkinnedMesh>(data.vertices, std::vector<SubMesh>{ SubMesh(data.indices, 0) }, BufferLayout({
+			BufferAttribute(ShaderDataType::Float3, false),
+			BufferAttribute(ShaderDataType::Float3, false),
+			BufferAttribute(ShaderDataType::Float2, false),
+			BufferAttribute(ShaderDataType::Float4, false),
+			BufferAttribute(ShaderDataType::Float4, false)
+			}), std::vector<Bone>());
+		mesh->setName(data.name);
+		load.mModel.meshes.push_back(mesh);
+		load.mModel.meshNames.push_back(std::move(data.name));
+		std::vector<float>().swap(data.vertices);
+		std::vector<uint32_t>().swap(data.indices);
+
+		load.mUploaded++;
+		float uploadShare = 1.0f - kImportShare - kAssemblyShare;
+		load.mProgress = kImportShare + kAssemblyShare + uploadShare * load.mUploaded / load.mPending.size();
+		return load.mUploaded < load.mPending.size();
+	}
+
+	void ModelLoader::update() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			while (!mAssembled.empty()) {
+				mUploads.push_back(std::move(mAssembled.front()));
+				mAssembled.pop_front();
+			}
+		}
+
+		Timer timer;
+		while (!mUploads.empty()) {
+			Load& load = *mUploads.front();
+			bool more = uploadNext(load);
+			if (!more) {
+				if (load.mCancelled) {
+					load.mModel.meshes.clear();
+					load.mState = LoadState::Cancelled;
+				}
+				else {
+					load.mProgress = 1.0f;
+					load.mState = LoadState::Done;
+				}
+				std::vector<MeshData>().swap(load.mPending);
+				mUploads.pop_front();
+			}
+			if (timer.elapsedMs() >= mUploadBudgetMs)
+				break;
+		}
+	}
+
+	void ModelLoader::finish(const Ref<Load>& load) {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueueChanged.wait(lock, [&] { return load->isFinished() || load->getState() == LoadState::Uploading; });
+		}
+		double budget = mUploadBudgetMs;
+		mUploadBudgetMs = 1e30;
+		while (!load->isFinished())
+			update();
+		mUploadBudgetMs = budget;
+	}
+
+	void ModelLoader::workerLoop() {
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;) {
+			mQueueChanged.wait(lock, [this] { return mStop || !mQueue.empty(); });
+			if (mStop)
+				return;
+
+			Ref<Load> load = std::move(mQueue.front());
+			mQueue.pop_front();
+			mImporting = load;
+			lock.unlock();
+
+			Timer timer;
+			bool assembled = import(*load);
+			if (load->mState == LoadState::Failed)
+				std::cerr << "ERROR::ASSIMP::" << load->mError << std::endl;
+			else if (assembled)
+				std::cout << "Imported " << load->mPath << ": " << load->mPending.size() << " meshes in " << timer.elapsedMs() << " ms" << std::endl;
+
+			lock.lock();
+			// under the lock, so finish() never sees an Uploading load that is in neither queue
+			if (assembled) {
+				load->mState = LoadState::Uploading;
+				mAssembled.push_back(load);
+			}
+			mImporting.reset();
+			mQueueChanged.notify_all();
+		}
+	}
+
+	namespace {
+		// <meshCount> meshes of a 32 x 32 vertex grid, every vertex weighted to 4 of <boneCount> bones
+		std::unique_ptr<aiScene> makeBenchmarkScene(uint32_t meshCount, uint32_t boneCount) {
+			const uint32_t grid = 32, vertexCount = grid * grid, influences = 4;
+			std::unique_ptr<aiScene> scene(new aiScene());
+			aiNode* root = scene->mRootNode = new aiNode();
+			root->mName.Set("root");
+			root->mNumChildren = boneCount + meshCount;
+			root->mChildren = new aiNode*[root->mNumChildren];
+			for (uint32_t i = 0; i < root->mNumChildren; i++) {
+				aiNode* node = root->mChildren[i] = new aiNode();
+				node->mParent = root;
+				node->mName.Set(((i < boneCount ? "bone" : "mesh") + std::to_string(i < boneCount ? i : i - boneCount)).c_str());
+				if (i >= boneCount) {
+					node->mNumMeshes = 1;
+					node->mMeshes = new unsigned int[1]{ i - boneCount };
+				}
+			}
+
+			scene->mNumMeshes = meshCount;
+			scene->mMeshes = new aiMesh*[meshCount];
+			for (uint32_t m = 0; m < meshCount; m++) {
+				aiMesh* mesh = scene->mMeshes[m] = new aiMesh();
+				mesh->mNumVertices = vertexCount;
+				mesh->mVertices = new aiVector3D[vertexCount];
+				mesh->mNormals = new aiVector3D[vertexCount];
+				mesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+				mesh->mNumUVComponents[0] = 2;
+				for (uint32_t v = 0; v < vertexCount; v++) {
+					float u = float(v % grid) / (grid - 1), w = float(v / grid) / (grid - 1);
+					mesh->mVertices[v].x = u; mesh->mVertices[v].y = w; mesh->mVertices[v].z = 0.01f * m;
+					mesh->mNormals[v].x = 0.0f; mesh->mNormals[v].y = 0.0f; mesh->mNormals[v].z = 1.0f;
+					mesh->mTextureCoords[0][v].x = u; mesh->mTextureCoords[0][v].y = w; mesh->mTextureCoords[0][v].z = 0.0f;
+				}
+
+				mesh->mNumFaces = (grid - 1) * (grid - 1) * 2;
+				mesh->mFaces = new aiFace[mesh->mNumFaces];
+				for (uint32_t y = 0, f = 0; y + 1 < grid; y++) {
+					for (uint32_t x = 0; x + 1 < grid; x++, f += 2) {
+						uint32_t corner = y * grid + x;
+						mesh->mFaces[f].mNumIndices = 3;
+						mesh->mFaces[f].mIndices = new unsigned int[3]{ corner, corner + 1, corner + grid };
+						mesh->mFaces[f + 1].mNumIndices = 3;
+						mesh->mFaces[f + 1].mIndices = new unsigned int[3]{ corner + 1, corner + grid + 1, corner + grid };
+					}
+				}
+
+				mesh->mNumBones = influences;
+				mesh->mBones = new aiBone*[influences];
+				for (uint32_t b = 0; b < influences; b++) {
+					aiBone* bone = mesh->mBones[b] = new aiBone();
+					bone->mName.Set(("bone" + std::to_string((m * influences + b) % boneCount)).c_str());
+					bone->mNumWeights = vertexCount;
+					bone->mWeights = new aiVertexWeight[vertexCount];
+					for (uint32_t v = 0; v < vertexCount; v++) {
+						bone->mWeights[v].mVertexId = v;
+						bone->mWeights[v].mWeight = 1.0f / influences;
+					}
+				}
+			}
+			return scene;
+		}
+
+		// the assembly after Assimp has parsed the file, what the loader thread spreads over the jobs;
+		// not the parse itself, that is a single ReadFile call on the loader thread whatever the thread count
+		void benchmarkModelAssembly(std::vector<BenchmarkResult>& results) {
+			const uint32_t meshCount = 500, boneCount = 64;
+			std::unique_ptr<aiScene> scene = makeBenchmarkScene(meshCount, boneCount);
+			const std::atomic<bool> cancelled{ false };
+
+			uint32_t hardwareThreads = JobSystem::get().getThreadCount();
+			for (uint32_t threads = 1; ; threads *= 2) {
+				threads = std::min(threads, hardwareThreads);
+				BenchmarkResult result = runBenchmark("assemble 500 meshes after parse, " + std::to_string(threads) + " threads", 5, [&](uint32_t) {
+					Skeleton skeleton;
+					buildNodeHierarchy(skeleton, -1, scene->mRootNode);
+					std::vector<MeshData> meshes;
+					assembleMeshes(scene.get(), skeleton, meshes, threads, cancelled, nullptr);
+				});
+				result.itemsPerIteration = meshCount;
+				result.itemName = "mesh";
+				results.push_back(result);
+				if (threads == hardwareThreads)
+					break;
+			}
+		}
+
+		bool sRegistered = registerBenchmark("model-import", &benchmarkModelAssembly);
+	}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include "Base.h"
+#include "Mesh.h"
+#include "Animation.h"
+
+namespace Gizmo {
+
+	// What an import produces: meshes in the ProcessAiMesh vertex layout (pos3 normal3 uv2
+	// boneID4 weight4), named after the node that references them, on the skeleton built from
+	// the node hierarchy.
+	struct Model {
+		Ref<Skeleton> skeleton;
+		std::vector<Ref<SkinnedMesh>> meshes;
+		std::vector<std::string> meshNames;
+		std::vector<AnimationClip> clips;
+	};
+
+	// CPU side of a mesh, assembled on the loader thread and waiting for its upload
+	struct MeshData {
+		std::string name;
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	enum class LoadState { Queued, Importing, Assembling, Uploading, Done, Failed, Cancelled };
+
+	const char* getLoadStateName(LoadState state);
+
+	// Imports models without blocking the frame. Assimp runs on the loader thread, which then
+	// assembles the meshes in parallel on the JobSystem; the GL buffers are created by update() on
+	// the GL thread, a mesh at a time within a per-frame budget. A load reports its progress and
+	// can be cancelled at any stage, Assimp included (its progress handler aborts the import).
+	class ModelLoader {
+	public:
+		class Load {
+		public:
+			LoadState getState() const { return mState; }
+			bool isFinished() const;
+			// 0..1 over import, assembly and upload
+			float getProgress() const { return mProgress; }
+			const std::string& getPath() const { return mPath; }
+			// why the load failed, once it has
+			const std::string& getError() const { return mError; }
+
+			// takes effect at the next check: between Assimp's steps, meshes and uploads
+			void cancel() { mCancelled = true; }
+			bool isCancelled() const { return mCancelled; }
+
+			// complete once the load is Done, GL thread only
+			Model& getModel() { return mModel; }
+
+		private:
+			friend class ModelLoader;
+
+			std::string mPath;
+			std::string mError;
+			std::atomic<LoadState> mState{ LoadState::Queued };
+			std::atomic<float> mProgress{ 0.0f };
+			std::atomic<bool> mCancelled{ false };
+			Model mModel;
+			std::vector<MeshData> mPending;
+			uint32_t mUploaded = 0;
+		};
+
+		// <uploadBudgetMs> of mesh uploads per update(), at least one mesh a frame; the assembly uses
+		// <threadCount> threads of JobSystem::get(), 0 = all of them
+		ModelLoader(double uploadBudgetMs = 2.0, uint32_t threadCount = 0);
+		~ModelLoader();
+
+		ModelLoader(const ModelLoader&) = delete;
+		ModelLoader& operator=(const ModelLoader&) = delete;
+
+		Ref<Load> load(const std::string& path);
+
+		// uploads assembled meshes within the budget; call once per frame on the GL thread
+		void update();
+		// blocks until <load> is assembled and uploads the rest of it, for startup without a frame loop
+		void finish(const Ref<Load>& load);
+
+		void setUploadBudget(double ms) { mUploadBudgetMs = ms; }
+		double getUploadBudget() const { return mUploadBudgetMs; }
+
+	private:
+		// Assimp and the vertex assembly, false when the load failed or was cancelled
+		bool import(Load& load);
+		// false once every mesh of <load> is up or the load was cancelled
+		bool uploadNext(Load& load);
+		void workerLoop();
+
+		double mUploadBudgetMs;
+		uint32_t mThreadCount;
+		std::deque<Ref<Load>> mUploads; // GL thread
+
+		std::thread mWorker;
+		std::mutex mMutex;
+		std::condition_variable mQueueChanged;
+		std::deque<Ref<Load>> mQueue;
+		std::deque<Ref<Load>> mAssembled; // handed from the worker to update()
+		Ref<Load> mImporting;
+		bool mStop = false;
+	};
+
+}
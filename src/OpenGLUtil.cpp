@@ -2,25 +2,238 @@
 
 #include <string>
 #include <iostream>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+namespace {
+
+    struct CheckSite {
+        const char* file;
+        int line;
+        const char* mess;
+    };
+
+    std::mutex gDebugMutex;
+    bool gDebugOutput = false;
+    bool gCallbackReportsErrors = false; // callback installed on a debug context, glGetError is redundant
+    GLDebugSeverity gMinSeverity = GLDebugSeverity::Low;
+
+    std::unordered_map<uint64_t, uint32_t> gSeenMessages; // message hash -> times reported by the driver
+    uint32_t gSuppressed = 0;
+
+    std::vector<CheckSite> gPendingChecks; // glCheckError sites waiting for the per-frame flush
+    const size_t kMaxPendingChecks = 64;
+
+    const char* errorString(GLenum errorCode) {
+        switch (errorCode)
+        {
+        case GL_INVALID_ENUM:                  return "INVALID_ENUM";
+        case GL_INVALID_VALUE:                 return "INVALID_VALUE";
+        case GL_INVALID_OPERATION:             return "INVALID_OPERATION";
+        case GL_STACK_OVERFLOW:                return "STACK_OVERFLOW";
+        case GL_STACK_UNDERFLOW:               return "STACK_UNDERFLOW";
+        case GL_OUT_OF_MEMORY:                 return "OUT_OF_MEMORY";
+        case GL_INVALID_FRAMEBUFFER_OPERATION: return "INVALID_FRAMEBUFFER_OPERATION";
+        }
+        return "UNKNOWN";
+    }
+
+    GLDebugSeverity toSeverity(GLenum severity) {
+        switch (severity)
+        {
+        case GL_DEBUG_SEVERITY_HIGH:   return GLDebugSeverity::High;
+        case GL_DEBUG_SEVERITY_MEDIUM: return GLDebugSeverity::Medium;
+        case GL_DEBUG_SEVERITY_LOW:    return GLDebugSeverity::Low;
+        }
+        return GLDebugSeverity::Notification;
+    }
+
+    const char* severityString(GLDebugSeverity severity) {
+        switch (severity)
+        {
+        case GLDebugSeverity::High:   return "HIGH";
+        case GLDebugSeverity::Medium: return "MEDIUM";
+        case GLDebugSeverity::Low:    return "LOW";
+        default:                      return "NOTIFICATION";
+        }
+    }
+
+    const char* sourceString(GLenum source) {
+        switch (source)
+        {
+        case GL_DEBUG_SOURCE_API:             return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "WINDOW_SYSTEM";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "SHADER_COMPILER";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     return "THIRD_PARTY";
+        case GL_DEBUG_SOURCE_APPLICATION:     return "APPLICATION";
+        }
+        return "OTHER";
+    }
+
+    const char* typeString(GLenum type) {
+        switch (type)
+        {
+        case GL_DEBUG_TYPE_ERROR:               return "ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "UNDEFINED";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "PERFORMANCE";
+        case GL_DEBUG_TYPE_MARKER:              return "MARKER";
+        }
+        return "OTHER";
+    }
+
+    uint64_t hashMessage(GLenum source, GLenum type, GLuint id, const GLchar* message, GLsizei length) {
+        // FNV-1a over the identifying fields and the text, drivers reuse ids for different objects
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](uint64_t value) { hash ^= value; hash *= 1099511628211ull; };
+        mix(source); mix(type); mix(id);
+        for (GLsizei i = 0; (length < 0) ? message[i] != '\0' : i < length; i++)
+            mix(static_cast<unsigned char>(message[i]));
+        return hash;
+    }
+
+    void GLAPIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* /*userParam*/) {
+        GLDebugSeverity level = toSeverity(severity);
+        if (level < gMinSeverity)
+            return;
+
+        std::lock_guard<std::mutex> lock(gDebugMutex);
+        uint32_t& count = gSeenMessages[hashMessage(source, type, id, message, length)];
+        if (count++ > 0) {
+            gSuppressed++;
+            return;
+        }
+
+        std::cout << "[GL " << severityString(level) << "] " << sourceString(source) << "/" << typeString(type)
+            << " (" << id << "): " << message << "\n";
+    }
+
+    void applySeverityFilter() {
+        // let the driver drop what we would filter anyway instead of formatting it for nothing
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE);
+        if (gMinSeverity <= GLDebugSeverity::Medium)
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_MEDIUM, 0, nullptr, GL_TRUE);
+        if (gMinSeverity <= GLDebugSeverity::Low)
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_LOW, 0, nullptr, GL_TRUE);
+        if (gMinSeverity <= GLDebugSeverity::Notification)
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_TRUE);
+    }
+
+    void reportError(GLenum errorCode, const char* file, int line, const char* mess) {
+        std::cout << errorString(errorCode) << " " << errorCode << " | " << file << " (" << line << ")" << mess << "\n";
+    }
+}
+
+bool glInitDebugOutput(GLDebugSeverity minSeverity) {
+    gMinSeverity = minSeverity;
+    gDebugOutput = (GLEW_KHR_debug || GLEW_VERSION_4_3) && glDebugMessageCallback != nullptr;
+    gCallbackReportsErrors = false;
+
+    if (!gDebugOutput) {
+        std::cout << "GL_KHR_debug not available, using deferred glGetError checks\n";
+        return false;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+#ifdef GIZMOS_DEBUG
+    // synchronous delivery makes the callback run on the offending call; debug builds only
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#else
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    glDebugMessageCallback(debugCallback, nullptr);
+    applySeverityFilter();
+
+    // outside a debug context drivers may stay silent, the callback then only adds to glGetError
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    gCallbackReportsErrors = (flags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0;
+    if (!gCallbackReportsErrors)
+        std::cout << "GL context is not a debug context, glGetError checks stay on\n";
+    return gCallbackReportsErrors;
+}
+
+void glSetDebugSeverity(GLDebugSeverity minSeverity) {
+    gMinSeverity = minSeverity;
+    if (gDebugOutput)
+        applySeverityFilter();
+}
+
+bool glDebugOutputEnabled() {
+    return gCallbackReportsErrors;
+}
+
+uint32_t glDebugMessageCount() {
+    std::lock_guard<std::mutex> lock(gDebugMutex);
+    return static_cast<uint32_t>(gSeenMessages.size());
+}
+
+uint32_t glDebugSuppressedCount() {
+    std::lock_guard<std::mutex> lock(gDebugMutex);
+    return gSuppressed;
+}
+
+void glLabelObject_(GLenum identifier, GLuint name, const char* label, const char* file, int line) {
+    if (!gDebugOutput || name == 0)
+        return;
+
+    std::string path(file);
+    size_t slash = path.find_last_of("/\\");
+    std::string tagged = std::string(label) + " (" + (slash == std::string::npos ? path : path.substr(slash + 1)) + ":" + std::to_string(line) + ")";
+    glObjectLabel(identifier, name, static_cast<GLsizei>(tagged.size()), tagged.c_str());
+}
+
+void glFlushErrors() {
+    if (gCallbackReportsErrors) {
+        gPendingChecks.clear();
+        return;
+    }
+
+    GLenum errorCode;
+    std::vector<GLenum> errors;
+    while ((errorCode = glGetError()) != GL_NO_ERROR)
+        errors.push_back(errorCode);
+
+    // glGetError cannot tell which call raised an error, so the window is reported once with
+    // every site checked in it as a candidate
+    if (!errors.empty()) {
+        std::cout << "GL errors since the last flush:";
+        for (GLenum error : errors)
+            std::cout << " " << errorString(error) << " " << error;
+        std::cout << "\n";
+        if (gPendingChecks.empty())
+            std::cout << "  no glCheckError site was reached\n";
+        else
+            std::cout << "  raised before one of:\n";
+        for (const CheckSite& site : gPendingChecks)
+            std::cout << "    " << site.file << " (" << site.line << ")" << site.mess << "\n";
+    }
+    gPendingChecks.clear();
+}
 
 GLenum glCheckError_(const char* file, int line, const char* mess) {
+    if (gCallbackReportsErrors)
+        return GL_NO_ERROR; // the callback reports it
+
+#ifdef GIZMOS_DEBUG
     GLenum errorCode;
-    glFinish();
+    GLenum lastError = GL_NO_ERROR;
     while ((errorCode = glGetError()) != GL_NO_ERROR)
     {
-        std::string error;
-        switch (errorCode)
-        {
-        case GL_INVALID_ENUM:                  error = "INVALID_ENUM"; break;
-        case GL_INVALID_VALUE:                 error = "INVALID_VALUE"; break;
-        case GL_INVALID_OPERATION:             error = "INVALID_OPERATION"; break;
-        case GL_STACK_OVERFLOW:                error = "STACK_OVERFLOW"; break;
-        case GL_STACK_UNDERFLOW:               error = "STACK_UNDERFLOW"; break;
-        case GL_OUT_OF_MEMORY:                 error = "OUT_OF_MEMORY"; break;
-        case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
-        }
-        std::cout << error << " " << errorCode << " | " << file << " (" << line << ")" << mess << "\n";
+        reportError(errorCode, file, line, mess);
+        lastError = errorCode;
+    }
+    return lastError;
+#else
+    for (const CheckSite& site : gPendingChecks) {
+        if (site.file == file && site.line == line)
+            return GL_NO_ERROR;
     }
-    std::cout << "\n";
-    return errorCode;
-}
\ No newline at end of file
+    if (gPendingChecks.size() < kMaxPendingChecks)
+        gPendingChecks.push_back({ file, line, mess });
+    return GL_NO_ERROR;
+#endif
+}
@@ -2,8 +2,28 @@
 #define UTIL_OPENGL_GUARD
 
 #include <GL/glew.h>
+#include <cstdint>
+
+enum class GLDebugSeverity { Notification = 0, Low, Medium, High };
+
+// Installs a GL_KHR_debug callback when the context supports it. Returns false when errors still
+// go through the glGetError fallback: no KHR_debug, or a context created without the debug flag.
+bool glInitDebugOutput(GLDebugSeverity minSeverity = GLDebugSeverity::Low);
+void glSetDebugSeverity(GLDebugSeverity minSeverity);
+bool glDebugOutputEnabled();
+
+uint32_t glDebugMessageCount();     // unique messages reported
+uint32_t glDebugSuppressedCount();  // duplicates swallowed by deduplication
+
+// Tags a GL object with "<label> (<file>:<line>)" so debug messages and captures point back at the source.
+void glLabelObject_(GLenum identifier, GLuint name, const char* label, const char* file, int line);
+#define glLabelObject(identifier, name, label) glLabelObject_(identifier, name, label, __FILE__, __LINE__)
+
+// Drains glGetError and reports what it held once, listing the glCheckError sites reached since the
+// last call as candidates. Call once per frame.
+void glFlushErrors();
 
 GLenum glCheckError_(const char* file, int line, const char* mess);
-#define glCheckError(mess) glCheckError_(__FILE__, __LINE__, mess) 
+#define glCheckError(mess) glCheckError_(__FILE__, __LINE__, mess)
 
-#endif //UTIL_OPENGL_GUARD
\ No newline at end of file
+#endif //UTIL_OPENGL_GUARD
@@ -0,0 +1,116 @@
+#include "PickingPass.h"
+
+#include "OpenGLUtil.h"
+
+namespace Gizmo {
+
+	PickingPass::PickingPass(uint32_t width, uint32_t height, uint32_t ringSize)
+		: mStaticShader("shaders/v_pick.glsl", "shaders/f_pick.glsl"),
+		mSkinnedShader("shaders/v_pick_skinned.glsl", "shaders/f_pick.glsl"),
+		mPosedShader("shaders/v_pick_posed.glsl", "shaders/f_pick.glsl"),
+		mSlots(ringSize) {
+
+		resize(width, height);
+
+		for (Slot& slot : mSlots) {
+			glCreateBuffers(1, &slot.pbo);
+			glNamedBufferData(slot.pbo, sizeof(uint32_t) * 4, nullptr, GL_STREAM_READ);
+			glLabelObject(GL_BUFFER, slot.pbo, "pick PBO");
+		}
+	}
+
+	PickingPass::~PickingPass() {
+		for (Slot& slot : mSlots) {
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.pbo);
+		}
+	}
+
+	void PickingPass::resize(uint32_t width, uint32_t height) {
+		if (!mFramebuffer) {
+			FramebufferSpec spec;
+			spec.width = width;
+			spec.height = height;
+			spec.attachments = { FramebufferFormat::RGBA32UI, FramebufferFormat::Depth24Stencil8 };
+			mFramebuffer = CreateScope<Framebuffer>(spec);
+		}
+		else {
+			mFramebuffer->Resize(width, height);
+		}
+	}
+
+	void PickingPass::begin(int x, int y) {
+		const FramebufferSpec& spec = mFramebuffer->GetSpec();
+		mPixelX = x;
+		mPixelY = static_cast<int>(spec.height) - 1 - y;
+		mFrame++;
+
+		mFramebuffer->Bind();
+
+		// only the pixel under the cursor is ever read, so only that pixel is cleared and shaded
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(mPixelX, mPixelY, 1, 1);
+
+		const GLuint noObject[4] = { PickNone, 0, 0xFFFFFFFFu, 0xFFFFFFFFu };
+		const GLfloat farDepth = 1.0f;
+		glClearBufferuiv(GL_COLOR, 0, noObject);
+		glClearBufferfv(GL_DEPTH, 0, &farDepth);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	void PickingPass::end() {
+		const FramebufferSpec& spec = mFramebuffer->GetSpec();
+		bool inside = mPixelX >= 0 && mPixelY >= 0 && mPixelX < static_cast<int>(spec.width) && mPixelY < static_cast<int>(spec.height);
+
+		if (inside && mInFlight < mSlots.size()) {
+			Slot& slot = mSlots[mHead];
+
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer->GetID());
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glReadPixels(mPixelX, mPixelY, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+			slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			slot.frame = mFrame;
+			mHead = (mHead + 1) % mSlots.size();
+			mInFlight++;
+		}
+
+		glDisable(GL_SCISSOR_TEST);
+		mFramebuffer->Unbind();
+	}
+
+	void PickingPass::setID(ShaderProgram& shader, uint32_t object, uint32_t subMesh, uint32_t bone, uint32_t node) {
+		glUniform4ui(shader.u("uID"), object, subMesh, bone, node);
+	}
+
+	bool PickingPass::poll(PickResult& result) {
+		bool landed = false;
+		while (mInFlight > 0) {
+			Slot& slot = mSlots[mTail];
+			GLenum status = glClientWaitSync(slot.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(slot.fence);
+			slot.fence = nullptr;
+
+			uint32_t pixel[4];
+			glGetNamedBufferSubData(slot.pbo, 0, sizeof(pixel), pixel);
+			result.object = pixel[0];
+			result.subMesh = pixel[1];
+			result.bone = pixel[2];
+			result.node = pixel[3];
+			result.frame = slot.frame;
+			landed = true;
+
+			mTail = (mTail + 1) % mSlots.size();
+			mInFlight--;
+		}
+		return landed;
+	}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Base.h"
+#include "Framebuffer.h"
+#include "shaderprogram.h"
+
+namespace Gizmo {
+
+	// object ids written into the id attachment, 0 means nothing was hit
+	enum PickObject : uint32_t {
+		PickNone = 0,
+		PickGizmo = 1,      // submesh = hovered axis (1..3)
+		PickBone = 2,       // node = skeleton node index
+		PickMeshBase = 16   // PickMeshBase + mesh index, bone = dominant skinning bone
+	};
+
+	struct PickResult {
+		uint32_t object = PickNone;
+		uint32_t subMesh = 0;
+		uint32_t bone = 0xFFFFFFFFu;
+		uint32_t node = 0xFFFFFFFFu;
+		uint32_t frame = 0; // frame the pick was requested on
+	};
+
+	// Renders object/submesh/bone ids into an RGBA32UI attachment, restricted by scissor to the
+	// pixel under the cursor, and reads that single pixel back through a small fenced PBO ring.
+	// Results arrive one or two frames after the request without stalling the pipeline.
+	class PickingPass {
+	public:
+		PickingPass(uint32_t width, uint32_t height, uint32_t ringSize = 3);
+		~PickingPass();
+
+		PickingPass(const PickingPass&) = delete;
+		PickingPass& operator=(const PickingPass&) = delete;
+
+		// <x>, <y> in window coordinates (origin top-left)
+		void begin(int x, int y);
+		void end();
+
+		ShaderProgram& getStaticShader() { return mStaticShader; }
+		ShaderProgram& getSkinnedShader() { return mSkinnedShader; }
+		ShaderProgram& getPosedShader() { return mPosedShader; } // SkinningPass output
+		static void setID(ShaderProgram& shader, uint32_t object, uint32_t subMesh = 0, uint32_t bone = 0xFFFFFFFFu, uint32_t node = 0xFFFFFFFFu);
+
+		// newest completed pick, false while nothing new has landed
+		bool poll(PickResult& result);
+
+		void resize(uint32_t width, uint32_t height);
+
+	private:
+		struct Slot {
+			GLuint pbo = 0;
+			GLsync fence = nullptr;
+			uint32_t frame = 0;
+		};
+
+		Scope<Framebuffer> mFramebuffer;
+		ShaderProgram mStaticShader;
+		ShaderProgram mSkinnedShader;
+		ShaderProgram mPosedShader;
+
+		std::vector<Slot> mSlots;
+		uint32_t mHead = 0, mTail = 0, mInFlight = 0;
+		uint32_t mFrame = 0;
+
+		int mPixelX = -1, mPixelY = -1;
+	};
+
+}
@@ -0,0 +1,298 @@
+#include "Pose.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "Benchmark.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GIZMOS_POSE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Gizmo {
+
+	void LocalPose::resize(uint32_t count) {
+		translations.resize(count, glm::vec3(0.0f));
+		rotations.resize(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		scales.resize(count, glm::vec3(1.0f));
+	}
+
+	void LocalPose::setTransform(uint32_t index, const glm::mat4& transform) {
+		decomposeTransform(transform, translations[index], rotations[index], scales[index]);
+	}
+
+	glm::mat4 LocalPose::getTransform(uint32_t index) const {
+		glm::mat4 transform;
+		composeTransform(translations[index], rotations[index], scales[index], transform);
+		return transform;
+	}
+
+	void composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, glm::mat4& out) {
+		glm::mat3 r = glm::mat3_cast(rotation);
+		out[0] = glm::vec4(r[0] * scale.x, 0.0f);
+		out[1] = glm::vec4(r[1] * scale.y, 0.0f);
+		out[2] = glm::vec4(r[2] * scale.z, 0.0f);
+		out[3] = glm::vec4(translation, 1.0f);
+	}
+
+	void decomposeTransform(const glm::mat4& transform, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) {
+		translation = glm::vec3(transform[3]);
+
+		glm::mat3 r(transform);
+		scale = glm::vec3(glm::length(r[0]), glm::length(r[1]), glm::length(r[2]));
+		if (glm::dot(glm::cross(r[0], r[1]), r[2]) < 0.0f)
+			scale.x = -scale.x;
+		for (int i = 0; i < 3; i++)
+			r[i] = scale[i] != 0.0f ? r[i] / scale[i] : r[i];
+		rotation = glm::normalize(glm::quat_cast(r));
+	}
+
+	namespace {
+		inline float* floats(std::vector<glm::vec3>& v) { return reinterpret_cast<float*>(v.data()); }
+		inline const float* floats(const std::vector<glm::vec3>& v) { return reinterpret_cast<const float*>(v.data()); }
+
+		inline glm::quat nlerp(const glm::quat& a, const glm::quat& b, float weight) {
+			float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+			float wb = d < 0.0f ? -weight : weight, wa = 1.0f - weight;
+			glm::quat r(a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb);
+			float inv = 1.0f / std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+			return glm::quat(r.w * inv, r.x * inv, r.y * inv, r.z * inv);
+		}
+
+		inline glm::quat multiply(const glm::quat& a, const glm::quat& b) {
+			return glm::quat(
+				a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+				a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+				a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+				a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w);
+		}
+
+		void blendRange(const LocalPose& a, const LocalPose& b, float weight, LocalPose& out, uint32_t first, uint32_t count) {
+			const float* ta = floats(a.translations), * tb = floats(b.translations);
+			const float* sa = floats(a.scales), * sb = floats(b.scales);
+			float* to = floats(out.translations), * so = floats(out.scales);
+			for (uint32_t i = first * 3; i < (first + count) * 3; i++) {
+				to[i] = ta[i] + (tb[i] - ta[i]) * weight;
+				so[i] = sa[i] + (sb[i] - sa[i]) * weight;
+			}
+			for (uint32_t i = first; i < first + count; i++)
+				out.rotations[i] = nlerp(a.rotations[i], b.rotations[i], weight);
+		}
+
+		void addRange(const LocalPose& base, const LocalPose& additive, float weight, LocalPose& out, uint32_t first, uint32_t count) {
+			const float* tb = floats(base.translations), * td = floats(additive.translations);
+			const float* sb = floats(base.scales), * sd = floats(additive.scales);
+			float* to = floats(out.translations), * so = floats(out.scales);
+			for (uint32_t i = first * 3; i < (first + count) * 3; i++) {
+				to[i] = tb[i] + td[i] * weight;
+				so[i] = sb[i] * (1.0f + (sd[i] - 1.0f) * weight);
+			}
+			const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+			for (uint32_t i = first; i < first + count; i++)
+				out.rotations[i] = multiply(base.rotations[i], nlerp(identity, additive.rotations[i], weight));
+		}
+
+#ifdef GIZMOS_POSE_SSE
+		// four quaternions, one register per component
+		struct Quat4 {
+			__m128 x, y, z, w;
+		};
+
+		inline Quat4 loadQuat4(const glm::quat* q) {
+			return { _mm_set_ps(q[3].x, q[2].x, q[1].x, q[0].x), _mm_set_ps(q[3].y, q[2].y, q[1].y, q[0].y),
+				_mm_set_ps(q[3].z, q[2].z, q[1].z, q[0].z), _mm_set_ps(q[3].w, q[2].w, q[1].w, q[0].w) };
+		}
+
+		inline void storeQuat4(const Quat4& q, glm::quat* out) {
+			alignas(16) float x[4], y[4], z[4], w[4];
+			_mm_store_ps(x, q.x); _mm_store_ps(y, q.y); _mm_store_ps(z, q.z); _mm_store_ps(w, q.w);
+			for (int i = 0; i < 4; i++)
+				out[i] = glm::quat(w[i], x[i], y[i], z[i]);
+		}
+
+		inline Quat4 nlerp4(const Quat4& a, const Quat4& b, __m128 wa, __m128 wb) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_add_ps(_mm_mul_ps(a.z, b.z), _mm_mul_ps(a.w, b.w)));
+			wb = _mm_xor_ps(wb, _mm_and_ps(d, _mm_set1_ps(-0.0f))); // flip b onto a's hemisphere
+			Quat4 r = { _mm_add_ps(_mm_mul_ps(a.x, wa), _mm_mul_ps(b.x, wb)), _mm_add_ps(_mm_mul_ps(a.y, wa), _mm_mul_ps(b.y, wb)),
+				_mm_add_ps(_mm_mul_ps(a.z, wa), _mm_mul_ps(b.z, wb)), _mm_add_ps(_mm_mul_ps(a.w, wa), _mm_mul_ps(b.w, wb)) };
+			__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r.x, r.x), _mm_mul_ps(r.y, r.y)), _mm_add_ps(_mm_mul_ps(r.z, r.z), _mm_mul_ps(r.w, r.w)));
+			__m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length2));
+			return { _mm_mul_ps(r.x, inv), _mm_mul_ps(r.y, inv), _mm_mul_ps(r.z, inv), _mm_mul_ps(r.w, inv) };
+		}
+
+		inline Quat4 multiply4(const Quat4& a, const Quat4& b) {
+			return {
+				_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.x), _mm_mul_ps(a.x, b.w)), _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y))),
+				_mm_add_ps(_mm_sub_ps(_mm_mul_ps(a.w, b.y), _mm_mul_ps(a.x, b.z)), _mm_add_ps(_mm_mul_ps(a.y, b.w), _mm_mul_ps(a.z, b.x))),
+				_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.z), _mm_mul_ps(a.x, b.y)), _mm_sub_ps(_mm_mul_ps(a.z, b.w), _mm_mul_ps(a.y, b.x))),
+				_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(a.w, b.w), _mm_mul_ps(a.x, b.x)), _mm_add_ps(_mm_mul_ps(a.y, b.y), _mm_mul_ps(a.z, b.z))) };
+		}
+#endif
+	}
+
+	void blendPoses(const LocalPose& a, const LocalPose& b, float weight, LocalPose& out) {
+		uint32_t count = std::min(a.size(), b.size());
+		out.resize(count);
+#ifdef GIZMOS_POSE_SSE
+		// translations and scales are plain float streams, four lanes regardless of node boundaries
+		uint32_t floatCount = count * 3, simdFloats = floatCount & ~3u;
+		const __m128 w = _mm_set1_ps(weight);
+		const float* ta = floats(a.translations), * tb = floats(b.translations);
+		const float* sa = floats(a.scales), * sb = floats(b.scales);
+		float* to = floats(out.translations), * so = floats(out.scales);
+		for (uint32_t i = 0; i < simdFloats; i += 4) {
+			__m128 va = _mm_loadu_ps(ta + i);
+			_mm_storeu_ps(to + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(tb + i), va), w)));
+			va = _mm_loadu_ps(sa + i);
+			_mm_storeu_ps(so + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sb + i), va), w)));
+		}
+		for (uint32_t i = simdFloats; i < floatCount; i++) {
+			to[i] = ta[i] + (tb[i] - ta[i]) * weight;
+			so[i] = sa[i] + (sb[i] - sa[i]) * weight;
+		}
+
+		uint32_t simdCount = count & ~3u;
+		const __m128 wa = _mm_set1_ps(1.0f - weight);
+		for (uint32_t i = 0; i < simdCount; i += 4)
+			storeQuat4(nlerp4(loadQuat4(&a.rotations[i]), loadQuat4(&b.rotations[i]), wa, w), &out.rotations[i]);
+		for (uint32_t i = simdCount; i < count; i++)
+			out.rotations[i] = nlerp(a.rotations[i], b.rotations[i], weight);
+#else
+		blendRange(a, b, weight, out, 0, count);
+#endif
+	}
+
+	void blendPosesScalar(const LocalPose& a, const LocalPose& b, float weight, LocalPose& out) {
+		uint32_t count = std::min(a.size(), b.size());
+		out.resize(count);
+		blendRange(a, b, weight, out, 0, count);
+	}
+
+	void makeAdditivePose(const LocalPose& pose, const LocalPose& reference, LocalPose& out) {
+		uint32_t count = std::min(pose.size(), reference.size());
+		out.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			const glm::quat& r = reference.rotations[i];
+			out.translations[i] = pose.translations[i] - reference.translations[i];
+			out.rotations[i] = multiply(glm::quat(r.w, -r.x, -r.y, -r.z), pose.rotations[i]);
+			for (int c = 0; c < 3; c++)
+				out.scales[i][c] = reference.scales[i][c] != 0.0f ? pose.scales[i][c] / reference.scales[i][c] : 1.0f;
+		}
+	}
+
+	void addPose(const LocalPose& base, const LocalPose& additive, float weight, LocalPose& out) {
+		uint32_t count = std::min(base.size(), additive.size());
+		out.resize(count);
+#ifdef GIZMOS_POSE_SSE
+		uint32_t floatCount = count * 3, simdFloats = floatCount & ~3u;
+		const __m128 w = _mm_set1_ps(weight), one = _mm_set1_ps(1.0f);
+		const float* tb = floats(base.translations), * td = floats(additive.translations);
+		const float* sb = floats(base.scales), * sd = floats(additive.scales);
+		float* to = floats(out.translations), * so = floats(out.scales);
+		for (uint32_t i = 0; i < simdFloats; i += 4) {
+			_mm_storeu_ps(to + i, _mm_add_ps(_mm_loadu_ps(tb + i), _mm_mul_ps(_mm_loadu_ps(td + i), w)));
+			__m128 s = _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sd + i), one), w));
+			_mm_storeu_ps(so + i, _mm_mul_ps(_mm_loadu_ps(sb + i), s));
+		}
+		for (uint32_t i = simdFloats; i < floatCount; i++) {
+			to[i] = tb[i] + td[i] * weight;
+			so[i] = sb[i] * (1.0f + (sd[i] - 1.0f) * weight);
+		}
+
+		uint32_t simdCount = count & ~3u;
+		const Quat4 identity = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), one };
+		const __m128 wa = _mm_set1_ps(1.0f - weight);
+		for (uint32_t i = 0; i < simdCount; i += 4) {
+			Quat4 delta = nlerp4(identity, loadQuat4(&additive.rotations[i]), wa, w);
+			storeQuat4(multiply4(loadQuat4(&base.rotations[i]), delta), &out.rotations[i]);
+		}
+		const glm::quat identityQuat(1.0f, 0.0f, 0.0f, 0.0f);
+		for (uint32_t i = simdCount; i < count; i++)
+			out.rotations[i] = multiply(base.rotations[i], nlerp(identityQuat, additive.rotations[i], weight));
+#else
+		addRange(base, additive, weight, out, 0, count);
+#endif
+	}
+
+	void addPoseScalar(const LocalPose& base, const LocalPose& additive, float weight, LocalPose& out) {
+		uint32_t count = std::min(base.size(), additive.size());
+		out.resize(count);
+		addRange(base, additive, weight, out, 0, count);
+	}
+
+	namespace {
+		void benchmarkPoseBlending(std::vector<BenchmarkResult>& results) {
+			// 100 characters x 200 bones, 4 layers: two locomotion poses blended, an upper body
+			// override blended on top and an additive lean
+			const uint32_t characters = 100, bones = 200;
+			std::mt19937 rng(5);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			auto randomPose = [&](LocalPose& pose) {
+				pose.resize(bones);
+				for (uint32_t b = 0; b < bones; b++) {
+					pose.translations[b] = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.1f;
+					pose.rotations[b] = glm::normalize(glm::quat(1.0f, unit(rng) * 0.5f, unit(rng) * 0.5f, unit(rng) * 0.5f));
+					pose.scales[b] = glm::vec3(1.0f + unit(rng) * 0.05f);
+				}
+			};
+
+			struct Character {
+				LocalPose walk, run, upperBody, lean, out;
+			};
+			std::vector<Character> crowd(characters);
+			LocalPose reference;
+			randomPose(reference);
+			for (Character& c : crowd) {
+				randomPose(c.walk);
+				randomPose(c.run);
+				randomPose(c.upperBody);
+				LocalPose leanPose;
+				randomPose(leanPose);
+				makeAdditivePose(leanPose, reference, c.lean);
+				c.out.resize(bones);
+			}
+
+			auto run = [&](const char* name, bool simd) {
+				BenchmarkResult result = runBenchmark(name, 600, [&](uint32_t frame) {
+					float w = 0.5f + 0.5f * std::sin(frame * 0.01f);
+					for (Character& c : crowd) {
+						if (simd) {
+							blendPoses(c.walk, c.run, w, c.out);
+							blendPoses(c.out, c.upperBody, 0.3f, c.out);
+							addPose(c.out, c.lean, 0.5f, c.out);
+						}
+						else {
+							blendPosesScalar(c.walk, c.run, w, c.out);
+							blendPosesScalar(c.out, c.upperBody, 0.3f, c.out);
+							addPoseScalar(c.out, c.lean, 0.5f, c.out);
+						}
+					}
+				});
+				result.itemsPerIteration = characters * bones;
+				result.itemName = "bone";
+				results.push_back(result);
+			};
+			run("blend 4 layers, 100 x 200 bones (scalar)", false);
+			run("blend 4 layers, 100 x 200 bones (SIMD)", true);
+
+			float maxError = 0.0f;
+			LocalPose scalar, simd;
+			for (const Character& c : crowd) {
+				blendPosesScalar(c.walk, c.run, 0.3f, scalar);
+				addPoseScalar(scalar, c.lean, 0.7f, scalar);
+				blendPoses(c.walk, c.run, 0.3f, simd);
+				addPose(simd, c.lean, 0.7f, simd);
+				for (uint32_t b = 0; b < bones; b++) {
+					maxError = std::max(maxError, glm::length(scalar.translations[b] - simd.translations[b]));
+					maxError = std::max(maxError, std::fabs(std::fabs(glm::dot(scalar.rotations[b], simd.rotations[b])) - 1.0f));
+				}
+			}
+			printf("[bench] pose blend: max SIMD / scalar difference %g\n", maxError);
+		}
+
+		bool sRegistered = registerBenchmark("pose-blend", &benchmarkPoseBlending);
+	}
+
+}
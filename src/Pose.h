@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace Gizmo {
+
+	// Local transforms of every node of a skeleton as three parallel arrays. Matrices are only
+	// built from it in the global transform pass, so poses can be sampled, blended and layered
+	// without ever decomposing a matrix.
+	struct LocalPose {
+		std::vector<glm::vec3> translations;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+
+		void resize(uint32_t count); // new nodes get the identity transform
+		uint32_t size() const { return static_cast<uint32_t>(translations.size()); }
+
+		void setTransform(uint32_t index, const glm::mat4& transform);
+		glm::mat4 getTransform(uint32_t index) const;
+	};
+
+	// translate * rotate * scale without the two matrix products
+	void composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale, glm::mat4& out);
+	// inverse of composeTransform for matrices without shear; a mirrored matrix gets a negative x scale
+	void decomposeTransform(const glm::mat4& transform, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale);
+
+	// out = mix(a, b, weight) per node, rotations nlerp along the shorter arc. <out> may be <a> or <b>.
+	void blendPoses(const LocalPose& a, const LocalPose& b, float weight, LocalPose& out);
+	void blendPosesScalar(const LocalPose& a, const LocalPose& b, float weight, LocalPose& out);
+
+	// <pose> relative to <reference>: translation difference, inverse(reference) * rotation, scale ratio
+	void makeAdditivePose(const LocalPose& pose, const LocalPose& reference, LocalPose& out);
+
+	// Layers an additive pose on <base>: t + dt * w, r * nlerp(identity, dr, w), s * mix(1, ds, w).
+	// <out> may be <base>.
+	void addPose(const LocalPose& base, const LocalPose& additive, float weight, LocalPose& out);
+	void addPoseScalar(const LocalPose& base, const LocalPose& additive, float weight, LocalPose& out);
+
+}
@@ -0,0 +1,193 @@
+#include "ResourceRegistry.h"
+
+#include <iostream>
+#include <algorithm>
+
+namespace Gizmo {
+
+	const char* getResourceCategoryName(ResourceCategory category) {
+		switch (category) {
+		case ResourceCategory::VertexBuffer:	return "vertex buffer";
+		case ResourceCategory::IndexBuffer:		return "index buffer";
+		case ResourceCategory::VertexArray:		return "vertex array";
+		case ResourceCategory::Texture:			return "texture";
+		case ResourceCategory::Shader:			return "shader";
+		case ResourceCategory::Buffer:			return "buffer";
+		case ResourceCategory::MeshData:		return "mesh data";
+		default:								return "unknown";
+		}
+	}
+
+	ResourceMemory getResourceMemory(ResourceCategory category) {
+		return category == ResourceCategory::MeshData ? ResourceMemory::CPU : ResourceMemory::GPU;
+	}
+
+	namespace {
+		const char* memoryName(ResourceMemory memory) {
+			return memory == ResourceMemory::GPU ? "GPU" : "CPU";
+		}
+	}
+
+	ResourceRegistry& ResourceRegistry::get() {
+		// never destroyed, resources held by globals still unregister during static destruction
+		static ResourceRegistry* registry = new ResourceRegistry();
+		return *registry;
+	}
+
+	uint32_t ResourceRegistry::add(ResourceCategory category, uint64_t bytes, const std::string& name) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry& entry = mEntries[mNextId];
+		entry.id = mNextId++;
+		entry.category = category;
+		entry.bytes = bytes;
+		entry.name = name;
+
+		mTotals[static_cast<uint32_t>(category)].count++;
+		account(entry, static_cast<int64_t>(bytes));
+		return entry.id;
+	}
+
+	void ResourceRegistry::resize(uint32_t id, uint64_t bytes) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(id);
+		if (it == mEntries.end())
+			return;
+		int64_t delta = static_cast<int64_t>(bytes) - static_cast<int64_t>(it->second.bytes);
+		it->second.bytes = bytes;
+		account(it->second, delta);
+	}
+
+	void ResourceRegistry::rename(uint32_t id, const std::string& name) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(id);
+		if (it != mEntries.end())
+			it->second.name = name;
+	}
+
+	void ResourceRegistry::remove(uint32_t id) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(id);
+		if (it == mEntries.end())
+			return;
+		mTotals[static_cast<uint32_t>(it->second.category)].count--;
+		account(it->second, -static_cast<int64_t>(it->second.bytes));
+		mEntries.erase(it);
+	}
+
+	void ResourceRegistry::account(const Entry& entry, int64_t delta) {
+		CategoryTotals& totals = mTotals[static_cast<uint32_t>(entry.category)];
+		totals.bytes += delta;
+		totals.peakBytes = std::max(totals.peakBytes, totals.bytes);
+
+		ResourceMemory memory = getResourceMemory(entry.category);
+		uint32_t m = static_cast<uint32_t>(memory);
+		mBytes[m] += delta;
+		mPeakBytes[m] = std::max(mPeakBytes[m], mBytes[m]);
+		checkBudget(memory, &entry);
+	}
+
+	void ResourceRegistry::checkBudget(ResourceMemory memory, const Entry* cause) {
+		// warn on the way up only, the flag rearms once the total drops back under the budget
+		uint32_t m = static_cast<uint32_t>(memory);
+		bool over = mBudget[m] > 0 && mBytes[m] > mBudget[m];
+		if (over && !mOverBudget[m]) {
+			std::cerr << "ResourceRegistry: " << memoryName(memory) << " memory " << mBytes[m] / 1024 << " KB exceeds the budget of " << mBudget[m] / 1024 << " KB";
+			if (cause)
+				std::cerr << " after " << getResourceCategoryName(cause->category) << " '" << cause->name << "' (" << cause->bytes / 1024 << " KB)";
+			std::cerr << std::endl;
+		}
+		mOverBudget[m] = over;
+	}
+
+	ResourceRegistry::CategoryTotals ResourceRegistry::getTotals(ResourceCategory category) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mTotals[static_cast<uint32_t>(category)];
+	}
+
+	uint64_t ResourceRegistry::getBytes(ResourceMemory memory) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mBytes[static_cast<uint32_t>(memory)];
+	}
+
+	uint64_t ResourceRegistry::getPeakBytes(ResourceMemory memory) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mPeakBytes[static_cast<uint32_t>(memory)];
+	}
+
+	uint32_t ResourceRegistry::getCount() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return static_cast<uint32_t>(mEntries.size());
+	}
+
+	std::vector<ResourceRegistry::Entry> ResourceRegistry::getEntries() const {
+		std::vector<Entry> entries;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			entries.reserve(mEntries.size());
+			for (const auto& entry : mEntries)
+				entries.push_back(entry.second);
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			return a.bytes != b.bytes ? a.bytes > b.bytes : a.id < b.id;
+		});
+		return entries;
+	}
+
+	void ResourceRegistry::setBudget(ResourceMemory memory, uint64_t bytes) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		uint32_t m = static_cast<uint32_t>(memory);
+		mBudget[m] = bytes;
+		mOverBudget[m] = false;
+		checkBudget(memory, nullptr);
+	}
+
+	uint64_t ResourceRegistry::getBudget(ResourceMemory memory) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mBudget[static_cast<uint32_t>(memory)];
+	}
+
+	bool ResourceRegistry::isOverBudget(ResourceMemory memory) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mOverBudget[static_cast<uint32_t>(memory)];
+	}
+
+	uint32_t ResourceRegistry::reportLeaks() const {
+		std::vector<Entry> leaks = getEntries();
+		if (leaks.empty())
+			return 0;
+
+		std::cerr << "ResourceRegistry: " << leaks.size() << " resources still alive" << std::endl;
+		for (const Entry& entry : leaks)
+			std::cerr << "  #" << entry.id << " " << getResourceCategoryName(entry.category) << " '" << entry.name << "' " << entry.bytes << " bytes" << std::endl;
+		return static_cast<uint32_t>(leaks.size());
+	}
+
+	TrackedResource::TrackedResource(ResourceCategory category, uint64_t bytes, const std::string& name)
+		: mId(ResourceRegistry::get().add(category, bytes, name)) {}
+
+	TrackedResource& TrackedResource::operator=(TrackedResource&& other) noexcept {
+		if (this != &other) {
+			reset();
+			mId = other.mId;
+			other.mId = 0;
+		}
+		return *this;
+	}
+
+	void TrackedResource::resize(uint64_t bytes) {
+		if (mId)
+			ResourceRegistry::get().resize(mId, bytes);
+	}
+
+	void TrackedResource::rename(const std::string& name) {
+		if (mId)
+			ResourceRegistry::get().rename(mId, name);
+	}
+
+	void TrackedResource::reset() {
+		if (mId)
+			ResourceRegistry::get().remove(mId);
+		mId = 0;
+	}
+
+}
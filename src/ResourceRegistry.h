@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace Gizmo {
+
+	enum class ResourceCategory { VertexBuffer = 0, IndexBuffer, VertexArray, Texture, Shader, Buffer, MeshData, Count };
+	enum class ResourceMemory { GPU = 0, CPU };
+
+	const char* getResourceCategoryName(ResourceCategory category);
+	// MeshData is the CPU copy meshes keep for picking and CPU skinning, the rest lives in VRAM
+	ResourceMemory getResourceMemory(ResourceCategory category);
+
+	// Every GL object and large CPU copy the engine creates registers here with its size, category
+	// and debug name. Sizes of GL objects are estimates of what the driver allocates (textures are
+	// counted as RGBA8 plus mips, shaders by their program binary). Thread safe, resources may
+	// register from jobs.
+	class ResourceRegistry {
+	public:
+		struct Entry {
+			uint32_t id = 0;
+			ResourceCategory category = ResourceCategory::Buffer;
+			uint64_t bytes = 0;
+			std::string name;
+		};
+
+		struct CategoryTotals {
+			uint32_t count = 0;
+			uint64_t bytes = 0;
+			uint64_t peakBytes = 0;
+		};
+
+		// engine-wide instance, created on first use
+		static ResourceRegistry& get();
+
+		// returns the id to pass to resize(), rename() and remove(), never 0
+		uint32_t add(ResourceCategory category, uint64_t bytes, const std::string& name);
+		void resize(uint32_t id, uint64_t bytes);
+		void rename(uint32_t id, const std::string& name);
+		void remove(uint32_t id);
+
+		CategoryTotals getTotals(ResourceCategory category) const;
+		uint64_t getBytes(ResourceMemory memory) const;
+		uint64_t getPeakBytes(ResourceMemory memory) const;
+		uint32_t getCount() const;
+		// copies, sorted by size, largest first
+		std::vector<Entry> getEntries() const;
+
+		// warns on std::cerr each time the total of <memory> crosses <bytes>, 0 disables the check
+		void setBudget(ResourceMemory memory, uint64_t bytes);
+		uint64_t getBudget(ResourceMemory memory) const;
+		bool isOverBudget(ResourceMemory memory) const;
+
+		// prints everything still registered, returns the number of leaked resources
+		uint32_t reportLeaks() const;
+
+		// Reports leaks when it goes out of scope. Declare one right after the GL context, so it
+		// runs after every resource declared later was destroyed and while the context still exists.
+		class LeakCheck {
+		public:
+			LeakCheck() = default;
+			~LeakCheck() { ResourceRegistry::get().reportLeaks(); }
+
+			LeakCheck(const LeakCheck&) = delete;
+			LeakCheck& operator=(const LeakCheck&) = delete;
+		};
+
+	private:
+		void account(const Entry& entry, int64_t delta);
+		void checkBudget(ResourceMemory memory, const Entry* cause);
+
+		static const uint32_t kCategoryCount = static_cast<uint32_t>(ResourceCategory::Count);
+
+		mutable std::mutex mMutex;
+		std::unordered_map<uint32_t, Entry> mEntries;
+		uint32_t mNextId = 1;
+		CategoryTotals mTotals[kCategoryCount];
+		uint64_t mBytes[2] = {}, mPeakBytes[2] = {}, mBudget[2] = {};
+		bool mOverBudget[2] = {};
+	};
+
+	// Registration owned by a resource: added on construction, removed on destruction, moves with
+	// its owner. Default constructed it tracks nothing.
+	class TrackedResource {
+	public:
+		TrackedResource() = default;
+		TrackedResource(ResourceCategory category, uint64_t bytes, const std::string& name);
+		~TrackedResource() { reset(); }
+
+		TrackedResource(const TrackedResource&) = delete;
+		TrackedResource& operator=(const TrackedResource&) = delete;
+
+		TrackedResource(TrackedResource&& other) noexcept : mId(other.mId) { other.mId = 0; }
+		TrackedResource& operator=(TrackedResource&& other) noexcept;
+
+		void resize(uint64_t bytes);
+		void rename(const std::string& name);
+		void reset();
+
+		bool isTracked() const { return mId != 0; }
+
+	private:
+		uint32_t mId = 0;
+	};
+
+}
@@ -0,0 +1,205 @@
+#include "SkinningPass.h"
+
+#include <algorithm>
+
+#include "OpenGLUtil.h"
+
+namespace Gizmo {
+
+	namespace {
+		const uint32_t kWorkGroupSize = 64; // local_size_x in c_skinning.glsl
+	}
+
+	SkinningPass::SkinningPass(StreamingBuffer& stream, uint32_t maxBones) : mShader("shaders/c_skinning.glsl"), mStream(stream), mMaxBones(maxBones) {}
+
+	const BufferLayout& SkinningPass::getPosedLayout() {
+		static const BufferLayout layout({
+			BufferAttribute(ShaderDataType::Float3, false),
+			BufferAttribute(ShaderDataType::Float3, false),
+			BufferAttribute(ShaderDataType::Float2, false),
+			BufferAttribute(ShaderDataType::Float, false)
+			});
+		return layout;
+	}
+
+	uint32_t SkinningPass::addMesh(const Ref<StaticMesh>& mesh, SkinningMode mode) {
+		PosedMesh posed;
+		posed.source = mesh;
+		posed.mode = mode;
+		mMeshes.push_back(posed);
+		mBuilt = false;
+		return static_cast<uint32_t>(mMeshes.size() - 1);
+	}
+
+	void SkinningPass::build() {
+		uint32_t stride = getPosedLayout().GetStride();
+		uint32_t vertexCount = 0, indexCount = 0;
+		for (PosedMesh& mesh : mMeshes) {
+			mesh.baseVertex = vertexCount;
+			mesh.firstIndex = indexCount;
+			vertexCount += mesh.source->getVertexCount();
+			indexCount += mesh.source->getSubMesh(0).getCount();
+		}
+
+		mPosed = CreateRef<VertexBuffer>(std::max(vertexCount, 1u) * stride);
+		mPosed->SetLayout(getPosedLayout());
+		mPosed->SetName("posed vertices");
+
+		std::vector<float> layers;
+		for (const PosedMesh& mesh : mMeshes)
+			layers.push_back(mesh.materialLayer);
+		mMaterials = CreateRef<VertexBuffer>(std::max<uint32_t>(static_cast<uint32_t>(layers.size()), 1) * sizeof(float));
+		mMaterials->SetLayout({ BufferAttribute(ShaderDataType::Float, false) });
+		mMaterials->SetName("posed material layers");
+		if (!layers.empty())
+			mMaterials->SetData(layers.data(), static_cast<uint32_t>(layers.size() * sizeof(float)));
+
+		// the source index buffers stay where they are for per-mesh draws, this is a GPU side copy
+		mIndices = CreateRef<IndexBuffer>(static_cast<uint32_t*>(nullptr), std::max(indexCount, 1u));
+		mIndices->SetName("posed indices");
+		for (const PosedMesh& mesh : mMeshes) {
+			const Ref<IndexBuffer>& source = mesh.source->getIndexBuffer(0);
+			glCopyNamedBufferSubData(source->GetID(), mIndices->GetID(), 0, mesh.firstIndex * sizeof(uint32_t), source->GetCount() * sizeof(uint32_t));
+		}
+
+		for (uint32_t i = 0; i < mMeshes.size(); i++) {
+			PosedMesh& mesh = mMeshes[i];
+			mesh.vao = CreateRef<VertexArray>();
+			mesh.vao->AddVertexBuffer(mPosed, 0, static_cast<size_t>(mesh.baseVertex) * stride);
+			// instance 0 of a plain draw reads this mesh's layer
+			mesh.vao->AddVertexBuffer(mMaterials, 1, i * sizeof(float));
+			mesh.vao->SetIndexBuffer(mesh.source->getIndexBuffer(0));
+			mesh.vao->Unbind();
+		}
+
+		// the draw commands' baseInstance picks the layer
+		mBatchVao = CreateRef<VertexArray>();
+		mBatchVao->AddVertexBuffer(mPosed);
+		mBatchVao->AddVertexBuffer(mMaterials, 1);
+		mBatchVao->SetIndexBuffer(mIndices);
+		mBatchVao->Unbind();
+		mBuilt = true;
+	}
+
+	void SkinningPass::setMeshMaterial(uint32_t index, float layer) {
+		mMeshes[index].materialLayer = layer;
+		if (mBuilt)
+			mMaterials->SetData(&layer, sizeof(float), index * sizeof(float));
+	}
+
+	void SkinningPass::setPalette(const std::vector<glm::mat4>& palette) {
+		mBoneCount = std::min(static_cast<uint32_t>(palette.size()), mMaxBones);
+		if (mBoneCount > 0)
+			mPalette = mStream.upload(palette.data(), sizeof(glm::mat4) * mBoneCount);
+		if (!mPalette)
+			mBoneCount = 0;
+	}
+
+	void SkinningPass::setPalette(const std::vector<DualQuat>& palette) {
+		mDualQuatBoneCount = std::min(static_cast<uint32_t>(palette.size()), mMaxBones);
+		if (mDualQuatBoneCount > 0)
+			mDualQuatPalette = mStream.upload(palette.data(), sizeof(DualQuat) * mDualQuatBoneCount);
+		if (!mDualQuatPalette)
+			mDualQuatBoneCount = 0;
+	}
+
+	void SkinningPass::setPalette(const Skeleton& skeleton) {
+		uint32_t boneCount = static_cast<uint32_t>(skeleton.getBoneCount());
+		if (boneCount > mMaxBones || boneCount == 0) {
+			setPalette(skeleton.calculateSkinningMatrices()); // clamps
+			return;
+		}
+		mPalette = mStream.allocate(sizeof(glm::mat4) * boneCount);
+		mBoneCount = mPalette ? boneCount : 0;
+		if (mPalette)
+			skeleton.calculateSkinningMatrices(static_cast<glm::mat4*>(mPalette.data));
+	}
+
+	bool SkinningPass::usesMode(SkinningMode mode) const {
+		for (const PosedMesh& mesh : mMeshes) {
+			if (mesh.mode == mode)
+				return true;
+		}
+		return false;
+	}
+
+	void SkinningPass::dispatch() {
+		if (!mBuilt)
+			build();
+		mShader.use();
+		// a mode without a palette this frame skins with uBoneCount 0, its binding is never read
+		if (mPalette)
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, mPalette.buffer, mPalette.offset, mPalette.size);
+		if (mDualQuatPalette)
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, mDualQuatPalette.buffer, mDualQuatPalette.offset, mDualQuatPalette.size);
+
+		for (const PosedMesh& mesh : mMeshes) {
+			uint32_t vertexCount = mesh.source->getVertexCount();
+			bool dualQuat = mesh.mode == SkinningMode::DualQuaternion;
+			glUniform1ui(mShader.u("uVertexCount"), vertexCount);
+			glUniform1ui(mShader.u("uBoneCount"), dualQuat ? mDualQuatBoneCount : mBoneCount);
+			glUniform1i(mShader.u("uDualQuat"), dualQuat ? 1 : 0);
+			glUniform1ui(mShader.u("uBaseVertex"), mesh.baseVertex);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.source->getVertexBuffer()->GetID());
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mPosed->GetID());
+			glDispatchCompute((vertexCount + kWorkGroupSize - 1) / kWorkGroupSize, 1, 1);
+		}
+
+		// one barrier for all meshes, the posed buffers are only read as vertex attributes
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+		// the stream recycles these ranges, next frame needs fresh ones
+		mPalette = StreamingBuffer::Allocation();
+		mDualQuatPalette = StreamingBuffer::Allocation();
+		mBoneCount = mDualQuatBoneCount = 0;
+		glCheckError("skinning dispatch");
+	}
+
+	void SkinningPass::bindPosedMesh(uint32_t index, int subMesh) {
+		if (!mBuilt)
+			build();
+		PosedMesh& mesh = mMeshes[index];
+		mesh.vao->SetIndexBuffer(mesh.source->getIndexBuffer(subMesh));
+	}
+
+	void SkinningPass::drawPosedMeshes(const std::vector<uint32_t>& meshes) {
+		if (meshes.empty())
+			return;
+		if (!mBuilt)
+			build();
+
+		struct DrawElementsIndirectCommand {
+			GLuint count, instanceCount, firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+		StreamingBuffer::Allocation commands = mStream.allocate(meshes.size() * sizeof(DrawElementsIndirectCommand));
+		if (!commands) {
+			// the stream is full this frame, fall back to a draw per mesh
+			for (uint32_t index : meshes) {
+				bindPosedMesh(index);
+				glDrawElements(GL_TRIANGLES, mMeshes[index].source->getSubMesh(0).getCount(), GL_UNSIGNED_INT, nullptr);
+			}
+			return;
+		}
+
+		DrawElementsIndirectCommand* command = static_cast<DrawElementsIndirectCommand*>(commands.data);
+		for (uint32_t index : meshes) {
+			const PosedMesh& mesh = mMeshes[index];
+			*command++ = { mesh.source->getSubMesh(0).getCount(), 1, mesh.firstIndex, static_cast<GLint>(mesh.baseVertex), index };
+		}
+
+		mBatchVao->Bind();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(commands.offset), static_cast<GLsizei>(meshes.size()), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	uint32_t SkinningPass::getVertexCount() const {
+		uint32_t count = 0;
+		for (const PosedMesh& mesh : mMeshes)
+			count += mesh.source->getVertexCount();
+		return count;
+	}
+
+}
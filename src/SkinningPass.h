@@ -0,0 +1,89 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Base.h"
+#include "Mesh.h"
+#include "VertexArray.h"
+#include "StreamingBuffer.h"
+#include "shaderprogram.h"
+
+namespace Gizmo {
+
+	enum class SkinningMode { LinearBlend = 0, DualQuaternion };
+
+	// Skins every registered mesh once per frame with a compute shader into a posed vertex
+	// buffer (pos3 normal3 uv2 dominantBone). Later passes draw the posed meshes as static
+	// geometry with v_posed.glsl / v_pick_posed.glsl instead of re-skinning per pass.
+	// All meshes share one posed buffer and one index buffer, with a material layer per mesh
+	// fetched as an instanced attribute, so any set of them can be drawn with a single
+	// glMultiDrawElementsIndirect whatever their materials.
+	class SkinningPass {
+	public:
+		// palettes are sub-allocated from <stream> every frame
+		SkinningPass(StreamingBuffer& stream, uint32_t maxBones = 100);
+
+		SkinningPass(const SkinningPass&) = delete;
+		SkinningPass& operator=(const SkinningPass&) = delete;
+
+		// <mesh> uses the ProcessAiMesh vertex layout and 32-bit indices, returns the posed mesh index
+		uint32_t addMesh(const Ref<StaticMesh>& mesh, SkinningMode mode = SkinningMode::LinearBlend);
+
+		void setMeshMode(uint32_t index, SkinningMode mode) { mMeshes[index].mode = mode; }
+		SkinningMode getMeshMode(uint32_t index) const { return mMeshes[index].mode; }
+		bool usesMode(SkinningMode mode) const;
+
+		// texture array layer v_posed.glsl samples for the mesh
+		void setMeshMaterial(uint32_t index, float layer);
+
+		// one write per frame and mode in use, shared by every mesh; palettes are written straight
+		// into the mapped stream, so they can be latched right before dispatch()
+		void setPalette(const std::vector<glm::mat4>& palette);
+		void setPalette(const std::vector<DualQuat>& palette);
+		// computes the skinning matrices of <skeleton> in place, no intermediate vector
+		void setPalette(const Skeleton& skeleton);
+
+		// skins all meshes and issues the barrier for vertex fetch
+		void dispatch();
+
+		void bindPosedMesh(uint32_t index, int subMesh = 0);
+		// sub mesh 0 of every mesh in <meshes> in one call, the commands are sub-allocated from the stream
+		void drawPosedMeshes(const std::vector<uint32_t>& meshes);
+		uint32_t getMeshCount() const { return static_cast<uint32_t>(mMeshes.size()); }
+		uint32_t getVertexCount() const;
+
+		static const BufferLayout& getPosedLayout();
+
+	private:
+		struct PosedMesh {
+			Ref<StaticMesh> source;
+			Ref<VertexArray> vao;       // this mesh's range of the shared buffers
+			SkinningMode mode;
+			uint32_t baseVertex = 0;
+			uint32_t firstIndex = 0;
+			float materialLayer = 0.0f;
+		};
+
+		// lays the meshes out in the shared buffers, after addMesh() and before the first use
+		void build();
+
+		ComputeShaderProgram mShader;
+		std::vector<PosedMesh> mMeshes;
+		Ref<VertexBuffer> mPosed;       // every mesh back to back
+		Ref<VertexBuffer> mMaterials;   // one layer per mesh
+		Ref<IndexBuffer> mIndices;      // sub mesh 0 of every mesh, for drawPosedMeshes()
+		Ref<VertexArray> mBatchVao;
+		bool mBuilt = false;
+		StreamingBuffer& mStream;
+		StreamingBuffer::Allocation mPalette; // this frame's, consumed by dispatch()
+		StreamingBuffer::Allocation mDualQuatPalette;
+		uint32_t mMaxBones;
+		uint32_t mBoneCount = 0;
+		uint32_t mDualQuatBoneCount = 0;
+	};
+
+}
@@ -0,0 +1,99 @@
+#include "StreamingBuffer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "OpenGLUtil.h"
+#include "Benchmark.h"
+
+namespace Gizmo {
+
+	StreamingBuffer::StreamingBuffer(GLsizeiptr segmentSize) {
+		GLint storageAlignment = 256, uniformAlignment = 256;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		mAlignment = std::max<GLsizeiptr>(16, std::max(storageAlignment, uniformAlignment));
+		mSegmentSize = (segmentSize + mAlignment - 1) / mAlignment * mAlignment;
+
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &mBuffer);
+		glNamedBufferStorage(mBuffer, mSegmentSize * kSegments, nullptr, flags);
+		mMapped = static_cast<uint8_t*>(glMapNamedBufferRange(mBuffer, 0, mSegmentSize * kSegments, flags));
+		glLabelObject(GL_BUFFER, mBuffer, "streaming ring");
+		mTracking = TrackedResource(ResourceCategory::Buffer, mSegmentSize * kSegments, "streaming ring");
+	}
+
+	StreamingBuffer::~StreamingBuffer() {
+		for (GLsync fence : mFences) {
+			if (fence)
+				glDeleteSync(fence);
+		}
+		glUnmapNamedBuffer(mBuffer);
+		glDeleteBuffers(1, &mBuffer);
+	}
+
+	StreamingBuffer::Allocation StreamingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+		GLsizeiptr align = std::max(alignment, mAlignment);
+		GLsizeiptr offset = (mHead + align - 1) / align * align;
+		if (mSegmentUnsafe) {
+			mFailedAllocations++;
+			return Allocation();
+		}
+		if (!mMapped || offset + size > mSegmentSize) {
+			if (mFailedAllocations++ == 0)
+				std::cerr << "StreamingBuffer: " << size << " bytes do not fit the " << mSegmentSize << " byte segment, falling back" << std::endl;
+			return Allocation();
+		}
+
+		mHead = offset + size;
+		mFrameBytes += size;
+
+		Allocation allocation;
+		allocation.offset = mSegment * mSegmentSize + offset;
+		allocation.data = mMapped + allocation.offset;
+		allocation.buffer = mBuffer;
+		allocation.size = size;
+		return allocation;
+	}
+
+	StreamingBuffer::Allocation StreamingBuffer::upload(const void* data, GLsizeiptr size, GLsizeiptr alignment) {
+		Allocation allocation = allocate(size, alignment);
+		if (allocation)
+			std::memcpy(allocation.data, data, size);
+		return allocation;
+	}
+
+	void StreamingBuffer::endFrame() {
+		mFences[mSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		mBytesStreamed += mFrameBytes;
+		mLastFrameBytes = mFrameBytes;
+		mFrameBytes = 0;
+
+		mSegment = (mSegment + 1) % kSegments;
+		mHead = 0;
+		mSegmentUnsafe = false;
+
+		// the next segment was fenced kSegments - 1 frames ago, normally long done
+		GLsync& fence = mFences[mSegment];
+		if (fence) {
+			GLenum status = glClientWaitSync(fence, 0, 0);
+			if (status == GL_TIMEOUT_EXPIRED) {
+				Timer waitTimer;
+				mFenceWaits++;
+				// writing before the fence signals would race the GPU reads, so there is no giving up
+				while ((status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull)) == GL_TIMEOUT_EXPIRED)
+					std::cerr << "StreamingBuffer: segment " << mSegment << " still in use after " << waitTimer.elapsedMs() << " ms" << std::endl;
+				mFenceWaitMs += waitTimer.elapsedMs();
+			}
+			if (status == GL_WAIT_FAILED) {
+				// no way to tell when the GPU is done with it, this frame's allocations fall back instead
+				std::cerr << "StreamingBuffer: fence wait failed, segment " << mSegment << " skipped for a frame" << std::endl;
+				mSegmentUnsafe = true;
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+}
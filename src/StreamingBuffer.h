@@ -0,0 +1,65 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstdint>
+
+#include "ResourceRegistry.h"
+
+namespace Gizmo {
+
+	// Per-frame dynamic data without glBufferData/glBufferSubData: one persistently mapped,
+	// coherent buffer split into kSegments segments, one per frame in flight. allocate() bumps
+	// through the current segment and hands out a CPU pointer plus the buffer range to bind;
+	// endFrame() fences the segment and moves on, waiting only if the GPU still reads the next one.
+	class StreamingBuffer {
+	public:
+		struct Allocation {
+			void* data = nullptr;
+			GLuint buffer = 0;
+			GLintptr offset = 0;
+			GLsizeiptr size = 0;
+
+			explicit operator bool() const { return buffer != 0; }
+		};
+
+		static const uint32_t kSegments = 3;
+
+		StreamingBuffer(GLsizeiptr segmentSize = 4 << 20);
+		~StreamingBuffer();
+
+		StreamingBuffer(const StreamingBuffer&) = delete;
+		StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+		// valid until the endFrame() after next; empty when the segment is full or its fence could not be waited on
+		Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 0);
+		Allocation upload(const void* data, GLsizeiptr size, GLsizeiptr alignment = 0);
+
+		// call once per frame after the last draw that reads this frame's allocations
+		void endFrame();
+
+		GLuint getBuffer() const { return mBuffer; }
+		GLsizeiptr getSegmentSize() const { return mSegmentSize; }
+
+		uint64_t getBytesStreamed() const { return mBytesStreamed; }
+		uint64_t getLastFrameBytes() const { return mLastFrameBytes; }
+		uint32_t getFenceWaits() const { return mFenceWaits; }
+		double getFenceWaitMs() const { return mFenceWaitMs; }
+		uint32_t getFailedAllocations() const { return mFailedAllocations; }
+
+	private:
+		GLuint mBuffer = 0;
+		uint8_t* mMapped = nullptr;
+		GLsizeiptr mSegmentSize;
+		GLsizeiptr mAlignment = 256; // satisfies uniform and storage buffer offsets
+		GLsync mFences[kSegments] = {};
+		uint32_t mSegment = 0;
+		GLsizeiptr mHead = 0;
+		bool mSegmentUnsafe = false; // its fence wait failed, nothing is handed out until the next frame
+		TrackedResource mTracking;
+
+		uint64_t mBytesStreamed = 0, mFrameBytes = 0, mLastFrameBytes = 0;
+		uint32_t mFenceWaits = 0, mFailedAllocations = 0;
+		double mFenceWaitMs = 0.0;
+	};
+
+}
@@ -1,47 +1,147 @@
 #include "Texture2D.h"
+#include "OpenGLUtil.h"
+#include "MipContainer.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+
 Texture2D::Texture2D(const char* path, uint32_t slotID) : mSlotID(slotID), mFilePath(path) {
-    mTextureID = loadTexture();
+    Gizmo::MipContainer container;
+    if (container.open(path)) {
+        mTextureID = loadTexture(container);
+        return;
+    }
+    DecodedImage image = decode(path);
+    mTextureID = loadTexture(image);
 }
 
-Texture2D::~Texture2D() {}
+Texture2D::Texture2D(const char* path, DecodedImage& image, uint32_t slotID) : mSlotID(slotID), mFilePath(path) {
+    mTextureID = loadTexture(image);
+}
+
+Texture2D::Texture2D(const char* path, const Gizmo::MipContainer& container, uint32_t slotID) : mSlotID(slotID), mFilePath(path) {
+    mTextureID = loadTexture(container);
+}
+
+Texture2D::Texture2D(const char* path, uint32_t width, uint32_t height, uint32_t channels, uint32_t levelCount, bool srgb, uint32_t slotID)
+    : mSlotID(slotID), mWidth(width), mHeight(height), mBPP(channels), mLevelCount(levelCount), mBaseLevel(levelCount - 1), mFilePath(path) {
+    mTextureID = createTexture();
+
+    bool rgba = channels == 4;
+    GLenum internalFormat = srgb ? (rgba ? GL_SRGB8_ALPHA8 : GL_SRGB8) : (rgba ? GL_RGBA8 : GL_RGB8);
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+    mInternalFormat = internalFormat;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mBaseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    // the storage is allocated whole, however few levels hold texels yet
+    mTracking.resize(getMemorySize());
+}
+
+Texture2D::DecodedImage Texture2D::decode(const char* path) {
+    // the per-thread flag, the global one would race with decodes on other jobs
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    DecodedImage image;
+    image.pixels = stbi_load(path, &image.width, &image.height, &image.channels, 0);
+    return image;
+}
+
+Texture2D::DecodedImage Texture2D::decode(const unsigned char* data, size_t size) {
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    DecodedImage image;
+    image.pixels = stbi_load_from_memory(data, static_cast<int>(size), &image.width, &image.height, &image.channels, 0);
+    return image;
+}
+
+Texture2D::~Texture2D() {
+    glDeleteTextures(1, &mTextureID);
+}
 
-GLuint Texture2D::loadTexture() {
+GLuint Texture2D::createTexture() {
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
+    glLabelObject(GL_TEXTURE, textureID, mFilePath.c_str());
+    mTracking = Gizmo::TrackedResource(Gizmo::ResourceCategory::Texture, 0, mFilePath);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+GLuint Texture2D::loadTexture(const Gizmo::MipContainer& container) {
+    GLuint textureID = createTexture();
+    mWidth = container.getWidth();
+    mHeight = container.getHeight();
+    mBPP = container.getChannels();
+
+    bool rgba = container.getChannels() == 4;
+    GLenum format = rgba ? GL_RGBA : GL_RGB;
+    GLenum internalFormat = container.isSRGB() ? (rgba ? GL_SRGB8_ALPHA8 : GL_SRGB8) : (rgba ? GL_RGBA8 : GL_RGB8);
+
+    // rows are tightly packed, RGB rows are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < container.getLevelCount(); i++) {
+        const Gizmo::MipContainer::Level& level = container.getLevel(i);
+        glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, container.getLevelCount() - 1);
+    mLevelCount = container.getLevelCount();
+    mInternalFormat = internalFormat;
+
+    mTracking.resize(getMemorySize());
+    return textureID;
+}
 
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(mFilePath, &width, &height, &nrChannels, 0);
+GLuint Texture2D::loadTexture(DecodedImage& image) {
+    GLuint textureID = createTexture();
 
-    mWidth = width; 
-    mHeight = height; 
+    mWidth = image.width; 
+    mHeight = image.height; 
+    mBPP = image.channels;
 
-    if (data) {
-        GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
+    if (image.pixels) {
+        GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+        mInternalFormat = (image.channels == 4) ? GL_RGBA8 : GL_RGB8;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, mInternalFormat, mWidth, mHeight, 0, format, GL_UNSIGNED_BYTE, image.pixels);
         glGenerateMipmap(GL_TEXTURE_2D);
+        mLevelCount = Gizmo::getMipLevelCount(mWidth, mHeight);
+
+        mTracking.resize(getMemorySize());
 
-        stbi_image_free(data);
+        stbi_image_free(image.pixels);
     }
     else {
         std::cerr << "Failed to load texture: " << mFilePath << "\n";
-        stbi_image_free(data);
+        stbi_image_free(image.pixels);
     }
+    image.pixels = nullptr;
 
     return textureID;
 }
 
+void Texture2D::uploadRows(uint32_t level, uint32_t y, uint32_t rows, const void* pixels) {
+    uint32_t levelWidth = std::max(1u, mWidth >> level);
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, levelWidth, rows, mBPP == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Texture2D::setBaseLevel(uint32_t level) {
+    mBaseLevel = std::min(level, mLevelCount - 1);
+    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mBaseLevel);
+}
+
 void Texture2D::Bind()
 {
     glActiveTexture(GL_TEXTURE0 + mSlotID);
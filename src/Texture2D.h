@@ -5,26 +5,71 @@
 
 #include <gl/glew.h>
 
+#include "ResourceRegistry.h"
+
+namespace Gizmo { class MipContainer; }
+
 class Texture2D
 {
 public:
+    // pixels decoded from a file, owned until handed to the constructor below
+    struct DecodedImage {
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = nullptr;
+    };
+
+    // CPU only and thread safe, so it can run as a job ahead of the GL upload
+    static DecodedImage decode(const char* path);
+    // same for a file already read into memory
+    static DecodedImage decode(const unsigned char* data, size_t size);
+
+    // <path> is an image stb_image decodes or a mip container, see MipContainer.h
     Texture2D(const char* path, uint32_t slotID = 0);
+    // uploads and frees <image>, needs the GL context
+    Texture2D(const char* path, DecodedImage& image, uint32_t slotID = 0);
+    // uploads the pre-filtered levels as they are, no decode and no glGenerateMipmap
+    Texture2D(const char* path, const Gizmo::MipContainer& container, uint32_t slotID = 0);
+    // immutable storage for <levelCount> levels with nothing uploaded yet, sampling starts at the
+    // last level: upload it first, then lower the base level as bigger ones arrive (TextureStreamer.h)
+    Texture2D(const char* path, uint32_t width, uint32_t height, uint32_t channels, uint32_t levelCount, bool srgb, uint32_t slotID = 0);
     ~Texture2D();
 
+    // owns the GL texture
+    Texture2D(const Texture2D&) = delete;
+    Texture2D& operator=(const Texture2D&) = delete;
+
     void Bind();
     void Unbind();
 
+    // <rows> tightly packed rows of <level> starting at row <y>, immutable storage only
+    void uploadRows(uint32_t level, uint32_t y, uint32_t rows, const void* pixels);
+    // samples levels [level, last] only, so every level in that range must be uploaded
+    void setBaseLevel(uint32_t level);
+
     inline int getWidth() const { return mWidth; }
     inline int getHeight() const { return mHeight; }
     inline GLuint getTexture() const { return mTextureID; }
     inline uint32_t getSlot() const { return mSlotID; }
+    inline uint32_t getChannels() const { return mBPP; }
+    inline uint32_t getLevelCount() const { return mLevelCount; }
+    inline uint32_t getBaseLevel() const { return mBaseLevel; }
+    // sized format of the storage, 0 when nothing could be loaded
+    inline GLenum getInternalFormat() const { return mInternalFormat; }
+    // estimate of the driver allocation: RGB8 is padded to 4 bytes a texel, the mip chain adds a third
+    inline uint64_t getMemorySize() const { return static_cast<uint64_t>(mWidth) * mHeight * 4 * 4 / 3; }
 
 private:
-    GLuint loadTexture();
-    uint32_t mTextureID;
+    GLuint loadTexture(DecodedImage& image);
+    GLuint loadTexture(const Gizmo::MipContainer& container);
+    GLuint createTexture();
+    uint32_t mTextureID = 0;
     uint32_t mSlotID;
-    uint32_t mWidth;
-    uint32_t mHeight;
-    uint32_t mBPP;
-    const char* mFilePath;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    uint32_t mBPP = 0;
+    uint32_t mLevelCount = 1;
+    uint32_t mBaseLevel = 0;
+    GLenum mInternalFormat = 0;
+    std::string mFilePath;
+    Gizmo::TrackedResource mTracking;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "TextureArray.h"
+
+#include <algorithm>
+
+#include "Texture2D.h"
+#include "OpenGLUtil.h"
+
+namespace Gizmo {
+
+	TextureArray::TextureArray(uint32_t width, uint32_t height, uint32_t layerCount, uint32_t levelCount, GLenum internalFormat,
+		const std::string& name, uint32_t slotID)
+		: mWidth(width), mHeight(height), mLayerCount(layerCount), mLevelCount(levelCount), mBaseLevel(levelCount - 1),
+		mInternalFormat(internalFormat), mSlotID(slotID) {
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &mTextureID);
+		glLabelObject(GL_TEXTURE, mTextureID, name.c_str());
+		glTextureStorage3D(mTextureID, levelCount, internalFormat, width, height, layerCount);
+
+		glTextureParameteri(mTextureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(mTextureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(mTextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(mTextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(mTextureID, GL_TEXTURE_BASE_LEVEL, mBaseLevel);
+		glTextureParameteri(mTextureID, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+		// same estimate as Texture2D::getMemorySize(), per layer
+		mTracking = TrackedResource(ResourceCategory::Texture, static_cast<uint64_t>(width) * height * 4 * 4 / 3 * layerCount, name);
+	}
+
+	TextureArray::~TextureArray() {
+		glDeleteTextures(1, &mTextureID);
+	}
+
+	void TextureArray::copyLevels(uint32_t layer, const Texture2D& source, uint32_t firstLevel, uint32_t lastLevel) {
+		for (uint32_t level = firstLevel; level <= std::min(lastLevel, mLevelCount - 1); level++) {
+			GLsizei width = std::max(1u, mWidth >> level), height = std::max(1u, mHeight >> level);
+			glCopyImageSubData(source.getTexture(), GL_TEXTURE_2D, level, 0, 0, 0, mTextureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1);
+		}
+	}
+
+	void TextureArray::clearLayer(uint32_t layer, const uint8_t rgba[4]) {
+		for (uint32_t level = 0; level < mLevelCount; level++) {
+			GLsizei width = std::max(1u, mWidth >> level), height = std::max(1u, mHeight >> level);
+			glClearTexSubImage(mTextureID, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+		}
+	}
+
+	void TextureArray::setBaseLevel(uint32_t level) {
+		mBaseLevel = std::min(level, mLevelCount - 1);
+		glTextureParameteri(mTextureID, GL_TEXTURE_BASE_LEVEL, mBaseLevel);
+	}
+
+	void TextureArray::Bind() const {
+		glBindTextureUnit(mSlotID, mTextureID);
+	}
+
+	void TextureArray::Unbind() const {
+		glBindTextureUnit(mSlotID, 0);
+	}
+
+}
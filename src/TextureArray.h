@@ -0,0 +1,54 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <string>
+#include <cstdint>
+
+#include "ResourceRegistry.h"
+
+class Texture2D;
+
+namespace Gizmo {
+
+	// GL_TEXTURE_2D_ARRAY with immutable storage: same-sized layers that one binding serves, a
+	// draw selects its layer instead of binding a texture. Layers are filled with GPU copies
+	// from Texture2Ds of a compatible format, see MaterialTextures.h.
+	class TextureArray {
+	public:
+		TextureArray(uint32_t width, uint32_t height, uint32_t layerCount, uint32_t levelCount, GLenum internalFormat,
+			const std::string& name, uint32_t slotID = 0);
+		~TextureArray();
+
+		TextureArray(const TextureArray&) = delete;
+		TextureArray& operator=(const TextureArray&) = delete;
+
+		// levels [firstLevel, lastLevel] of <source> into <layer>, glCopyImageSubData so nothing goes through the CPU
+		void copyLevels(uint32_t layer, const Texture2D& source, uint32_t firstLevel, uint32_t lastLevel);
+		// every level of <layer> set to one RGBA8 colour
+		void clearLayer(uint32_t layer, const uint8_t rgba[4]);
+		// samples levels [level, last] only, so every layer must hold them
+		void setBaseLevel(uint32_t level);
+
+		void Bind() const;
+		void Unbind() const;
+
+		uint32_t getWidth() const { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+		uint32_t getLayerCount() const { return mLayerCount; }
+		uint32_t getLevelCount() const { return mLevelCount; }
+		uint32_t getBaseLevel() const { return mBaseLevel; }
+		GLenum getInternalFormat() const { return mInternalFormat; }
+		GLuint getTexture() const { return mTextureID; }
+		uint32_t getSlot() const { return mSlotID; }
+
+	private:
+		GLuint mTextureID = 0;
+		uint32_t mWidth, mHeight;
+		uint32_t mLayerCount, mLevelCount;
+		uint32_t mBaseLevel;
+		GLenum mInternalFormat;
+		uint32_t mSlotID;
+		TrackedResource mTracking;
+	};
+
+}
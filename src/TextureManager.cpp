@@ -0,0 +1,259 @@
+#include "TextureManager.h"
+
+#include <iostream>
+#include <cstring>
+
+#include "JobSystem.h"
+#include "MipContainer.h"
+
+namespace Gizmo {
+
+	TextureManager::Handle& TextureManager::Handle::operator=(const Handle& other) {
+		if (this != &other) {
+			reset();
+			mManager = other.mManager;
+			mHash = other.mHash;
+			addRef();
+		}
+		return *this;
+	}
+
+	TextureManager::Handle& TextureManager::Handle::operator=(Handle&& other) noexcept {
+		if (this != &other) {
+			reset();
+			mManager = other.mManager;
+			mHash = other.mHash;
+			other.mManager = nullptr;
+		}
+		return *this;
+	}
+
+	Texture2D* TextureManager::Handle::get() const {
+		return mManager ? mManager->acquire(mHash) : nullptr;
+	}
+
+	void TextureManager::Handle::reset() {
+		if (mManager)
+			mManager->release(mHash);
+		mManager = nullptr;
+	}
+
+	void TextureManager::Handle::addRef() {
+		if (mManager)
+			mManager->mEntries[mHash].refCount++;
+	}
+
+	TextureManager::TextureManager(uint64_t budgetBytes) : mBudget(budgetBytes) {}
+
+	TextureManager::~TextureManager() {
+		uint32_t referenced = 0;
+		for (const auto& entry : mEntries)
+			referenced += entry.second.refCount > 0 ? 1 : 0;
+		if (referenced > 0)
+			std::cerr << "TextureManager: destroyed while " << referenced << " textures are still referenced" << std::endl;
+	}
+
+	TextureManager::FileData TextureManager::readFile(const std::string& path) {
+		FileData file;
+		file.valid = file.file.open(path);
+		if (file.valid)
+			file.hash = hashContents(file.file.data(), file.file.size());
+		return file;
+	}
+
+	uint64_t TextureManager::hashContents(const uint8_t* data, size_t size) {
+		// FNV-1a over 8-byte words, folded so the high bits feed back into the low ones
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](uint64_t value) { hash ^= value; hash *= 1099511628211ull; hash ^= hash >> 32; };
+
+		size_t words = size / 8;
+		for (size_t w = 0; w < words; w++) {
+			uint64_t value;
+			std::memcpy(&value, data + w * 8, 8);
+			mix(value);
+		}
+		for (size_t i = words * 8; i < size; i++)
+			mix(data[i]);
+		mix(size);
+		return hash;
+	}
+
+	Ref<Texture2D> TextureManager::createTexture(const Entry& entry, const FileData& file, Texture2D::DecodedImage* decoded) {
+		if (mStreamer && file.valid)
+			return mStreamer->request(entry.path, entry.slot);
+
+		MipContainer container;
+		if (file.valid && container.parse(file.file.data(), file.file.size()))
+			return CreateRef<Texture2D>(entry.path.c_str(), container, entry.slot);
+
+		Texture2D::DecodedImage image;
+		if (decoded) {
+			image = *decoded;
+			decoded->pixels = nullptr;
+		}
+		else if (file.valid) {
+			image = Texture2D::decode(file.file.data(), file.file.size());
+		}
+		return CreateRef<Texture2D>(entry.path.c_str(), image, entry.slot);
+	}
+
+	TextureManager::Handle TextureManager::load(const std::string& path, uint32_t slot) {
+		auto known = mPathToHash.find(path);
+		if (known != mPathToHash.end()) {
+			mStats.hits++;
+			return Handle(this, known->second);
+		}
+
+		FileData file = readFile(path);
+		if (!file.valid) {
+			std::cerr << "TextureManager: cannot read " << path << std::endl;
+			return Handle();
+		}
+		return resolve(path, file, nullptr, slot);
+	}
+
+	std::vector<TextureManager::Handle> TextureManager::load(const std::vector<std::string>& paths, uint32_t slot) {
+		JobSystem& jobs = JobSystem::get();
+
+		// read and hash the paths seen for the first time
+		std::vector<FileData> files(paths.size());
+		JobCounter reads;
+		for (size_t i = 0; i < paths.size(); i++) {
+			if (!mPathToHash.count(paths[i]))
+				jobs.run([&files, &paths, i] { files[i] = readFile(paths[i]); }, &reads);
+		}
+		jobs.wait(reads);
+
+		// decode every new content once, however many paths lead to it
+		std::vector<Texture2D::DecodedImage> images(paths.size());
+		std::unordered_map<uint64_t, size_t> firstWithHash;
+		JobCounter decodes;
+		for (size_t i = 0; i < paths.size(); i++) {
+			if (!files[i].valid || mEntries.count(files[i].hash) || !firstWithHash.emplace(files[i].hash, i).second)
+				continue;
+			// the streamer decodes on its own threads
+			if (mStreamer || MipContainer::isMipContainer(files[i].file.data(), files[i].file.size()))
+				continue;
+			jobs.run([&files, &images, i] { images[i] = Texture2D::decode(files[i].file.data(), files[i].file.size()); }, &decodes);
+		}
+		jobs.wait(decodes);
+
+		std::vector<Handle> handles(paths.size());
+		for (size_t i = 0; i < paths.size(); i++) {
+			if (mPathToHash.count(paths[i])) {
+				handles[i] = load(paths[i], slot);
+			}
+			else if (!files[i].valid) {
+				std::cerr << "TextureManager: cannot read " << paths[i] << std::endl;
+			}
+			else {
+				// a later path with the same hash decodes itself if its bytes turn out to differ
+				auto first = firstWithHash.find(files[i].hash);
+				bool decodedHere = first != firstWithHash.end() && first->second == i;
+				handles[i] = resolve(paths[i], files[i], decodedHere ? &images[i] : nullptr, slot);
+			}
+		}
+		return handles;
+	}
+
+	bool TextureManager::sameContents(const Entry& entry, const FileData& file) {
+		MappedFile mapped;
+		if (!mapped.open(entry.path) || mapped.size() != file.file.size())
+			return false;
+		return mapped.size() == 0 || std::memcmp(mapped.data(), file.file.data(), mapped.size()) == 0;
+	}
+
+	TextureManager::Handle TextureManager::resolve(const std::string& path, const FileData& file, Texture2D::DecodedImage* decoded, uint32_t slot) {
+		// a matching hash is only a candidate: the bytes decide, and different contents under the same
+		// hash take the next free key
+		uint64_t key = file.hash;
+		for (auto existing = mEntries.find(key); existing != mEntries.end(); existing = mEntries.find(++key)) {
+			if (existing->second.hash == file.hash && sameContents(existing->second, file)) {
+				mStats.hits++;
+				mStats.deduplicated++;
+				existing->second.aliases.push_back(path);
+				mPathToHash[path] = key;
+				return Handle(this, key);
+			}
+			if (existing->second.hash == file.hash)
+				std::cerr << "TextureManager: " << path << " and " << existing->second.path << " hash the same but differ, kept apart" << std::endl;
+		}
+
+		mStats.misses++;
+		Entry& entry = mEntries[key];
+		entry.path = path;
+		entry.aliases.push_back(path);
+		entry.hash = file.hash;
+		entry.slot = slot;
+		mPathToHash[path] = key;
+
+		makeResident(entry, key, createTexture(entry, file, decoded));
+		return Handle(this, key);
+	}
+
+	Texture2D* TextureManager::acquire(uint64_t hash) {
+		Entry& entry = mEntries[hash];
+		if (entry.texture) {
+			touch(entry);
+			return entry.texture.get();
+		}
+
+		FileData file = readFile(entry.path);
+		if (file.valid && file.hash != entry.hash)
+			std::cerr << "TextureManager: " << entry.path << " changed on disk since it was first loaded" << std::endl;
+		makeResident(entry, hash, createTexture(entry, file, nullptr));
+		mStats.reloads++;
+		return entry.texture.get();
+	}
+
+	void TextureManager::release(uint64_t hash) {
+		auto it = mEntries.find(hash);
+		if (it == mEntries.end() || --it->second.refCount > 0)
+			return;
+		// unreferenced but resident entries stay cached until the budget evicts them
+		if (!it->second.texture)
+			erase(hash);
+	}
+
+	void TextureManager::makeResident(Entry& entry, uint64_t hash, Ref<Texture2D> texture) {
+		entry.texture = std::move(texture);
+		mResidentBytes += entry.texture->getMemorySize();
+		mLru.push_front(hash);
+		entry.lru = mLru.begin();
+		entry.lastUsedFrame = mFrame;
+	}
+
+	void TextureManager::evict(uint64_t hash) {
+		Entry& entry = mEntries[hash];
+		mResidentBytes -= entry.texture->getMemorySize();
+		entry.texture.reset();
+		mLru.erase(entry.lru);
+		mStats.evictions++;
+		if (entry.refCount == 0)
+			erase(hash);
+	}
+
+	void TextureManager::erase(uint64_t hash) {
+		auto it = mEntries.find(hash);
+		for (const std::string& alias : it->second.aliases)
+			mPathToHash.erase(alias);
+		mEntries.erase(it);
+	}
+
+	void TextureManager::touch(Entry& entry) {
+		entry.lastUsedFrame = mFrame;
+		mLru.splice(mLru.begin(), mLru, entry.lru);
+	}
+
+	void TextureManager::endFrame() {
+		while (mBudget > 0 && mResidentBytes > mBudget && !mLru.empty()) {
+			uint64_t hash = mLru.back();
+			// everything from here to the front was bound this frame
+			if (mEntries[hash].lastUsedFrame == mFrame)
+				break;
+			evict(hash);
+		}
+		mFrame++;
+	}
+
+}
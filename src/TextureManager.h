@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Base.h"
+#include "Texture2D.h"
+#include "MappedFile.h"
+#include "TextureStreamer.h"
+
+namespace Gizmo {
+
+	// Owns every Texture2D, keyed by a hash of the file contents (bytes compared on a match), so the same image reached through
+	// different paths is decoded and uploaded once; mip containers (MipContainer.h) skip the decode.
+	// Handles are reference counted. Over the budget, endFrame() evicts the least recently bound
+	// textures that were not bound this frame; a handle to an evicted texture reloads it from disk
+	// the next time it is bound. Textures without handles stay cached until they are evicted.
+	// With a TextureStreamer set, new and reloaded textures come from it and refine over the next frames.
+	// GL thread only.
+	class TextureManager {
+	public:
+		class Handle {
+		public:
+			Handle() = default;
+			~Handle() { reset(); }
+
+			Handle(const Handle& other) : mManager(other.mManager), mHash(other.mHash) { addRef(); }
+			Handle& operator=(const Handle& other);
+			Handle(Handle&& other) noexcept : mManager(other.mManager), mHash(other.mHash) { other.mManager = nullptr; }
+			Handle& operator=(Handle&& other) noexcept;
+
+			// the resident texture, reloaded when it was evicted; marks it used this frame
+			Texture2D* get() const;
+			Texture2D* operator->() const { return get(); }
+
+			explicit operator bool() const { return mManager != nullptr; }
+			uint64_t getHash() const { return mHash; }
+
+			void reset();
+
+		private:
+			friend class TextureManager;
+			Handle(TextureManager* manager, uint64_t hash) : mManager(manager), mHash(hash) { addRef(); }
+			void addRef();
+
+			TextureManager* mManager = nullptr;
+			uint64_t mHash = 0;
+		};
+
+		struct Stats {
+			uint32_t hits = 0;          // loads served from the cache
+			uint32_t deduplicated = 0;  // of those, a new path to content that was already loaded
+			uint32_t misses = 0;        // loads that decoded and uploaded
+			uint32_t evictions = 0;
+			uint32_t reloads = 0;       // evicted textures bound again
+		};
+
+		// <budgetBytes> of resident textures, 0 = unlimited
+		TextureManager(uint64_t budgetBytes = 0);
+		~TextureManager();
+
+		TextureManager(const TextureManager&) = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+
+		// empty handle when the file cannot be read; <slot> only applies to content not loaded yet
+		Handle load(const std::string& path, uint32_t slot = 0);
+		// reads, hashes and decodes the new files on the job system, uploads on this thread
+		std::vector<Handle> load(const std::vector<std::string>& paths, uint32_t slot = 0);
+
+		// textures created from now on stream in, null to load them whole again
+		void setStreamer(TextureStreamer* streamer) { mStreamer = streamer; }
+
+		void setBudget(uint64_t bytes) { mBudget = bytes; }
+		uint64_t getBudget() const { return mBudget; }
+
+		// evicts down to the budget, then starts the next frame
+		void endFrame();
+
+		uint64_t getResidentBytes() const { return mResidentBytes; }
+		uint32_t getResidentCount() const { return static_cast<uint32_t>(mLru.size()); }
+		uint32_t getTextureCount() const { return static_cast<uint32_t>(mEntries.size()); }
+		const Stats& getStats() const { return mStats; }
+
+	private:
+		struct Entry {
+			std::string path;               // first path the content was loaded from, reloads read it
+			std::vector<std::string> aliases; // every path mapped to this entry, path included
+			uint64_t hash = 0;              // of the contents; the key differs when another content hashed the same
+			uint32_t slot = 0;
+			Ref<Texture2D> texture;         // null while evicted, shared with the streamer while it refines
+			uint32_t refCount = 0;
+			uint64_t lastUsedFrame = 0;
+			std::list<uint64_t>::iterator lru;
+		};
+
+		// mapped file contents and their hash, filled on a job
+		struct FileData {
+			MappedFile file;
+			uint64_t hash = 0;
+			bool valid = false;
+		};
+
+		static FileData readFile(const std::string& path);
+		static uint64_t hashContents(const uint8_t* data, size_t size);
+		Ref<Texture2D> createTexture(const Entry& entry, const FileData& file, Texture2D::DecodedImage* decoded);
+
+		// byte comparison against the file the entry was loaded from
+		static bool sameContents(const Entry& entry, const FileData& file);
+		// alias or new entry for a file that was read already
+		Handle resolve(const std::string& path, const FileData& file, Texture2D::DecodedImage* decoded, uint32_t slot);
+		Texture2D* acquire(uint64_t hash);
+		void release(uint64_t hash);
+		void makeResident(Entry& entry, uint64_t hash, Ref<Texture2D> texture);
+		void evict(uint64_t hash);
+		void erase(uint64_t hash);
+		void touch(Entry& entry);
+
+		std::unordered_map<uint64_t, Entry> mEntries;
+		std::unordered_map<std::string, uint64_t> mPathToHash;
+		std::list<uint64_t> mLru; // resident entries, most recently bound first
+		uint64_t mBudget;
+		uint64_t mResidentBytes = 0;
+		uint64_t mFrame = 1;
+		Stats mStats;
+		TextureStreamer* mStreamer = nullptr;
+	};
+
+	using TextureHandle = TextureManager::Handle;
+
+}
@@ -0,0 +1,240 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+
+#include <stb_image.h>
+
+namespace Gizmo {
+
+	namespace {
+		// levels up to this size are uploaded by request(), a few KB per texture
+		const uint32_t kTailSize = 64;
+		const size_t kPageSize = 4096;
+	}
+
+	TextureStreamer::TextureStreamer(uint64_t frameBudgetBytes, uint32_t loaderCount)
+		: mFrameBudget(frameBudgetBytes), mLoaderCount(std::max(1u, loaderCount)) {}
+
+	TextureStreamer::~TextureStreamer() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+			for (const Ref<Stream>& stream : mQueue)
+				stream->cancelled = true;
+		}
+		mQueueChanged.notify_all();
+		for (std::thread& loader : mLoaders)
+			loader.join();
+
+		for (const Ref<Stream>& stream : mStreams)
+			stream->texture.reset();
+	}
+
+	Ref<Texture2D> TextureStreamer::request(const std::string& path, uint32_t slot) {
+		Ref<Stream> stream = CreateRef<Stream>();
+		stream->path = path;
+
+		if (stream->container.open(path)) {
+			const MipContainer& container = stream->container;
+			uint32_t levelCount = container.getLevelCount();
+			stream->width = container.getWidth();
+			stream->height = container.getHeight();
+			stream->channels = container.getChannels();
+			stream->texture = CreateRef<Texture2D>(path.c_str(), stream->width, stream->height, stream->channels, levelCount, container.isSRGB(), slot);
+
+			uint32_t tail = levelCount - 1;
+			while (tail > 0 && std::max(container.getLevel(tail - 1).width, container.getLevel(tail - 1).height) <= kTailSize)
+				tail--;
+			for (uint32_t level = levelCount; level-- > tail;) {
+				const MipContainer::Level& data = container.getLevel(level);
+				stream->texture->uploadRows(level, 0, data.height, data.pixels);
+				mStats.uploadedBytes += data.size;
+			}
+			stream->texture->setBaseLevel(tail);
+
+			mStats.requested++;
+			if (tail == 0) {
+				mStats.completed++;
+				return stream->texture;
+			}
+			stream->nextLevel = tail - 1;
+			stream->readyLevel = tail;
+		}
+		else {
+			int width, height, sourceChannels;
+			if (!stbi_info(path.c_str(), &width, &height, &sourceChannels)) {
+				mStats.requested++;
+				mStats.failed++;
+				return CreateRef<Texture2D>(path.c_str(), slot);
+			}
+			// same expansion as decodeMipSource(), the storage has to match what the loader produces
+			stream->width = width;
+			stream->height = height;
+			stream->channels = (sourceChannels == 2 || sourceChannels == 4) ? 4 : 3;
+			uint32_t levelCount = getMipLevelCount(width, height);
+			stream->texture = CreateRef<Texture2D>(path.c_str(), stream->width, stream->height, stream->channels, levelCount, false, slot);
+
+			// mid grey until the decode lands, it is replaced like any other level
+			const uint8_t placeholder[4] = { 128, 128, 128, 255 };
+			stream->texture->uploadRows(levelCount - 1, 0, 1, placeholder);
+
+			mStats.requested++;
+			stream->nextLevel = levelCount - 1;
+			stream->readyLevel = levelCount;
+		}
+
+		// own threads rather than jobs: nothing ever waits on these, and without waiters the job
+		// system only runs work on its workers, of which a single core machine has none
+		while (mLoaders.size() < mLoaderCount)
+			mLoaders.emplace_back(&TextureStreamer::loaderLoop, this);
+
+		mStreams.push_back(stream);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQueue.push_back(stream);
+		}
+		mQueueChanged.notify_one();
+		return stream->texture;
+	}
+
+	void TextureStreamer::load(Stream& stream) {
+		if (stream.container.getLevelCount() > 0) {
+			// fault the pages in here so the upload on the GL thread never waits on the disk
+			for (uint32_t level = stream.readyLevel; level-- > 0;) {
+				if (stream.cancelled)
+					return;
+				const MipContainer::Level& data = stream.container.getLevel(level);
+				uint8_t sum = 0;
+				for (size_t offset = 0; offset < data.size; offset += kPageSize)
+					sum ^= data.pixels[offset];
+				volatile uint8_t sink = sum;
+				(void)sink;
+				stream.readyLevel.store(level, std::memory_order_release);
+			}
+			return;
+		}
+
+		std::vector<uint8_t> pixels;
+		uint32_t width, height, channels;
+		if (!decodeMipSource(stream.path, pixels, width, height, channels) ||
+			width != stream.width || height != stream.height || channels != stream.channels) {
+			stream.failed.store(true, std::memory_order_release);
+			return;
+		}
+		buildMipChain(std::move(pixels), width, height, channels, false, stream.decoded);
+		stream.readyLevel.store(0, std::memory_order_release);
+	}
+
+	uint64_t TextureStreamer::upload(uint64_t budget) {
+		uint64_t uploaded = 0;
+		for (;;) {
+			// the smallest pending level of all streams first, so every texture sharpens at the same pace
+			Stream* next = nullptr;
+			uint64_t nextSize = 0;
+			for (const Ref<Stream>& stream : mStreams) {
+				if (stream->complete || stream->failed.load(std::memory_order_acquire) ||
+					stream->nextLevel < stream->readyLevel.load(std::memory_order_acquire))
+					continue;
+				uint64_t size = static_cast<uint64_t>(std::max(1u, stream->width >> stream->nextLevel)) *
+					std::max(1u, stream->height >> stream->nextLevel) * stream->channels;
+				if (!next || size < nextSize) {
+					next = stream.get();
+					nextSize = size;
+				}
+			}
+			if (!next)
+				break;
+
+			uint32_t level = next->nextLevel;
+			uint32_t levelHeight = std::max(1u, next->height >> level);
+			uint64_t rowBytes = static_cast<uint64_t>(std::max(1u, next->width >> level)) * next->channels;
+			uint64_t rows = levelHeight - next->nextRow;
+			if (budget > 0) {
+				rows = std::min(rows, (budget - std::min(budget, uploaded)) / rowBytes);
+				// a row a frame at least, however wide
+				if (rows == 0 && uploaded > 0)
+					break;
+				rows = std::max<uint64_t>(rows, 1);
+			}
+
+			const uint8_t* pixels = next->decoded.empty() ? next->container.getLevel(level).pixels : next->decoded[level].data();
+			next->texture->uploadRows(level, next->nextRow, static_cast<uint32_t>(rows), pixels + next->nextRow * rowBytes);
+			uploaded += rows * rowBytes;
+			next->nextRow += static_cast<uint32_t>(rows);
+
+			if (next->nextRow == levelHeight) {
+				next->texture->setBaseLevel(level);
+				if (!next->decoded.empty())
+					std::vector<uint8_t>().swap(next->decoded[level]);
+				next->nextRow = 0;
+				if (level == 0) {
+					next->complete = true;
+					mStats.completed++;
+				}
+				else {
+					next->nextLevel--;
+				}
+			}
+			if (budget > 0 && uploaded >= budget)
+				break;
+		}
+		mStats.uploadedBytes += uploaded;
+		return uploaded;
+	}
+
+	void TextureStreamer::retire() {
+		auto finished = [this](const Ref<Stream>& stream) {
+			bool failed = stream->failed.load(std::memory_order_acquire);
+			// the streamer holds the last reference, nobody is going to sample it
+			bool abandoned = stream->texture.use_count() == 1;
+			if (!stream->complete && !failed && !abandoned)
+				return false;
+
+			if (failed)
+				mStats.failed++;
+			else if (!stream->complete)
+				mStats.cancelled++;
+			stream->cancelled = true;
+			// GL objects die on this thread, a loader may still hold the stream
+			stream->texture.reset();
+			return true;
+		};
+		mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(), finished), mStreams.end());
+	}
+
+	void TextureStreamer::update() {
+		mStats.lastFrameBytes = upload(mFrameBudget);
+		retire();
+	}
+
+	void TextureStreamer::finish() {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueueChanged.wait(lock, [this] { return mQueue.empty() && mBusy == 0; });
+		}
+		upload(0);
+		retire();
+	}
+
+	void TextureStreamer::loaderLoop() {
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;) {
+			mQueueChanged.wait(lock, [this] { return mStop || !mQueue.empty(); });
+			if (mStop)
+				return;
+
+			Ref<Stream> stream = std::move(mQueue.front());
+			mQueue.pop_front();
+			mBusy++;
+			lock.unlock();
+
+			load(*stream);
+			stream.reset();
+
+			lock.lock();
+			mBusy--;
+			mQueueChanged.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include "Base.h"
+#include "Texture2D.h"
+#include "MipContainer.h"
+
+namespace Gizmo {
+
+	// Textures that are usable the frame they are requested and sharpen over the next ones.
+	// request() allocates immutable storage for the whole chain but only fills the tail: the small
+	// levels of a mip container, or a grey texel for an image that still has to be decoded. Loader
+	// threads then fault in the container pages (or decode and filter the image) and update() uploads
+	// the ready levels, smallest first, a band of rows at a time within a per-frame byte budget.
+	// GL_TEXTURE_BASE_LEVEL only drops to a level once it is complete, so sampling never reads
+	// undefined texels. Everything except the loaders runs on the GL thread.
+	class TextureStreamer {
+	public:
+		struct Stats {
+			uint32_t requested = 0;
+			uint32_t completed = 0;     // down to level 0
+			uint32_t failed = 0;        // kept whatever was resident
+			uint32_t cancelled = 0;     // dropped by everyone before they completed
+			uint64_t uploadedBytes = 0;
+			uint64_t lastFrameBytes = 0;
+		};
+
+		// <frameBudgetBytes> uploaded per update(), 0 = unlimited
+		TextureStreamer(uint64_t frameBudgetBytes = 4 << 20, uint32_t loaderCount = 2);
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// <path> is a mip container or an image stb_image decodes; a file that cannot even be
+		// inspected is loaded the blocking way so the error is reported where it always was
+		Ref<Texture2D> request(const std::string& path, uint32_t slot = 0);
+
+		// uploads ready levels within the budget; call once per frame
+		void update();
+		// waits for the loaders and uploads everything left, for benchmarks and captures
+		void finish();
+
+		void setFrameBudget(uint64_t bytes) { mFrameBudget = bytes; }
+		uint64_t getFrameBudget() const { return mFrameBudget; }
+
+		uint32_t getStreamingCount() const { return static_cast<uint32_t>(mStreams.size()); }
+		const Stats& getStats() const { return mStats; }
+
+	private:
+		struct Stream {
+			std::string path;
+			Ref<Texture2D> texture;     // reset on the GL thread before the stream is dropped
+			MipContainer container;     // mapped, when the file is one
+			std::vector<std::vector<uint8_t>> decoded; // filled by the loader otherwise
+			uint32_t width = 0, height = 0, channels = 0;
+			uint32_t nextLevel = 0;     // next level to upload, counting down to 0
+			uint32_t nextRow = 0;
+			bool complete = false;
+			std::atomic<uint32_t> readyLevel{ 0 }; // levels >= this can be uploaded
+			std::atomic<bool> failed{ false };
+			std::atomic<bool> cancelled{ false };
+		};
+
+		void load(Stream& stream);
+		uint64_t upload(uint64_t budget);
+		void retire();
+		void loaderLoop();
+
+		std::vector<Ref<Stream>> mStreams;
+		uint64_t mFrameBudget;
+		Stats mStats;
+
+		std::vector<std::thread> mLoaders; // started by the first request
+		uint32_t mLoaderCount;
+		std::mutex mMutex;
+		std::condition_variable mQueueChanged;
+		std::deque<Ref<Stream>> mQueue;
+		uint32_t mBusy = 0;
+		bool mStop = false;
+	};
+
+}
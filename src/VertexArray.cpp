@@ -1,9 +1,11 @@
 #include "VertexArray.h"
 #include <GL/glew.h>
 
+#include "OpenGLUtil.h"
+
 namespace Gizmo{
 
-	VertexArray::VertexArray() : m_vertexBufferIndex(0) {
+	VertexArray::VertexArray() : m_vertexBufferIndex(0), m_tracking(ResourceCategory::VertexArray, 0, "vertex array") {
 		glCreateVertexArrays(1, &m_vertexArrayID);
 	};
 
@@ -11,6 +13,11 @@ namespace Gizmo{
 		glDeleteVertexArrays(1, &m_vertexArrayID);
 	};
 
+	void VertexArray::SetName(const std::string& name) {
+		m_tracking.rename(name);
+		glLabelObject(GL_VERTEX_ARRAY, m_vertexArrayID, name.c_str());
+	};
+
 	void VertexArray::Bind() const {
 		glBindVertexArray(m_vertexArrayID); 
 	};
@@ -19,7 +26,7 @@ namespace Gizmo{
 		glBindVertexArray(0);
 	};
 
-	void VertexArray::AddVertexBuffer(const Ref<VertexBuffer>& vertexBuffer) {
+	void VertexArray::AddVertexBuffer(const Ref<VertexBuffer>& vertexBuffer, uint32_t divisor, size_t offset) {
 		glBindVertexArray(m_vertexArrayID);
 		vertexBuffer->Bind();
 
@@ -29,8 +36,6 @@ namespace Gizmo{
 			switch (attrib.type)
 			{
 			case ShaderDataType::Float:
-				assertm(false, "Not implemented");
-				break;
 			case ShaderDataType::Float2:
 				glEnableVertexAttribArray(m_vertexBufferIndex);
 				glVertexAttribPointer(m_vertexBufferIndex,
@@ -38,7 +43,8 @@ namespace Gizmo{
 					ShaderDataTypeToGLType(attrib.type),
 					attrib.normalized ? GL_TRUE : GL_FALSE,
 					layout.GetStride(),
-					(const void*)attrib.offset);
+					(const void*)(offset + attrib.offset));
+				glVertexAttribDivisor(m_vertexBufferIndex, divisor);
 				m_vertexBufferIndex++;
 				break;
 			case ShaderDataType::Float3: {
@@ -48,7 +54,8 @@ namespace Gizmo{
 					ShaderDataTypeToGLType(attrib.type),
 					attrib.normalized ? GL_TRUE : GL_FALSE,
 					layout.GetStride(),
-					(const void*)attrib.offset);
+					(const void*)(offset + attrib.offset));
+				glVertexAttribDivisor(m_vertexBufferIndex, divisor);
 				m_vertexBufferIndex++;
 				break;
 			}
@@ -59,7 +66,8 @@ namespace Gizmo{
 					ShaderDataTypeToGLType(attrib.type),
 					attrib.normalized ? GL_TRUE : GL_FALSE,
 					layout.GetStride(),
-					(const void*)attrib.offset);
+					(const void*)(offset + attrib.offset));
+				glVertexAttribDivisor(m_vertexBufferIndex, divisor);
 				m_vertexBufferIndex++;
 				break;
 			}
@@ -6,6 +6,7 @@
 #include <vector>
 #include "Base.h"
 #include "Buffer.h"
+#include "ResourceRegistry.h"
 
 namespace Gizmo{
 	class VertexArray {
@@ -16,17 +17,21 @@ namespace Gizmo{
 		void Bind() const;
 		void Unbind() const;
 
-		void AddVertexBuffer(const Ref<VertexBuffer>& vertexBuffer);
+		// <divisor> 1 advances the attributes per instance; <offset> in bytes, to draw a range of a shared buffer
+		void AddVertexBuffer(const Ref<VertexBuffer>& vertexBuffer, uint32_t divisor = 0, size_t offset = 0);
 		void SetIndexBuffer(const Ref<IndexBuffer>& indexBuffer);
 
 		const std::vector<Ref<VertexBuffer>>& GetVertexBuffers() const { return m_vertexBuffers; }
 		const Ref<IndexBuffer>& GetIndexBuffer() const { return m_indexBuffer; }
 
+		void SetName(const std::string& name);
+
 	private:
 		uint32_t m_vertexArrayID;
 		uint32_t m_vertexBufferIndex; 
 		std::vector<Ref<VertexBuffer>> m_vertexBuffers; 
 		Ref<IndexBuffer> m_indexBuffer;
+		TrackedResource m_tracking;
 
 	};
 }
\ No newline at end of file
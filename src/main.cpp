@@ -1,5 +1,11 @@
 ﻿#include <iostream>
 #include <map>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -9,7 +15,6 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/quaternion.hpp>
 
 
@@ -17,217 +22,245 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
-#define GIZMOS_DEBUG
-
 #include "shaderprogram.h"
 #include "VertexArray.h"
 #include "Base.h"
-#include "openglUtil.h"
+#include "OpenGLUtil.h"
 #include "Gizmo.h"
 #include "Input.h"
 #include "Mesh.h"
+#include "GLContext.h"
+#include "Framebuffer.h"
+#include "Image.h"
+#include "Benchmark.h"
+#include "FrameCapture.h"
+#include "PickingPass.h"
+#include "MeshBVH.h"
+#include "CpuSkinning.h"
+#include "SkinningPass.h"
+#include "GpuTimer.h"
+#include "Animation.h"
+#include "AnimationCompression.h"
+#include "Crowd.h"
+#include "AnimationBaker.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "StreamingBuffer.h"
+#include "ResourceRegistry.h"
 
 #include <stb_image.h>
 
 #include "Texture2D.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "MaterialTextures.h"
+#include "MipContainer.h"
+#include "ModelLoader.h"
 
 #define PI 3.14159f
 
 uint16_t gWindowWidth = 1200, gWindowHeight = 800;
 
-glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from) {
-    glm::mat4 to(1.0f);
+struct AppOptions {
+    Gizmo::ContextBackend backend = Gizmo::ContextBackend::Window;
+    uint32_t frames = 0;        // headless: number of frames to render before exiting
+    std::string dumpPath;       // headless: write the last frame as PNG
+    std::string goldenPath;     // headless: compare the last frame against a reference image
+    double tolerance = 1.0;     // headless: max mean channel error accepted by the golden comparison
+    std::string capturePrefix;  // capture every frame asynchronously to <prefix>_NNNNN.png
+    std::string benchFilter;    // run the registered benchmarks matching the filter and exit
+    bool bench = false;
+    uint32_t crowd = 0;         // draw this many extra animated instances of the character
+    uint32_t baked = 0;         // and this many background instances played from a baked palette texture
+    bool pipelined = false;     // simulate on an update thread, one frame ahead of the render thread
+    bool lateLatch = true;      // sample the cursor for the gizmo after the pose-independent draws
+    uint64_t gpuBudget = 0;     // warn when the registered GPU resources exceed this many bytes, 0 = no budget
+    uint64_t cpuBudget = 0;     // same for CPU side copies
+    uint64_t textureBudget = 0; // evict textures not bound this frame above this many bytes, 0 = keep everything
+    uint64_t streamBudget = 0;  // stream textures in, uploading at most this many bytes a frame, 0 = load them whole
+    std::string bakeSource;     // convert this image to a mip container and exit
+    std::string bakeOutput;
+    bool bakeSRGB = false;
+};
 
-    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
-    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
-    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
-    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+// a decimal count, scaled by 2^<shift>; false when <text> is not entirely a number or does not fit
+template<typename T>
+bool ParseUnsigned(const char* text, T& value, unsigned shift = 0) {
+    if (!std::isdigit(static_cast<unsigned char>(text[0])))
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > (std::numeric_limits<T>::max() >> shift))
+        return false;
+    value = static_cast<T>(parsed << shift);
+    return true;
+}
 
-    return to;
+bool ParseNumber(const char* text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE)
+        return false;
+    value = parsed;
+    return true;
 }
 
-struct Transform {
-    glm::vec3 position; 
-    glm::quat rotation; 
-    glm::vec3 scale; 
+bool ParseOptions(int argc, char** argv, AppOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        bool valid = true;
+
+        if (arg == "--backend" && hasValue) {
+            if (!Gizmo::GLContext::ParseBackend(argv[++i], options.backend)) {
+                std::cerr << "Unknown backend " << argv[i] << " (window, egl, osmesa)" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--headless") options.backend = Gizmo::ContextBackend::EGLSurfaceless;
+        else if (arg == "--frames" && hasValue) valid = ParseUnsigned(argv[++i], options.frames);
+        else if (arg == "--dump" && hasValue) options.dumpPath = argv[++i];
+        else if (arg == "--golden" && hasValue) options.goldenPath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) valid = ParseNumber(argv[++i], options.tolerance);
+        else if (arg == "--capture" && hasValue) options.capturePrefix = argv[++i];
+        else if (arg == "--crowd" && hasValue) valid = ParseUnsigned(argv[++i], options.crowd);
+        else if (arg == "--baked" && hasValue) valid = ParseUnsigned(argv[++i], options.baked);
+        else if (arg == "--pipelined") options.pipelined = true;
+        else if (arg == "--no-late-latch") options.lateLatch = false;
+        else if (arg == "--gpu-budget" && hasValue) valid = ParseUnsigned(argv[++i], options.gpuBudget, 20);
+        else if (arg == "--cpu-budget" && hasValue) valid = ParseUnsigned(argv[++i], options.cpuBudget, 20);
+        else if (arg == "--texture-budget" && hasValue) valid = ParseUnsigned(argv[++i], options.textureBudget, 20);
+        else if (arg == "--stream-textures" && hasValue) valid = ParseUnsigned(argv[++i], options.streamBudget, 10);
+        else if (arg == "--bake-mips" && i + 2 < argc) {
+            options.bakeSource = argv[++i];
+            options.bakeOutput = argv[++i];
+        }
+        else if (arg == "--srgb") options.bakeSRGB = true;
+        else if (arg == "--bench") {
+            options.bench = true;
+            if (hasValue && argv[i + 1][0] != '-')
+                options.benchFilter = argv[++i];
+        }
+        else {
+            valid = false;
+        }
 
-    glm::mat4 GetTransMat() const{
-        return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+        if (!valid) {
+            if (arg != argv[i])
+                std::cerr << "Invalid value " << argv[i] << " for " << arg << std::endl;
+            std::cerr << "Usage: Gizmos [--backend window|egl|osmesa] [--headless] [--frames N] [--dump out.png] [--golden ref.png] [--tolerance t] [--capture prefix] [--crowd N] [--baked N] [--pipelined] [--no-late-latch] [--gpu-budget MB] [--cpu-budget MB] [--texture-budget MB] [--stream-textures KB] [--bake-mips in.png out.gmip [--srgb]] [--bench filter]" << std::endl;
+            return false;
+        }
     }
-};
 
-Transform DecomposeMatrix(const glm::mat4& mat) {
-    glm::vec3 skew;
-    glm::vec4 perspective;
-    glm::vec3 translation;
-    glm::vec3 scale;
-    glm::quat rotation;
-    glm::decompose(mat, scale, rotation, translation, skew, perspective);
-    Transform trans = {};
-    trans.position = translation;
-    trans.rotation = rotation;
-    trans.scale = scale;
-
-    return trans;
+    if (options.backend != Gizmo::ContextBackend::Window && options.frames == 0)
+        options.frames = 60;
+    return true;
 }
 
 Gizmo::Ref<Gizmo::Skeleton> gSkeleton; 
 std::vector<Gizmo::Ref<Gizmo::SkinnedMesh>> gMeshes; 
 std::vector<std::string> gMeshesNames; 
+std::vector<Gizmo::AnimationClip> gClips;
+std::vector<Gizmo::CompressedClip> gCompressedClips;
 
-void BuildNodeHierarchy(int32_t parent, const aiNode* node){
-
-    std::string nodeName(node->mName.C_Str());
-
-    glm::mat4 localTrans = aiMatrix4x4ToGlm(node->mTransformation);
-
-    int nodeIndex = gSkeleton->addNode(nodeName, parent, localTrans); 
-
-    for (int i = 0; i < node->mNumChildren; i++) {
-        BuildNodeHierarchy(nodeIndex, node->mChildren[i]);
-    }
+// <path> with a .gmip extension when that was baked with --bake-mips, it loads without a decode
+std::string PreferBakedTexture(const std::string& path) {
+    std::string baked = path.substr(0, path.find_last_of('.')) + ".gmip";
+    return std::ifstream(baked).good() ? baked : path;
 }
 
-void BuildHierarchy(const aiNode* node) {
-    gSkeleton = Gizmo::CreateRef<Gizmo::Skeleton>();
-    BuildNodeHierarchy(-1, node);
+// the globals hold GL objects, they have to go before the context does
+void ReleaseScene() {
+    gMeshes.clear();
+    gSkeleton.reset();
 }
 
-int boneCtr = 0; 
-
-void ProcessAiMesh(const aiMesh* mesh) {
-    std::vector<float> vertecies; 
-    std::vector<uint32_t> indecies; 
-    std::vector<Gizmo::Bone> bones; 
-
-    const int stride = 16;
-    const int boneIDOffset = 8, weightOffset = 12;
-
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        glm::vec3 normal = mesh->HasNormals() ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f);
-        glm::vec2 texCoords = mesh->HasTextureCoords(0) ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
-
-        vertecies.resize(vertecies.size() + stride);
-
-        const int vertIndex = i * stride; 
-        vertecies[vertIndex + 0] = mesh->mVertices[i].x;
-        vertecies[vertIndex + 1] = mesh->mVertices[i].y;
-        vertecies[vertIndex + 2] = mesh->mVertices[i].z;
-
-        vertecies[vertIndex + 3] = normal.x;
-        vertecies[vertIndex + 4] = normal.y;
-        vertecies[vertIndex + 5] = normal.z;
-
-        vertecies[vertIndex + 6] = texCoords.x;
-        vertecies[vertIndex + 7] = texCoords.y;
-
-        //Bone Id; 
-        vertecies[vertIndex + 8] = -1.0f;
-        vertecies[vertIndex + 9] = -1.0f;
-        vertecies[vertIndex + 10]= -1.0f;
-        vertecies[vertIndex + 11]= -1.0f;
-
-        //weights
-        vertecies[vertIndex + 12] = 0.0f;
-        vertecies[vertIndex + 13] = 0.0f;
-        vertecies[vertIndex + 14] = 0.0f;
-        vertecies[vertIndex + 15] = 0.0f;
-    }
-
-    //settting Indecies
-    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; ++j) {
-            indecies.push_back(face.mIndices[j]);
-        }
+void UploadBoneMatrices(ShaderProgram& shader, const Gizmo::Skeleton& skeleton) {
+    for (int j = 0; j < skeleton.getBoneCount() ; ++j) {
+        std::string name = "uBoneMatrices[" + std::to_string(j) + "]";
+        glUniformMatrix4fv(shader.u(name.c_str()), 1, GL_FALSE, glm::value_ptr(skeleton.getGlobalTransform(skeleton.getBone(j).mNodeIndex)* skeleton.getBone(j).mInvBindPose));
     }
+}
 
-    //Skinning
-    for (unsigned int i = 0; i < mesh->mNumBones; i++) {
-        aiBone* aibone = mesh->mBones[i];
-        std::string boneName(aibone->mName.C_Str());
-
-        uint32_t index = gSkeleton->getNodeIndex(boneName); 
-
-        uint32_t boneIndex = gSkeleton->addBone(boneName, index, aiMatrix4x4ToGlm(aibone->mOffsetMatrix)); 
-
-        for (unsigned int j = 0; j < aibone->mNumWeights; ++j) {
-            const int vertexID = aibone->mWeights[j].mVertexId;
-            const float weight = aibone->mWeights[j].mWeight;
-
-            const int base = vertexID * stride;
-
-            for (int k = 0; k < 4; ++k) {
-                const int boneSlot = base + boneIDOffset + k;
-                const int weightSlot = base + weightOffset + k;
-
-                if (vertecies[weightSlot] == 0.0f) {
-                    vertecies[boneSlot] = static_cast<float>(boneIndex);
-                    vertecies[weightSlot] = weight;
-                    break;
-                }
+// nodes before the first one a bone is attached to are the scene and armature roots, they get no box
+int FirstBoneNode(const Gizmo::Skeleton& skeleton) {
+    int first = skeleton.getNodeCount();
+    for (int i = 0; i < skeleton.getBoneCount(); i++)
+        first = std::min(first, static_cast<int>(skeleton.getBone(i).mNodeIndex));
+    return first;
+}
 
-            }
+void UploadBoneMatrices(ShaderProgram& shader) {
+    UploadBoneMatrices(shader, *gSkeleton);
+}
 
-        }
+// <measure> replays every clip raw and compressed to report the error, only worth it for --bench
+void CompressAnimations(bool measure) {
+    gCompressedClips.resize(gClips.size());
+    for (size_t i = 0; i < gClips.size(); i++) {
+        gCompressedClips[i].compress(gClips[i]);
+        if (!measure)
+            continue;
+        Gizmo::CompressionReport report = Gizmo::measureCompression(gClips[i], gCompressedClips[i], *gSkeleton);
+        printf("Compressed %s: %zu -> %zu bytes (%.1fx), %u -> %u keys, %u constant channels, max world error %.5f\n",
+            gClips[i].getName().c_str(), report.rawBytes, report.compressedBytes, report.ratio(),
+            report.keysIn, report.keysOut, report.constantChannels, report.maxWorldError);
     }
+}
 
-    Gizmo::SkinnedMesh myMesh(vertecies, { Gizmo::SubMesh(indecies, 0) }, Gizmo::BufferLayout({
-       Gizmo::BufferAttribute(Gizmo::ShaderDataType::Float3, false),
-       Gizmo::BufferAttribute(Gizmo::ShaderDataType::Float3, false),
-       Gizmo::BufferAttribute(Gizmo::ShaderDataType::Float2, false),
-       Gizmo::BufferAttribute(Gizmo::ShaderDataType::Float4, false),
-       Gizmo::BufferAttribute(Gizmo::ShaderDataType::Float4, false)
-        }), bones);
+// camera keys, one bit each in the order of kCameraKeys
+const int kCameraKeys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_R, GLFW_KEY_F, GLFW_KEY_U, GLFW_KEY_J, GLFW_KEY_H, GLFW_KEY_K };
 
-    gMeshes.push_back(Gizmo::CreateRef<Gizmo::SkinnedMesh>(myMesh));
+// GLFW input may only be read on the main thread, the update thread gets this snapshot
+uint32_t SampleCameraKeys()
+{
+    uint32_t keys = 0;
+    for (uint32_t i = 0; i < sizeof(kCameraKeys) / sizeof(kCameraKeys[0]); i++)
+        if (Input::IsKeyPressed(kCameraKeys[i]))
+            keys |= 1u << i;
+    return keys;
 }
 
-static void ProcessAiNode(aiNode* node, const aiScene* scene) {
-
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        gMeshesNames.push_back(std::string(node->mName.C_Str())); 
-        ProcessAiMesh(mesh);
-    }
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        ProcessAiNode(node->mChildren[i], scene);
-    }
+bool CameraKeyHeld(uint32_t keys, int key)
+{
+    for (uint32_t i = 0; i < sizeof(kCameraKeys) / sizeof(kCameraKeys[0]); i++)
+        if (kCameraKeys[i] == key)
+            return (keys >> i) & 1u;
+    return false;
 }
 
-void processInput(GLFWwindow* window, glm::vec3 *cameraPos, glm::vec3 *cameraFront, glm::vec3 *cameraUp, float *pitch, float *yaw)
+void processInput(uint32_t keys, glm::vec3 *cameraPos, glm::vec3 *cameraFront, glm::vec3 *cameraUp, float *pitch, float *yaw)
 {
         const float cameraSpeed = 0.05f; // adjust accordingly
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_W))
         *cameraPos += cameraSpeed * *cameraFront * 0.1f;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_S))
         *cameraPos -= cameraSpeed * *cameraFront * 0.1f;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_A))
         *cameraPos -= glm::normalize(glm::cross(*cameraFront, *cameraUp)) * cameraSpeed * 0.1f;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_D))
         *cameraPos += glm::normalize(glm::cross(*cameraFront, *cameraUp)) * cameraSpeed * 0.1f;
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_R))
         cameraPos->y += cameraSpeed*0.1f;
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_F))
         cameraPos->y -= cameraSpeed * 0.1f;
-    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_U))
     {
         *pitch += cameraSpeed * 2;
     }
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_J))
     {
         *pitch -= cameraSpeed * 2;
         
     }
-    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_H))
     {
         *yaw -= cameraSpeed * 2;
     }
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+    if (CameraKeyHeld(keys, GLFW_KEY_K))
     {
         *yaw += cameraSpeed * 2;
     }
@@ -239,60 +272,189 @@ void processInput(GLFWwindow* window, glm::vec3 *cameraPos, glm::vec3 *cameraFro
     *cameraFront = glm::normalize(direction);
 }
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return -1;
+// live totals per category, then every registered resource, largest first
+void DrawResourceTable() {
+    Gizmo::ResourceRegistry& registry = Gizmo::ResourceRegistry::get();
+    uint64_t gpuBudget = registry.getBudget(Gizmo::ResourceMemory::GPU);
+    ImGui::Text("resources: GPU %.2f MB%s, CPU %.2f MB", registry.getBytes(Gizmo::ResourceMemory::GPU) / 1048576.0,
+        registry.isOverBudget(Gizmo::ResourceMemory::GPU) ? " (over budget)" : "", registry.getBytes(Gizmo::ResourceMemory::CPU) / 1048576.0);
+    if (gpuBudget > 0) {
+        ImGui::SameLine();
+        ImGui::ProgressBar(static_cast<float>(registry.getBytes(Gizmo::ResourceMemory::GPU)) / gpuBudget, ImVec2(120.0f, 0.0f));
+    }
+    if (!ImGui::TreeNode("Resources"))
+        return;
+
+    if (ImGui::BeginTable("resource totals", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("category");
+        ImGui::TableSetupColumn("count");
+        ImGui::TableSetupColumn("KB");
+        ImGui::TableSetupColumn("peak KB");
+        ImGui::TableHeadersRow();
+        for (uint32_t c = 0; c < static_cast<uint32_t>(Gizmo::ResourceCategory::Count); c++) {
+            Gizmo::ResourceCategory category = static_cast<Gizmo::ResourceCategory>(c);
+            Gizmo::ResourceRegistry::CategoryTotals totals = registry.getTotals(category);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(Gizmo::getResourceCategoryName(category));
+            ImGui::TableNextColumn(); ImGui::Text("%u", totals.count);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", totals.bytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", totals.peakBytes / 1024.0);
+        }
+        ImGui::EndTable();
     }
 
-    GLFWwindow* window = glfwCreateWindow(gWindowWidth, gWindowHeight, "OpenGL-Gizmos", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+    if (ImGui::BeginTable("resource entries", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0.0f, 200.0f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("name");
+        ImGui::TableSetupColumn("category");
+        ImGui::TableSetupColumn("KB");
+        ImGui::TableHeadersRow();
+        for (const Gizmo::ResourceRegistry::Entry& entry : registry.getEntries()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(entry.name.c_str());
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(Gizmo::getResourceCategoryName(entry.category));
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", entry.bytes / 1024.0);
+        }
+        ImGui::EndTable();
     }
-    glfwMakeContextCurrent(window);
-    glClearColor(0.2f, 0.0f, 0.3f, 1.0f);
-    glfwSwapInterval(0); //V-sync
-   
-    if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
+    ImGui::TreePop();
+}
+
+// a bone dragged with the gizmo, drawn right away and applied by the simulation once
+struct BoneEdit {
+    uint64_t serial;
+    int node;
+    glm::mat4 local;
+};
+
+// what the render thread hands the simulation every frame
+struct FrameInput {
+    double time = 0.0; // when the input was sampled
+    uint32_t cameraKeys = 0;
+    bool playAnimation = false, playCompressed = false;
+    int clipIndex = 0, blendClipIndex = 0;
+    float animationSpeed = 1.0f, blendWeight = 0.0f;
+    std::vector<BoneEdit> edits; // every edit the last packet did not acknowledge yet
+};
+
+// one simulated frame, immutable once published
+struct FramePacket {
+    double inputTime = 0.0;
+    glm::mat4 view, projection;
+    Gizmo::LocalPose pose;
+    std::vector<glm::mat4> crowdPalettes;
+    uint64_t appliedEdit = 0;
+    double updateMs = 0.0, crowdUpdateMs = 0.0;
+};
+
+int main(int argc, char** argv) {
+    AppOptions options;
+    if (!ParseOptions(argc, argv, options))
         return -1;
+
+    // offline conversion, needs no context
+    if (!options.bakeSource.empty()) {
+        Gizmo::Timer bakeTimer;
+        if (!Gizmo::bakeMipContainer(options.bakeSource, options.bakeOutput, options.bakeSRGB))
+            return 1;
+        std::cout << "Baked " << options.bakeSource << " -> " << options.bakeOutput << " in " << bakeTimer.elapsedMs() << " ms" << std::endl;
+        return 0;
     }
 
+    Gizmo::Scope<Gizmo::GLContext> context = Gizmo::GLContext::Create(options.backend, gWindowWidth, gWindowHeight, "OpenGL-Gizmos");
+    if (!context)
+        return -1;
+
+    // destroyed after everything declared below, reports what is still alive at that point
+    Gizmo::ResourceRegistry::LeakCheck leakCheck;
+    Gizmo::ResourceRegistry::get().setBudget(Gizmo::ResourceMemory::GPU, options.gpuBudget);
+    Gizmo::ResourceRegistry::get().setBudget(Gizmo::ResourceMemory::CPU, options.cpuBudget);
+
+    GLFWwindow* window = context->getWindow();
+    glClearColor(0.2f, 0.0f, 0.3f, 1.0f);
+    context->setVSync(false); //V-sync
+
     const GLubyte* version = glGetString(GL_VERSION);
     std::cout << "OpenGL Version: " << version << std::endl;
 
+    glInitDebugOutput(GLDebugSeverity::Low);
+
+    // headless contexts have no window for the ImGui backend
+    bool useImGui = window != nullptr;
+
 #ifdef GIZMOS_DEBUG
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO();
-    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    if (useImGui) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330");
+    }
+#endif // GIZMOS_DEBUG
 
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
+    // every exit from here on: ImGui and the scene's GL objects go before the context
+    auto shutdown = [&](int exitCode) {
+#ifdef GIZMOS_DEBUG
+        if (useImGui) {
+            ImGui_ImplOpenGL3_Shutdown();
+            ImGui_ImplGlfw_Shutdown();
+            ImGui::DestroyContext();
+        }
 #endif // GIZMOS_DEBUG
+        ReleaseScene();
+        return exitCode;
+    };
 
     gizmo::init();
     Input::Init(window); 
 
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile("assets/model/StormTrooper.fbx", //C:/Users/ACER/Desktop/Nowy folder/hero.fbx "C:/Users/ACER/Desktop/stormtrooper/source/StormTrooper.fbx"
-        aiProcess_GlobalScale |
-        aiProcess_Triangulate |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_GenSmoothNormals |
-        aiProcess_CalcTangentSpace |
-        aiProcess_LimitBoneWeights |
-        aiProcess_ImproveCacheLocality);
-
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-        return 0;
-    }
+    // Assimp runs on the loader thread, the window keeps drawing a progress bar meanwhile
+    Gizmo::ModelLoader modelLoader;
+    Gizmo::Ref<Gizmo::ModelLoader::Load> characterLoad = modelLoader.load("assets/model/StormTrooper.fbx"); //C:/Users/ACER/Desktop/Nowy folder/hero.fbx "C:/Users/ACER/Desktop/stormtrooper/source/StormTrooper.fbx"
+    if (!useImGui)
+        modelLoader.finish(characterLoad);
+    while (!characterLoad->isFinished()) {
+        if (context->shouldClose())
+            characterLoad->cancel();
+        modelLoader.update();
 
-    BuildHierarchy(scene->mRootNode); 
-    ProcessAiNode(scene->mRootNode, scene); 
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#ifdef GIZMOS_DEBUG
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGui::Begin("Loading");
+        ImGui::Text("%s", characterLoad->getPath().c_str());
+        ImGui::ProgressBar(characterLoad->getProgress(), ImVec2(-1, 0), Gizmo::getLoadStateName(characterLoad->getState()));
+        ImGui::End();
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+#endif // GIZMOS_DEBUG
+        context->swapBuffers();
+        context->pollEvents();
+    }
+    if (characterLoad->getState() == Gizmo::LoadState::Failed) {
+        std::cerr << "Failed to load " << characterLoad->getPath() << ": " << characterLoad->getError() << std::endl;
+        return shutdown(1);
+    }
+    if (characterLoad->getState() != Gizmo::LoadState::Done)
+        return shutdown(0);
+
+    Gizmo::Model& character = characterLoad->getModel();
+    gSkeleton = character.skeleton;
+    const int firstBoneNode = FirstBoneNode(*gSkeleton);
+    gMeshes = std::move(character.meshes);
+    gMeshesNames = std::move(character.meshNames);
+    gClips = std::move(character.clips);
+    for (const Gizmo::AnimationClip& clip : gClips)
+        std::cout << "Animation " << clip.getName() << ": " << clip.getTrackCount() << " tracks, " << clip.getKeyCount() << " keys, " << clip.getDuration() << " s" << std::endl;
+    CompressAnimations(options.bench);
+
+    if (options.bench) {
+        return shutdown(Gizmo::runBenchmarks(options.benchFilter) > 0 ? 0 : 1);
+    }
 
     std::vector<float> verticesbox = {
         //front face
@@ -323,20 +485,45 @@ int main() {
         });
 
     Gizmo::StaticMesh boxMesh(verticesbox, { Gizmo::SubMesh(indicesbox, 0) }, box_layout);
+    boxMesh.setName("box");
+    boxMesh.releaseCpuCopy();
 
     ShaderProgram defaultShader("shaders/v_default.glsl", "shaders/f_default.glsl");
     //ShaderProgram gridShader("shaders/v_grid.glsl", "shaders/f_grid.glsl");
     ShaderProgram textureShader("shaders/v_texture.glsl", "shaders/f_texture.glsl");
 
-    Texture2D wallTexture("assets/textures/wall.jpg", 0);
-    Texture2D stormTrooperBodyTexture( "assets/textures/diffuse_body.png", 0);
-    Texture2D stormTrooperHandTexture( "assets/textures/diffuse_hands.png", 0);
-    Texture2D stormTrooperHelmetTexture( "assets/textures/diffuse_helmets.png", 0);
-
-    std::unordered_map < std::string, Texture2D*> texturesMap; 
-    texturesMap["body"] = &stormTrooperBodyTexture; 
-    texturesMap["hand"] = &stormTrooperHandTexture;
-    texturesMap["helmet"] = &stormTrooperHelmetTexture;
+    // one texture per distinct file content, decoded on the job system and uploaded here where the context is current
+    Gizmo::TextureStreamer textureStreamer(options.streamBudget);
+    Gizmo::TextureManager textureManager(options.textureBudget);
+    if (options.streamBudget > 0)
+        textureManager.setStreamer(&textureStreamer);
+    std::vector<Gizmo::TextureHandle> textures = textureManager.load({ PreferBakedTexture("assets/textures/wall.jpg"), PreferBakedTexture("assets/textures/diffuse_body.png"),
+        PreferBakedTexture("assets/textures/diffuse_hands.png"), PreferBakedTexture("assets/textures/diffuse_helmets.png") });
+    // dumps are compared against goldens, so headless runs start with every level resident
+    if (context->isHeadless())
+        textureStreamer.finish();
+
+    // the materials share texture arrays by size, a mesh picks its layer instead of binding a texture
+    Gizmo::MaterialTextures materials({ textures[1], textures[2], textures[3] });
+    std::unordered_map<std::string, uint32_t> materialIndices = { { "body", 0 }, { "hand", 1 }, { "helmet", 2 } };
+    // meshes without a loaded texture draw with the white default layer
+    std::vector<Gizmo::MaterialTextures::Material> meshMaterials(gMeshes.size());
+    std::vector<std::vector<uint32_t>> meshesByArray(materials.getArrayCount());
+    for (uint32_t i = 0; i < gMeshes.size(); i++) {
+        auto material = materialIndices.find(gMeshesNames[i]);
+        if (material != materialIndices.end())
+            meshMaterials[i] = materials.getMaterial(material->second);
+        if (meshMaterials[i].array < 0)
+            meshMaterials[i] = materials.getDefaultMaterial();
+        meshesByArray[meshMaterials[i].array].push_back(i);
+    }
+    auto bindMaterial = [&](uint32_t mesh, ShaderProgram& shader, int32_t& boundArray) {
+        if (meshMaterials[mesh].array != boundArray) {
+            boundArray = meshMaterials[mesh].array;
+            materials.getArray(boundArray).Bind();
+        }
+        glUniform1f(shader.u("materialLayer"), meshMaterials[mesh].layer);
+    };
 
     glm::vec3 cameraPos = glm::vec3(-1.0f, 1.0f, 1.0f), objPos = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 lightPos = glm::vec3(0.5f, 1.0f, 1.0f), lighColor = glm::vec3(1.0, 0.0, 0.0);
@@ -351,21 +538,216 @@ int main() {
     model = glm::translate(glm::mat4(1.0f), objPos);
 
     float deltaTime = 0.0;
-    glfwSetTime(0.0f); 
 
     int index = 0; 
 
-    while (!glfwWindowShouldClose(window)) {
+    Gizmo::Scope<Gizmo::Framebuffer> offscreen;
+    if (context->isHeadless()) {
+        Gizmo::FramebufferSpec spec;
+        spec.width = gWindowWidth;
+        spec.height = gWindowHeight;
+        spec.attachments = { Gizmo::FramebufferFormat::RGBA8, Gizmo::FramebufferFormat::Depth24Stencil8 };
+        offscreen = Gizmo::CreateScope<Gizmo::Framebuffer>(spec);
+    }
+
+    Gizmo::FrameCapture frameCapture;
+    bool captureEveryFrame = !options.capturePrefix.empty();
+    bool captureOnce = false;
+    if (options.capturePrefix.empty())
+        options.capturePrefix = "capture";
+
+    // id pass for click selection, needs a cursor
+    Gizmo::Scope<Gizmo::PickingPass> pickingPass;
+    if (window) {
+        // sized in framebuffer pixels, the cursor is scaled to match before the readback
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        pickingPass = Gizmo::CreateScope<Gizmo::PickingPass>(framebufferWidth, framebufferHeight);
+    }
+    Gizmo::PickResult hovered;
+    bool mouseWasDown = false;
+
+    // CPU alternative to the id pass: ray cast against the mesh triangles, posed on the CPU and refitted per click
+    std::vector<Gizmo::MeshBVH> meshBVHs(gMeshes.size());
+    std::vector<Gizmo::SkinningSource> skinningSources(gMeshes.size());
+    for (size_t i = 0; i < gMeshes.size(); i++) {
+        meshBVHs[i].build(*gMeshes[i]);
+        skinningSources[i].build(*gMeshes[i]);
+    }
+    Gizmo::CpuSkinning cpuSkinning;
+    Gizmo::SkinnedPose skinnedPose;
+
+    // skin once per frame in a compute pre-pass, the mesh passes below then draw the posed buffers
+    // per-frame dynamic data (palettes, gizmo rings, crowd transforms) is sub-allocated from one mapped ring
+    Gizmo::StreamingBuffer streamingBuffer((1 << 20) + static_cast<GLsizeiptr>(options.crowd) * (gSkeleton->getBoneCount() + 1) * sizeof(glm::mat4));
+    gizmo::setStreamingBuffer(&streamingBuffer);
+    Gizmo::SkinningPass skinningPass(streamingBuffer);
+    for (uint32_t i = 0; i < gMeshes.size(); i++) {
+        skinningPass.addMesh(gMeshes[i]);
+        skinningPass.setMeshMaterial(i, meshMaterials[i].layer);
+    }
+    ShaderProgram posedShader("shaders/v_posed.glsl", "shaders/f_texture.glsl");
+    bool gpuSkinning = true;
+    Gizmo::GpuTimer skinningTimer, meshPassTimer, pickMeshTimer;
+
+    Gizmo::AnimationSampler animationSampler;
+    Gizmo::CompressedClipSampler compressedSampler;
+    Gizmo::AnimationSampler blendSampler;
+    Gizmo::LocalPose blendPose;
+    int clipIndex = 0, blendClipIndex = 0;
+    float blendWeight = 0.0f;
+    bool playAnimation = false, playCompressed = false;
+    float animationTime = 0.0f, animationSpeed = 1.0f;
+    double lastFrameTime = context->getTime();
+    if (!gClips.empty()) {
+        animationSampler.setClip(&gClips[0]);
+        compressedSampler.setClip(&gCompressedClips[0]);
+        blendSampler.setClip(&gClips[0]);
+    }
+    bool cpuPicking = false;
+    double cpuPickMs = 0.0;
+
+    // benchmark scene: a grid of instances sharing the imported skeleton, one instanced draw per mesh
+    Gizmo::Crowd crowd(gSkeleton->getDefinition());
+    ShaderProgram crowdShader("shaders/v_crowd.glsl", "shaders/f_texture.glsl");
+    Gizmo::GpuTimer crowdTimer;
+    double crowdUpdateMs = 0.0;
+    if (options.crowd > 0) {
+        for (size_t i = 0; i < gMeshes.size(); i++)
+            crowd.addMesh(gMeshes[i]);
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(options.crowd))));
+        for (uint32_t c = 0; c < options.crowd; c++) {
+            glm::vec3 position(((c % columns) - columns * 0.5f) * 0.8f, 0.0f, -1.5f - (c / columns) * 0.8f);
+            crowd.addInstance(glm::translate(glm::mat4(1.0f), position), gClips.empty() ? nullptr : &gClips[0], c * 0.137f);
+        }
+    }
+
+    // distant crowd without any per-instance CPU work, baked once from the first clip
+    Gizmo::Scope<Gizmo::BakedCrowd> bakedCrowd;
+    ShaderProgram bakedShader("shaders/v_baked.glsl", "shaders/f_texture.glsl");
+    Gizmo::GpuTimer bakedTimer;
+    if (options.baked > 0 && !gClips.empty()) {
+        Gizmo::Timer bakeTimer;
+        Gizmo::BakedAnimation baked = Gizmo::bakeAnimation(gClips[0], gSkeleton->getDefinition());
+        printf("Baked %s: %u frames at %.1f fps, %zu KB in %.2f ms\n", gClips[0].getName().c_str(), baked.frameCount, baked.frameRate,
+            baked.getMemorySize() / 1024, bakeTimer.elapsedMs());
+
+        bakedCrowd = Gizmo::CreateScope<Gizmo::BakedCrowd>(baked);
+        if (!bakedCrowd->isValid())
+            bakedCrowd.reset();
+    }
+    if (bakedCrowd) {
+        for (size_t i = 0; i < gMeshes.size(); i++)
+            bakedCrowd->addMesh(gMeshes[i]);
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(options.baked))));
+        for (uint32_t c = 0; c < options.baked; c++) {
+            glm::vec3 position(((c % columns) - columns * 0.5f) * 0.8f, 0.0f, -20.0f - (c / columns) * 0.8f);
+            bakedCrowd->addInstance(glm::translate(glm::mat4(1.0f), position), c * 0.137f, 0.9f + (c % 5) * 0.05f);
+        }
+        bakedCrowd->upload();
+    }
+    else if (options.baked > 0 && gClips.empty()) {
+        std::cerr << "--baked needs a model with animations" << std::endl;
+    }
+
+    // the simulation half of a frame: owns the camera, the samplers, the crowd poses and its own copy
+    // of the character, gSkeleton is what the render thread draws from the newest packet
+    Gizmo::Skeleton simSkeleton = *gSkeleton;
+    int simClipIndex = 0, simBlendClipIndex = 0;
+    uint64_t appliedEdit = 0;
+    auto updateFrame = [&](const FrameInput& input, FramePacket& packet) {
+        Gizmo::Timer updateTimer;
+        processInput(input.cameraKeys, &cameraPos, &cameraFront, &cameraUp, &pitch, &yaw);
+        packet.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        packet.projection = glm::perspective(glm::radians(80.0f), static_cast<float>(gWindowWidth) / static_cast<float>(gWindowHeight), 0.1f, 300.0f);
+
+        if (!gClips.empty() && input.clipIndex != simClipIndex) {
+            simClipIndex = input.clipIndex;
+            animationSampler.setClip(&gClips[simClipIndex]);
+            compressedSampler.setClip(&gCompressedClips[simClipIndex]);
+        }
+        if (!gClips.empty() && input.blendClipIndex != simBlendClipIndex) {
+            simBlendClipIndex = input.blendClipIndex;
+            blendSampler.setClip(&gClips[simBlendClipIndex]);
+        }
+
+        if (input.playAnimation && animationSampler.getClip()) {
+            animationTime += static_cast<float>(input.time - lastFrameTime) * input.animationSpeed;
+            if (input.playCompressed)
+                compressedSampler.sample(animationTime, simSkeleton);
+            else
+                animationSampler.sample(animationTime, simSkeleton);
+
+            if (input.blendWeight > 0.0f) {
+                blendPose = simSkeleton.getLocalPose();
+                blendSampler.sample(animationTime, blendPose);
+                Gizmo::blendPoses(simSkeleton.getLocalPose(), blendPose, input.blendWeight, simSkeleton.getLocalPose());
+            }
+        }
+        lastFrameTime = input.time;
+
+        for (const BoneEdit& edit : input.edits) {
+            if (edit.serial > appliedEdit) {
+                simSkeleton.setNodeLocalTrans(edit.node, edit.local);
+                appliedEdit = edit.serial;
+            }
+        }
+        packet.pose = simSkeleton.getLocalPose();
+        packet.appliedEdit = appliedEdit;
+
+        if (crowd.getInstanceCount() > 0) {
+            Gizmo::Timer crowdCpuTimer;
+            crowd.update(static_cast<float>(input.time), packet.crowdPalettes); // the crowd keeps walking whatever the main character does
+            packet.crowdUpdateMs = crowdCpuTimer.elapsedMs();
+        }
+
+        packet.inputTime = input.time;
+        packet.updateMs = updateTimer.elapsedMs();
+    };
+    Gizmo::FramePipeline<FrameInput, FramePacket> pipeline(updateFrame, options.pipelined);
+    std::vector<BoneEdit> pendingEdits;
+    uint64_t editSerial = 0;
+    double updateMs = 0.0;
+
+    Gizmo::BenchmarkResult frameStats;
+    frameStats.name = "frame";
+    frameStats.minMs = 1e30;
+    // from sampling the input to the swap that shows the frame built from it
+    Gizmo::BenchmarkResult latencyStats;
+    latencyStats.name = "input to swap";
+    latencyStats.minMs = 1e30;
+    // from reading the cursor for the gizmo to the swap that shows the rotated bone
+    Gizmo::BenchmarkResult cursorStats;
+    cursorStats.name = "cursor to swap";
+    cursorStats.minMs = 1e30;
+    bool lateLatch = options.lateLatch;
+
+    // models imported from the debug window, they stand in their bind pose in a row beside the character
+    std::vector<Gizmo::Ref<Gizmo::ModelLoader::Load>> imports;
+    char importPath[256] = "assets/model/StormTrooper.fbx";
+
+    uint32_t frame = 0;
+    while (!context->shouldClose() && (!context->isHeadless() || frame < options.frames)) {
+        Gizmo::Timer frameTimer;
+
+        textureStreamer.update();
+        materials.update();
+        modelLoader.update();
+
+        if (offscreen)
+            offscreen->Bind();
 
         glClearColor(35.0f/255.0f, 35.0f / 255.0f, 35.0f / 255.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
 
 #ifdef GIZMOS_DEBUG
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        ImGui::Begin("Debug Window");
+        if (useImGui) {
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            ImGui::Begin("Debug Window");
+        }
        /* ImGui::SliderFloat("x", &cameraPos[0], -10.0f, 10.0f);
         ImGui::SliderFloat("y", &cameraPos[1], -10.0f, 10.0f);
         ImGui::SliderFloat("z", &cameraPos[2], -10.0f, 10.0f);
@@ -374,65 +756,241 @@ int main() {
         ImGui::SliderFloat3("up", glm::value_ptr(cameraUp), -1.0f, 1.0f);*/
 #endif // GIZMOS_DEBUG
 
-        processInput(window, &cameraPos, &cameraFront, &cameraUp, &pitch, &yaw);
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos+cameraFront, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(80.0f), static_cast<float>(gWindowWidth) / static_cast<float>(gWindowHeight), 0.1f, 300.0f);
-
+        double now = context->getTime();
+        FrameInput& input = pipeline.getInput();
+        input.time = now;
+        input.cameraKeys = SampleCameraKeys();
+        input.playAnimation = playAnimation;
+        input.playCompressed = playCompressed;
+        input.clipIndex = clipIndex;
+        input.blendClipIndex = blendClipIndex;
+        input.animationSpeed = animationSpeed;
+        input.blendWeight = blendWeight;
+        input.edits = pendingEdits;
+        pipeline.submitInput();
+
+        // unthreaded this is the packet just built, pipelined the newest one the update thread finished
+        const FramePacket& packet = pipeline.acquirePacket();
+        glm::mat4 view = packet.view;
+        glm::mat4 projection = packet.projection;
+        updateMs = packet.updateMs;
+        crowdUpdateMs = packet.crowdUpdateMs;
+
+        // edits the packet does not reflect yet stay on top, a drag never lags behind the cursor
+        pendingEdits.erase(std::remove_if(pendingEdits.begin(), pendingEdits.end(),
+            [&](const BoneEdit& edit) { return edit.serial <= packet.appliedEdit; }), pendingEdits.end());
+        gSkeleton->getLocalPose() = packet.pose;
+        for (const BoneEdit& edit : pendingEdits)
+            gSkeleton->setNodeLocalTrans(edit.node, edit.local);
         gSkeleton->calculateGlobalTransforms();
         glm::mat4 temp = glm::mat4(1.0f);
 
+        // everything that does not depend on the character's pose, drawn ahead of the cursor sample when late latching
+        auto drawCrowds = [&]() {
+            if (crowd.getInstanceCount() > 0) {
+                crowdTimer.begin();
+                crowd.upload(packet.crowdPalettes, &streamingBuffer);
+                crowdShader.use();
+                crowd.bind(crowdShader);
+                glUniformMatrix4fv(crowdShader.u("V"), 1, GL_FALSE, glm::value_ptr(view));
+                glUniformMatrix4fv(crowdShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
+                glUniform3f(crowdShader.u("lightColor"), lighColor.x, lighColor.y, lighColor.z);
+                glUniform3f(crowdShader.u("lightPos"), lightPos.x, lightPos.y, lightPos.z);
+                glUniform3f(crowdShader.u("lightColor2"), lighColor2.x, lighColor2.y, lighColor2.z);
+                glUniform3f(crowdShader.u("lightPos2"), lightPos2.x, lightPos2.y, lightPos2.z);
+                glUniform1i(crowdShader.u("myTexture"), 0);
+                int32_t boundArray = -1;
+                for (uint32_t i = 0; i < crowd.getMeshCount(); i++) {
+                    bindMaterial(i, crowdShader, boundArray);
+                    crowd.drawMesh(i);
+                }
+                crowdTimer.end();
+            }
+
+            if (bakedCrowd) {
+                bakedTimer.begin();
+                bakedShader.use();
+                bakedCrowd->bind(bakedShader, static_cast<float>(now));
+                glUniformMatrix4fv(bakedShader.u("V"), 1, GL_FALSE, glm::value_ptr(view));
+                glUniformMatrix4fv(bakedShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
+                glUniform3f(bakedShader.u("lightColor"), lighColor.x, lighColor.y, lighColor.z);
+                glUniform3f(bakedShader.u("lightPos"), lightPos.x, lightPos.y, lightPos.z);
+                glUniform3f(bakedShader.u("lightColor2"), lighColor2.x, lighColor2.y, lighColor2.z);
+                glUniform3f(bakedShader.u("lightPos2"), lightPos2.x, lightPos2.y, lightPos2.z);
+                glUniform1i(bakedShader.u("myTexture"), 0);
+                int32_t boundArray = -1;
+                for (uint32_t i = 0; i < bakedCrowd->getMeshCount(); i++) {
+                    bindMaterial(i, bakedShader, boundArray);
+                    bakedCrowd->drawMesh(i);
+                }
+                bakedTimer.end();
+            }
+        };
+        if (lateLatch)
+            drawCrowds();
+
+        if (pickingPass && pickingPass->poll(hovered))
+            gizmo::setPickedAxis(hovered.object == Gizmo::PickGizmo ? static_cast<int>(hovered.subMesh) : 0);
+
+        bool uiWantsMouse = false;
+#ifdef GIZMOS_DEBUG
+        uiWantsMouse = useImGui && ImGui::GetIO().WantCaptureMouse;
+#endif // GIZMOS_DEBUG
+
+        // click on a bone box or on the character selects the bone, the gizmo keeps its own clicks
+        bool mouseDown = Input::IsMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT);
+        if (mouseDown && !mouseWasDown && !uiWantsMouse && cpuPicking) {
+            Gizmo::Timer pickTimer;
+            glm::vec4 rayOrigin, rayDir;
+            gizmo::ComputeCameraRay(rayOrigin, rayDir);
+
+            glm::mat4 invModel = glm::inverse(model);
+            Gizmo::Ray ray;
+            ray.origin = glm::vec3(invModel * glm::vec4(glm::vec3(rayOrigin), 1.0f));
+            ray.direction = glm::normalize(glm::vec3(invModel * glm::vec4(glm::vec3(rayDir), 0.0f)));
+
+            std::vector<glm::mat4> palette = gSkeleton->calculateSkinningMatrices();
+
+            Gizmo::RayHit closestHit;
+            int hitMesh = -1;
+            for (size_t i = 0; i < meshBVHs.size(); i++) {
+                // only meshes whose posed box the ray enters before the closest hit are skinned
+                float maxDistance = hitMesh < 0 ? 1e30f : closestHit.t;
+                glm::vec3 posedMin, posedMax;
+                if (skinningSources[i].getPosedBounds(palette, posedMin, posedMax) && !Gizmo::intersectBounds(ray, posedMin, posedMax, maxDistance))
+                    continue;
+                cpuSkinning.skin(skinningSources[i], palette, skinnedPose);
+                meshBVHs[i].refit(skinnedPose.positions);
+
+                Gizmo::RayHit hit;
+                if (meshBVHs[i].intersect(ray, hit, maxDistance)) {
+                    closestHit = hit;
+                    hitMesh = static_cast<int>(i);
+                }
+            }
+
+            if (hitMesh >= 0) {
+                // the heaviest bone of the corner nearest to the hit, like the id pass reports it
+                const float corners[3] = { 1.0f - closestHit.u - closestHit.v, closestHit.u, closestHit.v };
+                int corner = static_cast<int>(std::max_element(corners, corners + 3) - corners);
+                const Gizmo::SkinningSource::Vertex& vertex = skinningSources[hitMesh].data()[closestHit.vertices[corner]];
+                int bone = -1;
+                for (uint32_t k = 0; k < Gizmo::CpuSkinning::kMaxInfluences; k++) {
+                    if (vertex.bones[k] >= 0 && (bone < 0 || vertex.weights[k] > vertex.weights[bone]))
+                        bone = static_cast<int>(k);
+                }
+                if (bone >= 0 && vertex.bones[bone] < gSkeleton->getBoneCount())
+                    index = gSkeleton->getBone(vertex.bones[bone]).mNodeIndex;
+            }
+            cpuPickMs = pickTimer.elapsedMs();
+        }
+        else if (mouseDown && !mouseWasDown && !uiWantsMouse) {
+            if (hovered.object == Gizmo::PickBone && hovered.node < static_cast<uint32_t>(gSkeleton->getNodeCount()))
+                index = hovered.node;
+            else if (hovered.object >= Gizmo::PickMeshBase && hovered.bone < static_cast<uint32_t>(gSkeleton->getBoneCount()))
+                index = gSkeleton->getBone(hovered.bone).mNodeIndex;
+        }
+        mouseWasDown = mouseDown;
+
 
         glm::mat4 boneGlobal = gSkeleton->getGlobalTransform(index); 
         glm::mat4 boneWorldMat = model * boneGlobal;
-        glm::mat4 copy = boneGlobal;
+        glm::mat4 copy = boneWorldMat;
 
+        // the cursor is read here, the rotation solved from it goes straight into the mapped palette below
+        double cursorTime = context->getTime();
         gizmo::manipulate(&view, &projection, &boneWorldMat, &temp);
 
-        int parentIndex = gSkeleton->getNode(index).mParentIndex;
-        glm::mat4 boneglobalTrans = glm::inverse(model) * boneWorldMat;
+        // only a drag changes the pose, the local transform is decomposed back into TRS once per edit
+        if (boneWorldMat != copy) {
+            int parentIndex = gSkeleton->getNode(index).mParentIndex;
+            glm::mat4 boneglobalTrans = glm::inverse(model) * boneWorldMat;
 
-        
-        glm::mat4 parentBoneGlobal = parentIndex == -1 ? glm::mat4(1.0f) : gSkeleton->getGlobalTransform(parentIndex);
+            glm::mat4 parentBoneGlobal = parentIndex == -1 ? glm::mat4(1.0f) : gSkeleton->getGlobalTransform(parentIndex);
 
-        glm::mat4 boneNewLocalTrans = glm::inverse(parentBoneGlobal) * boneglobalTrans;
+            glm::mat4 boneNewLocalTrans = glm::inverse(parentBoneGlobal) * boneglobalTrans;
 
-        gSkeleton->setNodeLocalTrans(index, boneNewLocalTrans); 
-        gSkeleton->calculateGlobalTransforms();
+            gSkeleton->setNodeLocalTrans(index, boneNewLocalTrans); 
+            gSkeleton->calculateGlobalTransforms();
+            pendingEdits.push_back({ ++editSerial, index, boneNewLocalTrans });
+        }
+
+        if (gpuSkinning) {
+            skinningTimer.begin();
+            if (skinningPass.usesMode(Gizmo::SkinningMode::LinearBlend))
+                skinningPass.setPalette(*gSkeleton);
+            if (skinningPass.usesMode(Gizmo::SkinningMode::DualQuaternion))
+                skinningPass.setPalette(gSkeleton->calculateSkinningDualQuats());
+            skinningPass.dispatch();
+            skinningTimer.end();
+        }
 
         //model 
-        for (int i = 0; i < gMeshes.size(); i++) {
+        ShaderProgram& meshShader = gpuSkinning ? posedShader : textureShader;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(view * model)));
+        meshPassTimer.begin();
+        meshShader.use();
+        glUniformMatrix4fv(meshShader.u("V"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(meshShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection)); 
+        glUniform3f(meshShader.u("color"), (GLfloat)0.2, (GLfloat)0.6, (GLfloat)0.2);
+        glUniform1i(meshShader.u("myTexture"), 0);
+
+        glUniform3f(meshShader.u("lightColor"), lighColor.x, lighColor.y, lighColor.z);
+        glUniform3f(meshShader.u("lightPos"), lightPos.x, lightPos.y, lightPos.z);
+        glUniform3f(meshShader.u("lightColor2"), lighColor2.x, lighColor2.y, lighColor2.z);
+        glUniform3f(meshShader.u("lightPos2"), lightPos2.x, lightPos2.y, lightPos2.z);
+
+        glUniformMatrix4fv(meshShader.u("M"), 1, GL_FALSE, glm::value_ptr(model));
+        if (gpuSkinning) {
+            glUniformMatrix3fv(meshShader.u("N"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+            // one call per texture array, the posed meshes carry their layers
+            for (uint32_t a = 0; a < meshesByArray.size(); a++) {
+                materials.getArray(a).Bind();
+                skinningPass.drawPosedMeshes(meshesByArray[a]);
+            }
+        }
+        else {
+            UploadBoneMatrices(textureShader);
+            int32_t boundArray = -1;
+            for (uint32_t i = 0; i < gMeshes.size(); i++) {
+                gMeshes[i]->bindSubMesh(0);
+                bindMaterial(i, meshShader, boundArray);
+                glDrawElements(GL_TRIANGLES, gMeshes[i]->getSubMesh(0).getCount(), GL_UNSIGNED_INT, 0);
+            }
+        }
+        meshPassTimer.end();
 
+        bool drawImports = std::any_of(imports.begin(), imports.end(), [](const Gizmo::Ref<Gizmo::ModelLoader::Load>& load) {
+            return load->getState() == Gizmo::LoadState::Done;
+        });
+        if (drawImports) {
             textureShader.use();
-            gMeshes[i]->bindSubMesh(0);
-
-            if(texturesMap[gMeshesNames[i]] != nullptr)
-                texturesMap[gMeshesNames[i]]->Bind(); 
-
             glUniformMatrix4fv(textureShader.u("V"), 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(textureShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection)); 
-            glUniform3f(textureShader.u("color"), (GLfloat)0.2, (GLfloat)0.6, (GLfloat)0.2);
-
-            glUniform1i(textureShader.u("myTexture"), texturesMap[gMeshesNames[i]] != nullptr ? texturesMap[gMeshesNames[i]]->getSlot() : 0);
-
+            glUniformMatrix4fv(textureShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniform1i(textureShader.u("myTexture"), 0);
+            glUniform1f(textureShader.u("materialLayer"), materials.getDefaultMaterial().layer);
             glUniform3f(textureShader.u("lightColor"), lighColor.x, lighColor.y, lighColor.z);
             glUniform3f(textureShader.u("lightPos"), lightPos.x, lightPos.y, lightPos.z);
-
-
             glUniform3f(textureShader.u("lightColor2"), lighColor2.x, lighColor2.y, lighColor2.z);
             glUniform3f(textureShader.u("lightPos2"), lightPos2.x, lightPos2.y, lightPos2.z);
-
-            glUniformMatrix4fv(textureShader.u("M"), 1, GL_FALSE, glm::value_ptr(model));
-
-            for (int j = 0; j < gSkeleton->getBoneCount() ; ++j) {
-                std::string name = "uBoneMatrices[" + std::to_string(j) + "]";
-                glUniformMatrix4fv(textureShader.u(name.c_str()), 1, GL_FALSE, glm::value_ptr(gSkeleton->getGlobalTransform(gSkeleton->getBone(j).mNodeIndex)* gSkeleton->getBone(j).mInvBindPose));
+            // imports bring no materials of their own yet
+            materials.getArray(materials.getDefaultMaterial().array).Bind();
+            for (size_t i = 0; i < imports.size(); i++) {
+                if (imports[i]->getState() != Gizmo::LoadState::Done)
+                    continue;
+                Gizmo::Model& imported = imports[i]->getModel();
+                glm::mat4 importModel = glm::translate(model, glm::vec3(1.0f + i, 0.0f, 0.0f));
+                glUniformMatrix4fv(textureShader.u("M"), 1, GL_FALSE, glm::value_ptr(importModel));
+                UploadBoneMatrices(textureShader, *imported.skeleton);
+                for (const Gizmo::Ref<Gizmo::SkinnedMesh>& mesh : imported.meshes) {
+                    mesh->bindSubMesh(0);
+                    glDrawElements(GL_TRIANGLES, mesh->getSubMesh(0).getCount(), GL_UNSIGNED_INT, 0);
+                }
             }
-
-            glDrawElements(GL_TRIANGLES, gMeshes[i]->getSubMesh(0).getCount(), GL_UNSIGNED_INT, 0);
         }
 
-        int pixelX = static_cast<int>(Input::GetMouseX());
-        int pixelY = 600 - static_cast<int>(Input::GetMouseY());
+        if (!lateLatch)
+            drawCrowds();
 
         //draw box as Bones transforamtions
         glDisable(GL_DEPTH_TEST); 
@@ -442,7 +1000,7 @@ int main() {
         glUniformMatrix4fv(defaultShader.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
         glUniform3f(defaultShader.u("color"), 149.0f/250.0f, 149.0f / 250.0f, 149.0f / 250.0f);
 
-        for (int i = 4; i < gSkeleton->getNodeCount(); i++) {
+        for (int i = firstBoneNode; i < gSkeleton->getNodeCount(); i++) {
             glm::mat4 boneGlobal = gSkeleton->getGlobalTransform(i);
             glm::mat4 trans = model * boneGlobal;
             trans = glm::scale(trans, glm::vec3(0.5, 0.5, 0.5)); 
@@ -471,43 +1029,250 @@ int main() {
         glUniformMatrix4fv(defaultShader.u("M"), 1, GL_FALSE, glm::value_ptr(lightModel));
         glDrawElements(GL_TRIANGLES, boxMesh.getSubMesh(0).getCount(), GL_UNSIGNED_INT, nullptr);
 
+        // ring vertices for this frame, before the id pass so both draw the same rings
+        gizmo::updateRotationGizmo();
+
+        //id pass, only the pixel under the cursor is shaded and read back
+        if (pickingPass) {
+            glm::vec2 mouse = Input::GetMousePosition() * Input::GetFramebufferScale();
+            pickingPass->begin(static_cast<int>(mouse.x), static_cast<int>(mouse.y));
+
+            pickMeshTimer.begin();
+            ShaderProgram& meshPick = gpuSkinning ? pickingPass->getPosedShader() : pickingPass->getSkinnedShader();
+            meshPick.use();
+            glUniformMatrix4fv(meshPick.u("V"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(meshPick.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(meshPick.u("M"), 1, GL_FALSE, glm::value_ptr(model));
+            if (!gpuSkinning)
+                UploadBoneMatrices(meshPick);
+            for (int i = 0; i < gMeshes.size(); i++) {
+                if (gpuSkinning)
+                    skinningPass.bindPosedMesh(i);
+                else
+                    gMeshes[i]->bindSubMesh(0);
+                Gizmo::PickingPass::setID(meshPick, Gizmo::PickMeshBase + i, 0);
+                glDrawElements(GL_TRIANGLES, gMeshes[i]->getSubMesh(0).getCount(), GL_UNSIGNED_INT, 0);
+            }
+            pickMeshTimer.end();
+
+            ShaderProgram& staticPick = pickingPass->getStaticShader();
+            staticPick.use();
+            glUniformMatrix4fv(staticPick.u("V"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(staticPick.u("P"), 1, GL_FALSE, glm::value_ptr(projection));
+            glDisable(GL_DEPTH_TEST);
+            boxMesh.bindSubMesh(0);
+            for (int i = firstBoneNode; i < gSkeleton->getNodeCount(); i++) {
+                glm::mat4 trans = glm::scale(model * gSkeleton->getGlobalTransform(i), glm::vec3(0.5, 0.5, 0.5));
+                glUniformMatrix4fv(staticPick.u("M"), 1, GL_FALSE, glm::value_ptr(trans));
+                Gizmo::PickingPass::setID(staticPick, Gizmo::PickBone, 0, 0xFFFFFFFFu, i);
+                glDrawElements(GL_TRIANGLES, boxMesh.getSubMesh(0).getCount(), GL_UNSIGNED_INT, nullptr);
+            }
+            gizmo::drawRotationGizmoIds(staticPick, Gizmo::PickGizmo);
+
+            pickingPass->end();
+            if (offscreen)
+                offscreen->Bind();
+            else
+                glViewport(0, 0, gWindowWidth, gWindowHeight);
+        }
+
         gizmo::drawRotationGizmo();
 
+        if (captureEveryFrame || captureOnce) {
+            char capturePath[512];
+            snprintf(capturePath, sizeof(capturePath), "%s_%05u.png", options.capturePrefix.c_str(), frame);
+            frameCapture.capture(offscreen ? offscreen->GetID() : 0, 0, gWindowWidth, gWindowHeight, capturePath);
+            captureOnce = false;
+        }
+        frameCapture.update();
+
 #ifdef GIZMOS_DEBUG
-        ImGui::Text("glfwGetTime() = %.3f", (float)glfwGetTime());  
-        ImGui::Text("FPS: %d", (int)(1/((float)glfwGetTime() - deltaTime))); 
+        if (useImGui) {
+            ImGui::Text("time = %.3f", (float)context->getTime());  
+            ImGui::Text("FPS: %d", (int)(1/((float)context->getTime() - deltaTime))); 
+            ImGui::Text("GL debug: %s, %u messages (%u duplicates)", glDebugOutputEnabled() ? "KHR_debug" : "glGetError", glDebugMessageCount(), glDebugSuppressedCount());
 
-        ImGui::InputInt("index", &index, 1); 
+            ImGui::InputInt("index", &index, 1); 
         
-        if (index < 0) index = gSkeleton->getNodeCount() - 1;
-        if (index >= gSkeleton->getNodeCount()) index = 0;
+            if (index < 0) index = gSkeleton->getNodeCount() - 1;
+            if (index >= gSkeleton->getNodeCount()) index = 0;
 
-        ImGui::Text(gSkeleton->getNode(index).mName.c_str());
+            ImGui::Text(gSkeleton->getNode(index).mName.c_str());
+            ImGui::Text("hover: object %u submesh %u bone %d node %d (frame %u)", hovered.object, hovered.subMesh,
+                static_cast<int>(hovered.bone), static_cast<int>(hovered.node), hovered.frame);
 
-        ImGui::InputFloat3("light Position", glm::value_ptr(lightPos)); 
-        ImGui::InputFloat3("light Color", glm::value_ptr(lighColor)); 
+            if (ImGui::Checkbox("GPU skinning pre-pass", &gpuSkinning)) {
+                meshPassTimer.resetAverage();
+                pickMeshTimer.resetAverage();
+            }
+            ImGui::Text("GPU ms: skinning %.3f, main meshes %.3f, pick meshes %.3f", gpuSkinning ? skinningTimer.getMs() : 0.0,
+                meshPassTimer.getMs(), pickMeshTimer.getMs());
+            if (gpuSkinning && ImGui::TreeNode("Dual quaternion skinning")) {
+                for (uint32_t i = 0; i < skinningPass.getMeshCount(); i++) {
+                    bool dualQuat = skinningPass.getMeshMode(i) == Gizmo::SkinningMode::DualQuaternion;
+                    if (ImGui::Checkbox((gMeshesNames[i] + "##dq" + std::to_string(i)).c_str(), &dualQuat))
+                        skinningPass.setMeshMode(i, dualQuat ? Gizmo::SkinningMode::DualQuaternion : Gizmo::SkinningMode::LinearBlend);
+                }
+                ImGui::TreePop();
+            }
 
-        ImGui::InputFloat3("light Position2", glm::value_ptr(lightPos2)); 
-        ImGui::InputFloat3("light Color2", glm::value_ptr(lighColor2)); 
+            if (!gClips.empty()) {
+                ImGui::SliderInt("clip", &clipIndex, 0, static_cast<int>(gClips.size()) - 1);
+                ImGui::Text("%s (%.2f s)", gClips[clipIndex].getName().c_str(), gClips[clipIndex].getDuration());
+                ImGui::Checkbox("play", &playAnimation);
+                ImGui::SameLine();
+                ImGui::SliderFloat("speed", &animationSpeed, 0.0f, 2.0f);
+                ImGui::Checkbox("play compressed", &playCompressed);
+                ImGui::SliderInt("blend clip", &blendClipIndex, 0, static_cast<int>(gClips.size()) - 1);
+                ImGui::SliderFloat("blend weight", &blendWeight, 0.0f, 1.0f);
+            }
 
-        ImGui::End();
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            ImGui::Text("%s: update %.2f ms CPU, input to swap %.2f ms avg", pipeline.isThreaded() ? "pipelined" : "serial",
+                updateMs, latencyStats.meanMs());
+            if (ImGui::Checkbox("late latch cursor", &lateLatch)) {
+                cursorStats.iterations = 0;
+                cursorStats.totalMs = cursorStats.maxMs = 0.0;
+                cursorStats.minMs = 1e30;
+            }
+            ImGui::SameLine();
+            ImGui::Text("cursor to swap %.2f ms, %.2f frames", cursorStats.meanMs(), cursorStats.meanMs() / std::max(frameStats.meanMs(), 1e-6));
+            if (crowd.getInstanceCount() > 0)
+                ImGui::Text("crowd: %u instances, update %.2f ms CPU, draw %.2f ms GPU", crowd.getInstanceCount(), crowdUpdateMs, crowdTimer.getMs());
+            if (bakedCrowd)
+                ImGui::Text("baked crowd: %u instances, draw %.2f ms GPU", bakedCrowd->getInstanceCount(), bakedTimer.getMs());
+
+            ImGui::Text("streamed %.1f KB last frame, %u fence waits (%.2f ms)", streamingBuffer.getLastFrameBytes() / 1024.0,
+                streamingBuffer.getFenceWaits(), streamingBuffer.getFenceWaitMs());
+            DrawResourceTable();
+            const Gizmo::TextureManager::Stats& textureStats = textureManager.getStats();
+            ImGui::Text("textures: %u of %u resident (%.2f MB), %u hits (%u deduplicated), %u misses, %u evictions, %u reloads",
+                textureManager.getResidentCount(), textureManager.getTextureCount(), textureManager.getResidentBytes() / 1048576.0,
+                textureStats.hits, textureStats.deduplicated, textureStats.misses, textureStats.evictions, textureStats.reloads);
+            ImGui::Text("materials: %u textures in %u arrays, %u layers still copying", materials.getMaterialCount(),
+                materials.getArrayCount(), materials.getPendingCount());
+            const Gizmo::TextureStreamer::Stats& streamStats = textureStreamer.getStats();
+            ImGui::Text("texture streaming: %u refining, %u of %u complete, %.1f KB uploaded last frame (budget %llu KB)",
+                textureStreamer.getStreamingCount(), streamStats.completed, streamStats.requested, streamStats.lastFrameBytes / 1024.0,
+                static_cast<unsigned long long>(textureStreamer.getFrameBudget() / 1024));
+            ImGui::Checkbox("CPU ray picking (BVH)", &cpuPicking);
+            if (cpuPicking)
+                ImGui::Text("last CPU pick: %.3f ms", cpuPickMs);
+
+            ImGui::InputFloat3("light Position", glm::value_ptr(lightPos)); 
+            ImGui::InputFloat3("light Color", glm::value_ptr(lighColor)); 
+
+            ImGui::InputFloat3("light Position2", glm::value_ptr(lightPos2)); 
+            ImGui::InputFloat3("light Color2", glm::value_ptr(lighColor2)); 
+
+            captureOnce = ImGui::Button("Capture");
+            ImGui::SameLine();
+            ImGui::Checkbox("Capture every frame", &captureEveryFrame);
+            ImGui::Text("captures: %u queued, %u in flight, %u written, %u dropped", frameCapture.getCapturedCount(),
+                frameCapture.getInFlightCount(), frameCapture.getEncodedCount(), frameCapture.getDroppedCount());
+
+            ImGui::InputText("model", importPath, sizeof(importPath));
+            if (ImGui::Button("Import"))
+                imports.push_back(modelLoader.load(importPath));
+            for (size_t i = 0; i < imports.size(); i++) {
+                Gizmo::ModelLoader::Load& load = *imports[i];
+                std::string label = load.getPath() + ": " + (load.getState() == Gizmo::LoadState::Failed ? load.getError() : Gizmo::getLoadStateName(load.getState()));
+                if (!load.isFinished()) {
+                    if (ImGui::Button(("Cancel##import" + std::to_string(i)).c_str()))
+                        load.cancel();
+                    ImGui::SameLine();
+                }
+                ImGui::ProgressBar(load.getProgress(), ImVec2(-1, 0), label.c_str());
+            }
+
+            ImGui::End();
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 #endif // GIZMOS_DEBUG
 
-        deltaTime = (float)glfwGetTime();
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        glFlushErrors();
+
+        streamingBuffer.endFrame();
+        textureManager.endFrame();
+        deltaTime = (float)context->getTime();
+        context->swapBuffers();
+        context->pollEvents();
+
+        double latencyMs = (context->getTime() - packet.inputTime) * 1000.0;
+        latencyStats.iterations++;
+        latencyStats.totalMs += latencyMs;
+        latencyStats.minMs = std::min(latencyStats.minMs, latencyMs);
+        latencyStats.maxMs = std::max(latencyStats.maxMs, latencyMs);
+
+        double cursorMs = (context->getTime() - cursorTime) * 1000.0;
+        cursorStats.iterations++;
+        cursorStats.totalMs += cursorMs;
+        cursorStats.minMs = std::min(cursorStats.minMs, cursorMs);
+        cursorStats.maxMs = std::max(cursorStats.maxMs, cursorMs);
+
+        double frameMs = frameTimer.elapsedMs();
+        frameStats.iterations++;
+        frameStats.totalMs += frameMs;
+        frameStats.minMs = std::min(frameStats.minMs, frameMs);
+        frameStats.maxMs = std::max(frameStats.maxMs, frameMs);
+        frame++;
     }
 
-#ifdef GIZMOS_DEBUG
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-#endif // GIZMOS_DEBUG
-
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    int exitCode = 0;
+    frameCapture.flush();
+
+    if (offscreen) {
+        std::cout << (pipeline.isThreaded() ? "Pipelined" : "Serial") << ": " << pipeline.getUpdateCount() << " updates for " << frame << " frames" << std::endl;
+        Gizmo::printBenchmark(frameStats);
+        Gizmo::printBenchmark(latencyStats);
+        Gizmo::printBenchmark(cursorStats);
+        std::cout << "Streamed " << streamingBuffer.getBytesStreamed() / 1024 << " KB (" << streamingBuffer.getBytesStreamed() / 1024 / std::max(frame, 1u)
+            << " KB/frame), " << streamingBuffer.getFenceWaits() << " fence waits (" << streamingBuffer.getFenceWaitMs() << " ms), "
+            << streamingBuffer.getFailedAllocations() << " failed allocations" << std::endl;
+        std::cout << "Cursor to swap: " << cursorStats.meanMs() / std::max(frameStats.meanMs(), 1e-6) << " frames, late latch " << (lateLatch ? "on" : "off") << std::endl;
+        std::cout << "GPU ms (avg): skinning pre-pass " << skinningTimer.getAverageMs() << ", mesh pass " << meshPassTimer.getAverageMs() << std::endl;
+        if (crowd.getInstanceCount() > 0)
+            std::cout << "Crowd of " << crowd.getInstanceCount() << ": update " << crowdUpdateMs << " ms CPU (last frame), draw " << crowdTimer.getAverageMs() << " ms GPU (avg)" << std::endl;
+        if (bakedCrowd)
+            std::cout << "Baked crowd of " << bakedCrowd->getInstanceCount() << ": draw " << bakedTimer.getAverageMs() << " ms GPU (avg)" << std::endl;
+        Gizmo::ResourceRegistry& registry = Gizmo::ResourceRegistry::get();
+        std::cout << "Resources: " << registry.getCount() << " objects, GPU " << registry.getBytes(Gizmo::ResourceMemory::GPU) / 1024
+            << " KB (peak " << registry.getPeakBytes(Gizmo::ResourceMemory::GPU) / 1024 << " KB), CPU " << registry.getBytes(Gizmo::ResourceMemory::CPU) / 1024
+            << " KB (peak " << registry.getPeakBytes(Gizmo::ResourceMemory::CPU) / 1024 << " KB)" << std::endl;
+        const Gizmo::TextureManager::Stats& textureStats = textureManager.getStats();
+        std::cout << "Textures: " << textureManager.getResidentCount() << " of " << textureManager.getTextureCount() << " resident ("
+            << textureManager.getResidentBytes() / 1024 << " KB), " << textureStats.hits << " hits (" << textureStats.deduplicated << " deduplicated), "
+            << textureStats.misses << " misses, " << textureStats.evictions << " evictions, " << textureStats.reloads << " reloads" << std::endl;
+        if (options.streamBudget > 0) {
+            const Gizmo::TextureStreamer::Stats& streamStats = textureStreamer.getStats();
+            std::cout << "Texture streaming: " << streamStats.completed << " of " << streamStats.requested << " complete, " << streamStats.failed << " failed, "
+                << streamStats.uploadedBytes / 1024 << " KB uploaded" << std::endl;
+        }
+        if (frameCapture.getCapturedCount() > 0)
+            std::cout << "Captured " << frameCapture.getEncodedCount() << " frames, dropped " << frameCapture.getDroppedCount() << std::endl;
+
+        Gizmo::Image image;
+        image.width = gWindowWidth;
+        image.height = gWindowHeight;
+        offscreen->ReadPixels(0, image.pixels);
+        Gizmo::flipVertically(image);
+
+        if (!options.dumpPath.empty() && Gizmo::writePNG(options.dumpPath, image))
+            std::cout << "Wrote " << options.dumpPath << std::endl;
+
+        if (!options.goldenPath.empty()) {
+            Gizmo::Image golden;
+            Gizmo::ImageDiff diff;
+            if (!Gizmo::loadImage(options.goldenPath, golden) || !Gizmo::compareImages(image, golden, diff)) {
+                std::cerr << "Golden image " << options.goldenPath << " missing or of a different size" << std::endl;
+                exitCode = 1;
+            }
+            else {
+                std::cout << "Golden diff: mean " << diff.meanError << " max " << diff.maxError << " pixels " << diff.differingPixels << std::endl;
+                exitCode = diff.meanError <= options.tolerance ? 0 : 1;
+            }
+        }
+    }
 
-    return 0;
+    return shutdown(exitCode);
 }
\ No newline at end of file
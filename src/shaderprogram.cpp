@@ -1,9 +1,17 @@
 #include "shaderprogram.h"
+#include "OpenGLUtil.h"
 #include "assert.h"
 #include <iostream>
 
 #define assertm(exp, msg) assert((void(msg), exp))
 
+//Size of the linked program as the driver would hand it out, the closest estimate of what it keeps
+static GLint programBinarySize(GLuint program) {
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	return size;
+}
+
 //Procedure reads a file into an array of chars
 char* ShaderProgram::readFile(const char* fileName) {
 	int filesize;
@@ -115,6 +123,7 @@ int ShaderProgram::linkProgram() {
 		printf("%s\n", infoLog);
 		delete[]infoLog;
 	}
+	tracking.resize(programBinarySize(shaderProgram));
 	return 0; 
 }
 
@@ -129,7 +138,12 @@ ShaderProgram::ShaderProgram(const char* vertexShaderFile, const char* fragmentS
 	//Attach shaders and link shader program
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragmentShader);
+	tracking = Gizmo::TrackedResource(Gizmo::ResourceCategory::Shader, 0, std::string(vertexShaderFile) + " + " + fragmentShaderFile);
 	linkProgram(); 
+
+	glLabelObject(GL_SHADER, vertexShader, vertexShaderFile);
+	glLabelObject(GL_SHADER, fragmentShader, fragmentShaderFile);
+	glLabelObject(GL_PROGRAM, shaderProgram, vertexShaderFile);
 }
 
 ShaderProgram::ShaderProgram(ShaderProgram&& other) noexcept {
@@ -146,6 +160,7 @@ ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other) noexcept {
 		fragmentShader = other.fragmentShader;
 		tessEvalShader = other.tessEvalShader;
 		tessControlShader = other.tessControlShader;
+		tracking = std::move(other.tracking);
 
 		other.shaderProgram = 0;
 		other.vertexShader = 0;
@@ -174,6 +189,7 @@ void ShaderProgram::clean() {
 
 	//Delete program
 	if (shaderProgram != 0) glDeleteProgram(shaderProgram);
+	tracking.reset();
 }
 
 ShaderProgram::~ShaderProgram() { clean(); }
@@ -217,6 +233,9 @@ ComputeShaderProgram::ComputeShaderProgram(const char* computeShaderFile) {
 		printf("%s\n", infoLog);
 		delete[]infoLog;
 	}
+
+	glLabelObject(GL_PROGRAM, shaderProgram, computeShaderFile);
+	tracking = Gizmo::TrackedResource(Gizmo::ResourceCategory::Shader, programBinarySize(shaderProgram), computeShaderFile);
 }
 ComputeShaderProgram::~ComputeShaderProgram() {
 	glDetachShader(shaderProgram, computeShader);
@@ -246,6 +265,7 @@ int ComputeShaderProgram::updateShader(const char* computeShaderFile) {
 		printf("%s\n", infoLog);
 		delete[]infoLog;
 	}
+	tracking.resize(programBinarySize(shaderProgram));
 
 	return 0; 
 }
@@ -254,6 +274,10 @@ void ComputeShaderProgram::use() {
 	glUseProgram(shaderProgram);
 }
 
+GLuint ComputeShaderProgram::u(const char* variableName) {
+	return glGetUniformLocation(shaderProgram, variableName);
+}
+
 char* ComputeShaderProgram::readFile(const char* fileName) {
 	int filesize;
 	FILE* plik;
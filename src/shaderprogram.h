@@ -2,6 +2,7 @@
 #define SHADERPROGRAM_H
 
 #include "GL/glew.h"
+#include "ResourceRegistry.h"
 
 
 class ShaderProgram {
@@ -12,6 +13,7 @@ private:
 	GLuint fragmentShader;		// Fragment shader handle 
 	GLuint tessEvalShader;		// Tessellation Evaluation shader handle
 	GLuint tessControlShader;	// Tessellation Control shader handle
+	Gizmo::TrackedResource tracking;	// Program binary size in the resource registry
 
 	char* readFile(const char* fileName);						// File reading method
 	GLuint loadShader(GLenum shaderType, const char* fileName); // Method reads shader source file, compiles it and returns the corresponding handle
@@ -42,9 +44,11 @@ public:
 
 	int updateShader(const char* computeShaderFile);
 	void use();
+	GLuint u(const char* variableName);
 private: 
 	GLuint computeShader;
 	GLuint shaderProgram;
+	Gizmo::TrackedResource tracking;
 	char* readFile(const char* fileName);
 	GLuint loadShader(const char* fileName);
 };
@@ -0,0 +1,101 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// source vertices as ProcessAiMesh lays them out: pos3 normal3 uv2 boneID4 weight4
+layout (std430, binding = 0) readonly buffer SourceVertices { float src[]; };
+// posed vertices: pos3 normal3 uv2 dominantBone
+layout (std430, binding = 1) writeonly buffer PosedVertices { float dst[]; };
+layout (std430, binding = 2) readonly buffer Palette { mat4 uBoneMatrices[]; };
+
+struct DualQuat { vec4 real; vec4 dual; };
+layout (std430, binding = 3) readonly buffer DualQuatPalette { DualQuat uBoneDualQuats[]; };
+
+uniform uint uVertexCount;
+uniform uint uBaseVertex; // where the mesh starts in the shared posed buffer
+uniform uint uBoneCount;
+uniform bool uDualQuat;
+
+const uint SRC_STRIDE = 16u;
+const uint DST_STRIDE = 9u;
+
+void main() {
+    uint vertex = gl_GlobalInvocationID.x;
+    if (vertex >= uVertexCount)
+        return;
+
+    uint s = vertex * SRC_STRIDE;
+    vec4 aPos = vec4(src[s + 0u], src[s + 1u], src[s + 2u], 1.0);
+    vec3 aNormal = vec3(src[s + 3u], src[s + 4u], src[s + 5u]);
+
+    // same influences as v_texture.glsl
+    mat4 boneTransform = mat4(0.0);
+    vec4 blendReal = vec4(0.0);
+    vec4 blendDual = vec4(0.0);
+    float totalWeight = 0.0;
+    float maxWeight = 0.0;
+    float dominantBone = -1.0;
+    bool outOfRange = false;
+    for (uint i = 0u; i < 3u; i++)
+    {
+        int bone = int(src[s + 8u + i]);
+        float weight = src[s + 12u + i];
+        if (bone == -1)
+            continue;
+        if (uint(bone) >= uBoneCount)
+        {
+            outOfRange = true;
+            break;
+        }
+        if (uDualQuat)
+        {
+            // keep every quaternion in the hemisphere of the first one so the blend takes the short way
+            DualQuat dq = uBoneDualQuats[bone];
+            float hemisphere = (totalWeight > 0.0 && dot(dq.real, blendReal) < 0.0) ? -weight : weight;
+            blendReal += dq.real * hemisphere;
+            blendDual += dq.dual * hemisphere;
+        }
+        else
+        {
+            boneTransform += uBoneMatrices[bone] * weight;
+        }
+        totalWeight += weight;
+        if (weight > maxWeight)
+        {
+            maxWeight = weight;
+            dominantBone = float(bone);
+        }
+    }
+    vec3 position;
+    vec3 normal;
+    if (outOfRange || totalWeight == 0.0)
+    {
+        position = aPos.xyz;
+        normal = aNormal;
+    }
+    else if (uDualQuat)
+    {
+        float len = length(blendReal);
+        vec4 r = blendReal / len;
+        vec4 d = blendDual / len;
+        position = aPos.xyz + 2.0 * cross(r.xyz, cross(r.xyz, aPos.xyz) + r.w * aPos.xyz)
+                 + 2.0 * (r.w * d.xyz - d.w * r.xyz + cross(r.xyz, d.xyz));
+        normal = normalize(aNormal + 2.0 * cross(r.xyz, cross(r.xyz, aNormal) + r.w * aNormal));
+    }
+    else
+    {
+        position = (boneTransform * aPos).xyz;
+        // the blended bones are rigid, their upper 3x3 transforms normals without an inverse
+        normal = normalize(mat3(boneTransform) * aNormal);
+    }
+
+    uint d = (uBaseVertex + vertex) * DST_STRIDE;
+    dst[d + 0u] = position.x;
+    dst[d + 1u] = position.y;
+    dst[d + 2u] = position.z;
+    dst[d + 3u] = normal.x;
+    dst[d + 4u] = normal.y;
+    dst[d + 5u] = normal.z;
+    dst[d + 6u] = src[s + 6u];
+    dst[d + 7u] = src[s + 7u];
+    dst[d + 8u] = dominantBone;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+flat in uint vBone;
+
+out uvec4 FragID;
+
+uniform uvec4 uID; // object, submesh, bone, node
+
+void main() {
+    FragID = uvec4(uID.x, uID.y, vBone == 0xFFFFFFFFu ? uID.z : vBone, uID.w);
+}
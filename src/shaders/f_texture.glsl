@@ -1,6 +1,7 @@
 #version 330 core
 
 in vec2 TexCoord;
+flat in float Layer;
 in vec4 n;
 in vec4 l;
 in vec4 l2;
@@ -8,7 +9,7 @@ in vec4 v;
 
 out vec4 FragColor;
 
-uniform sampler2D myTexture;
+uniform sampler2DArray myTexture; // material textures, see MaterialTextures.h
 uniform vec3 lightColor;
 uniform vec3 lightColor2;
 
@@ -18,7 +19,7 @@ void main() {
     vec3 viewDir = normalize(v.xyz);
 
     // Surface parameters
-    vec3 kd = texture(myTexture, TexCoord).rgb;
+    vec3 kd = texture(myTexture, vec3(TexCoord, Layer)).rgb;
     vec3 ks = vec3(0.0);
     float shininess = 10.0;
     float ambientStrength = 0.1;
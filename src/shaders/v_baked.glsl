@@ -0,0 +1,79 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aBoneID;
+layout (location = 4) in vec4 aBoneWeight;
+
+struct BakedInstance {
+    mat4 model;
+    vec4 playback; // x time offset, y speed
+};
+
+layout(std430, binding = 6) readonly buffer Instances {
+    BakedInstance instances[];
+};
+
+// bone b of frame f: rows of its 3x4 skinning matrix in texels (3b .. 3b + 2, f), see AnimationBaker.h
+uniform sampler2D uBakedPalettes;
+uniform float uTime;
+uniform float uFrameRate;
+uniform int uFrameCount;
+uniform int uBoneCount;
+
+uniform vec3 lightPos;
+uniform vec3 lightPos2;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform float materialLayer; // texture array layer, one per draw
+
+out vec2 TexCoord;
+flat out float Layer;
+out vec4 l;
+out vec4 l2;
+out vec4 n;
+out vec4 v;
+
+mat4 fetchBone(int bone, int frame) {
+    vec4 r0 = texelFetch(uBakedPalettes, ivec2(bone * 3, frame), 0);
+    vec4 r1 = texelFetch(uBakedPalettes, ivec2(bone * 3 + 1, frame), 0);
+    vec4 r2 = texelFetch(uBakedPalettes, ivec2(bone * 3 + 2, frame), 0);
+    return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() {
+    BakedInstance instance = instances[gl_InstanceID];
+
+    // mod() keeps negative offsets in range, the last frame blends back into the first
+    float frame = mod((uTime * instance.playback.y + instance.playback.x) * uFrameRate, float(uFrameCount));
+    int f0 = int(frame);
+    int f1 = (f0 + 1) % uFrameCount;
+    float t = fract(frame);
+
+    mat4 skin = mat4(0.0);
+    float total = 0.0;
+    for (int i = 0; i < 3; i++) {
+        int id = int(aBoneID[i]);
+        if (id < 0 || id >= uBoneCount)
+            continue;
+        skin += mix(fetchBone(id, f0), fetchBone(id, f1), t) * aBoneWeight[i];
+        total += aBoneWeight[i];
+    }
+    if (total == 0.0)
+        skin = mat4(1.0);
+
+    mat4 M = instance.model;
+    vec4 worldPos = M * skin * vec4(aPos, 1.0);
+    gl_Position = P * V * worldPos;
+
+    l = normalize(V * vec4(lightPos, 1.0) - V * worldPos);
+    l2 = normalize(V * vec4(lightPos2, 1.0) - V * worldPos);
+
+    v = normalize(vec4(0, 0, 0, 1) - V * worldPos);
+
+    n = vec4(normalize(mat3(V * M * skin) * aNormal), 0.0);
+
+    TexCoord = aTexCoord;
+    Layer = materialLayer;
+}
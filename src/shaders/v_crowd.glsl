@@ -0,0 +1,62 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aBoneID;
+layout (location = 4) in vec4 aBoneWeight;
+
+// uBoneCount matrices per instance, written by Crowd::update
+layout(std430, binding = 4) readonly buffer Palettes {
+    mat4 palettes[];
+};
+
+layout(std430, binding = 5) readonly buffer Models {
+    mat4 models[];
+};
+
+uniform vec3 lightPos;
+uniform vec3 lightPos2;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform float materialLayer; // texture array layer, one per draw
+uniform uint uBoneCount;
+
+out vec2 TexCoord;
+flat out float Layer;
+out vec4 l;
+out vec4 l2;
+out vec4 n;
+out vec4 v;
+
+void main() {
+    uint base = uint(gl_InstanceID) * uBoneCount;
+    mat4 skin = mat4(0.0);
+    float total = 0.0;
+
+    // three influences, like v_texture.glsl and c_skinning.glsl
+    for (int i = 0; i < 3; i++) {
+        int id = int(aBoneID[i]);
+        if (id < 0 || id >= int(uBoneCount))
+            continue;
+        skin += palettes[base + uint(id)] * aBoneWeight[i];
+        total += aBoneWeight[i];
+    }
+    if (total == 0.0)
+        skin = mat4(1.0);
+
+    mat4 M = models[gl_InstanceID];
+    vec4 worldPos = M * skin * vec4(aPos, 1.0);
+    gl_Position = P * V * worldPos;
+
+    l = normalize(V * vec4(lightPos, 1.0) - V * worldPos);
+    l2 = normalize(V * vec4(lightPos2, 1.0) - V * worldPos);
+
+    v = normalize(vec4(0, 0, 0, 1) - V * worldPos);
+
+    // crowd instances are rigid with uniform scale, so no inverse transpose per vertex
+    n = vec4(normalize(mat3(V * M * skin) * aNormal), 0.0);
+
+    TexCoord = aTexCoord;
+    Layer = materialLayer;
+}
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+
+flat out uint vBone;
+
+void main() {
+    vBone = 0xFFFFFFFFu; // take the bone id from uID
+    gl_Position = P * V * M * vec4(aPos, 1.0);
+}
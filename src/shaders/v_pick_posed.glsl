@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in float aBone;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+
+flat out uint vBone;
+
+void main() {
+    vBone = aBone < 0.0 ? 0xFFFFFFFFu : uint(aBone);
+    gl_Position = P * V * M * vec4(aPos, 1.0);
+}
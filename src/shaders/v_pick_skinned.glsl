@@ -0,0 +1,38 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aBoneID;
+layout (location = 4) in vec4 aBoneWeight;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+uniform mat4 uBoneMatrices[100];
+
+flat out uint vBone;
+
+void main() {
+    vec4 totalPosition = vec4(0.0f);
+    float maxWeight = 0.0;
+    vBone = 0xFFFFFFFFu;
+
+    for(int i = 0 ; i < 3 ; i++)
+    {
+        if(int(aBoneID[i]) == -1) 
+            continue;
+        if(int(aBoneID[i]) >=100) 
+        {
+            totalPosition = vec4(aPos,1.0f);
+            break;
+        }
+        totalPosition += uBoneMatrices[int(aBoneID[i])] * vec4(aPos,1.0f) * aBoneWeight[i];
+
+        // the most influential bone is the one a click on this vertex selects
+        if(aBoneWeight[i] > maxWeight)
+        {
+            maxWeight = aBoneWeight[i];
+            vBone = uint(aBoneID[i]);
+        }
+    }
+
+    gl_Position = P * V * M * totalPosition;
+}
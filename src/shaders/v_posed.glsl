@@ -0,0 +1,36 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 4) in float aMaterialLayer; // per mesh, instanced, see SkinningPass.h
+
+uniform vec3 lightPos;
+uniform vec3 lightPos2;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+uniform mat3 N; // transpose(inverse(mat3(V * M))), once per draw
+
+out vec2 TexCoord;
+flat out float Layer;
+out vec4 l;
+out vec4 l2;
+out vec4 n;
+out vec4 v;
+
+// vertices already skinned by c_skinning.glsl
+void main() {
+    vec4 worldPos = M * vec4(aPos, 1.0);
+    gl_Position = P * V * worldPos;
+
+    l = normalize(V * vec4(lightPos, 1.0) - V * worldPos);
+    l2 = normalize(V * vec4(lightPos2, 1.0) - V * worldPos);
+
+    v = normalize(vec4(0, 0, 0, 1) - V * worldPos);
+
+    n = vec4(N * aNormal, 0.0);
+
+    TexCoord = aTexCoord;
+    Layer = aMaterialLayer;
+}
@@ -11,9 +11,11 @@ uniform vec3 lightPos2;
 uniform mat4 M;
 uniform mat4 V;
 uniform mat4 P;
+uniform float materialLayer; // texture array layer, one per draw
 uniform mat4 uBoneMatrices[100];
 
 out vec2 TexCoord;
+flat out float Layer;
 out vec4 l;
 out vec4 l2;
 out vec4 n;
@@ -52,4 +54,5 @@ void main() {
     n = vec4(normalMatrix * aNormal, 0.0); // Correct normal transform
 
     TexCoord = aTexCoord;
+    Layer = materialLayer;
 }